@@ -0,0 +1,382 @@
+#include "BehaviorAnalytics.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+namespace behavior {
+
+    namespace {
+
+        constexpr int64_t EPOCH_MS = 60'000;
+
+        constexpr size_t BLOOM_BITS = 1u << 18;
+        constexpr size_t BLOOM_HASHES = 3;
+        constexpr size_t SKETCH_DEPTH = 4;
+        constexpr size_t SKETCH_WIDTH = 1024;
+        constexpr size_t HLL_PRECISION = 8;
+        constexpr size_t HLL_REGISTERS = 1u << HLL_PRECISION;
+        constexpr size_t APP_SLOTS = 64;
+        constexpr size_t BEACON_SLOTS = 1024;
+
+        constexpr int64_t BEACON_BURST_GAP_MS = 1'000;
+        constexpr int64_t BEACON_MIN_PERIOD_MS = 2'000;
+        constexpr int64_t BEACON_MAX_PERIOD_MS = 3'600'000;
+        constexpr uint32_t BEACON_MIN_INTERVALS = 6;
+        constexpr double BEACON_MAX_JITTER = 0.15;
+        constexpr double EWMA_ALPHA = 0.25;
+
+        // Saved state is the raw SketchState behind a small header. Bump the
+        // version whenever a field, constant or struct above changes the layout,
+        // even if the size happens to stay the same.
+        constexpr uint32_t STATE_LAYOUT_VERSION = 1;
+
+        struct StateHeader {
+            uint32_t layoutVersion;
+            uint32_t reserved;
+            uint64_t stateLength;
+        };
+
+        uint64_t mix64(uint64_t x) {
+            x ^= x >> 30;
+            x *= 0xbf58476d1ce4e5b9ull;
+            x ^= x >> 27;
+            x *= 0x94d049bb133111ebull;
+            x ^= x >> 31;
+            return x;
+        }
+
+        uint64_t hashText(std::string_view text, uint64_t seed) {
+            uint64_t hash = 0xcbf29ce484222325ull ^ seed;
+            for (unsigned char c : text) {
+                hash ^= c;
+                hash *= 0x100000001b3ull;
+            }
+            return mix64(hash);
+        }
+
+        uint64_t combine(uint64_t a, uint64_t b) {
+            return mix64(a ^ (b + 0x9e3779b97f4a7c15ull + (a << 6) + (a >> 2)));
+        }
+
+    } // namespace
+
+    struct BloomFilter {
+        std::array<uint64_t, BLOOM_BITS / 64> bits{};
+
+        void clear() { bits.fill(0); }
+
+        // Returns true if the key was (probably) already present.
+        bool testAndSet(uint64_t key) {
+            bool present = true;
+            uint64_t h1 = key;
+            uint64_t h2 = mix64(key) | 1u;
+            for (size_t i = 0; i < BLOOM_HASHES; ++i) {
+                size_t bit = static_cast<size_t>((h1 + i * h2) % BLOOM_BITS);
+                uint64_t mask = 1ull << (bit % 64);
+                if ((bits[bit / 64] & mask) == 0) {
+                    present = false;
+                    bits[bit / 64] |= mask;
+                }
+            }
+            return present;
+        }
+    };
+
+    struct CountMinSketch {
+        std::array<std::array<uint32_t, SKETCH_WIDTH>, SKETCH_DEPTH> counters{};
+
+        void clear() {
+            for (auto& row : counters) row.fill(0);
+        }
+
+        uint32_t add(uint64_t key) {
+            uint32_t estimate = UINT32_MAX;
+            for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+                size_t column = static_cast<size_t>(mix64(key + row * 0x9e3779b97f4a7c15ull) % SKETCH_WIDTH);
+                uint32_t& counter = counters[row][column];
+                if (counter != UINT32_MAX) ++counter;
+                estimate = std::min(estimate, counter);
+            }
+            return estimate;
+        }
+
+        uint32_t estimate(uint64_t key) const {
+            uint32_t estimate = UINT32_MAX;
+            for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+                size_t column = static_cast<size_t>(mix64(key + row * 0x9e3779b97f4a7c15ull) % SKETCH_WIDTH);
+                estimate = std::min(estimate, counters[row][column]);
+            }
+            return estimate;
+        }
+    };
+
+    // Keeps the harmonic sum and zero count up to date on every register change
+    // so estimating is O(1) instead of a pass over the registers.
+    struct HyperLogLog {
+        std::array<uint8_t, HLL_REGISTERS> registers{};
+        double inverseSum = static_cast<double>(HLL_REGISTERS);
+        uint32_t zeros = HLL_REGISTERS;
+
+        void clear() {
+            registers.fill(0);
+            inverseSum = static_cast<double>(HLL_REGISTERS);
+            zeros = HLL_REGISTERS;
+        }
+
+        void add(uint64_t hash) {
+            size_t index = static_cast<size_t>(hash >> (64 - HLL_PRECISION));
+            uint64_t rest = (hash << HLL_PRECISION) | (1ull << (HLL_PRECISION - 1));
+            uint8_t rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+            uint8_t current = registers[index];
+            if (rank <= current) {
+                return;
+            }
+            if (current == 0) --zeros;
+            inverseSum += std::ldexp(1.0, -static_cast<int>(rank)) - std::ldexp(1.0, -static_cast<int>(current));
+            registers[index] = rank;
+        }
+
+        double estimate() const {
+            constexpr double m = static_cast<double>(HLL_REGISTERS);
+            constexpr double alpha = 0.7213 / (1.0 + 1.079 / m);
+            double raw = alpha * m * m / inverseSum;
+            if (raw <= 2.5 * m && zeros > 0) {
+                return m * std::log(m / static_cast<double>(zeros));
+            }
+            return raw;
+        }
+    };
+
+    struct Epoch {
+        int64_t startMs = 0;
+        BloomFilter seenPairs;
+        CountMinSketch fanOut;          // key: source
+        CountMinSketch portsPerHost;    // key: source + destination
+        CountMinSketch hostsPerPort;    // key: source + port
+        CountMinSketch packets;         // key: source + destination
+        CountMinSketch smallPackets;    // key: source + destination
+        std::array<HyperLogLog, APP_SLOTS> appHosts;
+        std::array<HyperLogLog, APP_SLOTS> appPorts;
+
+        void clear(int64_t now) {
+            startMs = now;
+            seenPairs.clear();
+            fanOut.clear();
+            portsPerHost.clear();
+            hostsPerPort.clear();
+            packets.clear();
+            smallPackets.clear();
+            for (auto& hll : appHosts) hll.clear();
+            for (auto& hll : appPorts) hll.clear();
+        }
+    };
+
+    struct BeaconSlot {
+        uint64_t key = 0;
+        int64_t lastPacketMs = 0;
+        int64_t lastBurstMs = 0;
+        uint32_t intervals = 0;
+        double meanMs = 0.0;
+        double varianceMs = 0.0;
+    };
+
+    struct SketchState {
+        std::array<Epoch, 2> epochs;
+        uint32_t current = 0;
+        std::array<BeaconSlot, BEACON_SLOTS> beacons;
+
+        void clear() {
+            epochs[0].clear(0);
+            epochs[1].clear(0);
+            current = 0;
+            beacons.fill(BeaconSlot{});
+        }
+    };
+
+    static_assert(std::is_trivially_copyable<SketchState>::value, "SketchState is saved with memcpy");
+
+    namespace {
+
+        // Converts timestamps between absolute steady-clock values and ages. Zero is
+        // the "unset" marker and is preserved in both directions.
+        void shiftTimestamps(SketchState& state, int64_t (*convert)(int64_t, int64_t), int64_t reference) {
+            for (auto& epoch : state.epochs) {
+                if (epoch.startMs != 0) epoch.startMs = convert(epoch.startMs, reference);
+            }
+            for (auto& slot : state.beacons) {
+                if (slot.key == 0) continue;
+                slot.lastPacketMs = convert(slot.lastPacketMs, reference);
+                slot.lastBurstMs = convert(slot.lastBurstMs, reference);
+            }
+        }
+
+        int64_t toAge(int64_t timestamp, int64_t nowMs) {
+            return std::max<int64_t>(nowMs - timestamp, 1);
+        }
+
+        int64_t fromAge(int64_t age, int64_t originMs) {
+            return originMs - age;
+        }
+
+        void rotate(SketchState& state, int64_t now) {
+            Epoch& active = state.epochs[state.current];
+            if (active.startMs == 0) {
+                active.startMs = now;
+                return;
+            }
+            if (now - active.startMs < EPOCH_MS) {
+                return;
+            }
+            const bool idle = now - active.startMs >= 2 * EPOCH_MS;
+            state.current ^= 1u;
+            state.epochs[state.current].clear(now);
+            if (idle) {
+                // Idle for more than a full window: the epoch that just became the
+                // previous one is stale too.
+                active.clear(now - EPOCH_MS);
+            }
+        }
+
+        template <typename Member>
+        uint32_t windowEstimate(const SketchState& state, Member member, uint64_t key, uint32_t currentValue) {
+            const Epoch& previous = state.epochs[state.current ^ 1u];
+            return std::max(currentValue, (previous.*member).estimate(key));
+        }
+
+        void updateBeacon(SketchState& state, uint64_t key, int64_t now, Signals& signals) {
+            BeaconSlot& slot = state.beacons[key % BEACON_SLOTS];
+            if (slot.key != key) {
+                slot = BeaconSlot{};
+                slot.key = key;
+                slot.lastPacketMs = now;
+                slot.lastBurstMs = now;
+                return;
+            }
+
+            // Packets closer than the burst gap belong to the same check-in.
+            bool newBurst = now - slot.lastPacketMs >= BEACON_BURST_GAP_MS;
+            slot.lastPacketMs = now;
+            if (newBurst) {
+                double interval = static_cast<double>(now - slot.lastBurstMs);
+                slot.lastBurstMs = now;
+                if (slot.intervals == 0) {
+                    slot.meanMs = interval;
+                    slot.varianceMs = 0.0;
+                } else {
+                    double delta = interval - slot.meanMs;
+                    slot.meanMs += EWMA_ALPHA * delta;
+                    slot.varianceMs = (1.0 - EWMA_ALPHA) * (slot.varianceMs + EWMA_ALPHA * delta * delta);
+                }
+                if (slot.intervals < UINT32_MAX) ++slot.intervals;
+            }
+
+            if (slot.intervals >= BEACON_MIN_INTERVALS &&
+                slot.meanMs >= BEACON_MIN_PERIOD_MS && slot.meanMs <= BEACON_MAX_PERIOD_MS) {
+                double jitter = std::sqrt(slot.varianceMs) / slot.meanMs;
+                signals.beaconJitter = jitter;
+                signals.beaconPeriodSeconds = slot.meanMs / 1000.0;
+                signals.beaconing = jitter <= BEACON_MAX_JITTER;
+            }
+        }
+
+    } // namespace
+
+    Analytics::Analytics() : state(std::make_unique<SketchState>()) {}
+
+    Analytics::~Analytics() = default;
+
+    Signals Analytics::observe(const Observation& observation) {
+        Signals signals;
+
+        const uint64_t source = hashText(observation.sourceIp, 1);
+        const uint64_t destination = hashText(observation.destinationIp, 2);
+        const uint64_t port = mix64(static_cast<uint64_t>(observation.destinationPort) + 3);
+        const uint64_t app = observation.appPackage.empty() ? source : hashText(observation.appPackage, 4);
+        const uint64_t sourceDestination = combine(source, destination);
+        const uint64_t sourcePort = combine(source, port);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        SketchState& sketches = *state;
+        rotate(sketches, observation.timestampMs);
+        Epoch& epoch = sketches.epochs[sketches.current];
+
+        uint32_t fanOut = epoch.fanOut.estimate(source);
+        if (!epoch.seenPairs.testAndSet(combine(sourceDestination, 0x11))) {
+            fanOut = epoch.fanOut.add(source);
+        }
+        uint32_t portsPerHost = epoch.portsPerHost.estimate(sourceDestination);
+        uint32_t hostsPerPort = epoch.hostsPerPort.estimate(sourcePort);
+        if (!epoch.seenPairs.testAndSet(combine(sourceDestination, port))) {
+            portsPerHost = epoch.portsPerHost.add(sourceDestination);
+            hostsPerPort = epoch.hostsPerPort.add(sourcePort);
+        }
+        uint32_t packets = epoch.packets.add(sourceDestination);
+        uint32_t smallPackets = observation.payloadLength <= 64
+                                ? epoch.smallPackets.add(sourceDestination)
+                                : epoch.smallPackets.estimate(sourceDestination);
+
+        signals.destinationFanOut = windowEstimate(sketches, &Epoch::fanOut, source, fanOut);
+        signals.portsPerHost = windowEstimate(sketches, &Epoch::portsPerHost, sourceDestination, portsPerHost);
+        signals.hostsPerPort = windowEstimate(sketches, &Epoch::hostsPerPort, sourcePort, hostsPerPort);
+        signals.packetsToDestination = windowEstimate(sketches, &Epoch::packets, sourceDestination, packets);
+        signals.smallPacketsToDestination = windowEstimate(sketches, &Epoch::smallPackets, sourceDestination, smallPackets);
+
+        HyperLogLog& hosts = epoch.appHosts[app % APP_SLOTS];
+        HyperLogLog& ports = epoch.appPorts[app % APP_SLOTS];
+        hosts.add(destination);
+        ports.add(port);
+        signals.appDistinctHosts = hosts.estimate();
+        signals.appDistinctPorts = ports.estimate();
+
+        updateBeacon(sketches, combine(app, combine(destination, port)), observation.timestampMs, signals);
+        return signals;
+    }
+
+    void Analytics::reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        state->clear();
+    }
+
+    size_t Analytics::stateSize() const {
+        return sizeof(StateHeader) + sizeof(SketchState);
+    }
+
+    void Analytics::saveState(uint8_t* out, int64_t nowMs) {
+        auto copy = std::make_unique<SketchState>();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::memcpy(copy.get(), state.get(), sizeof(SketchState));
+        }
+        shiftTimestamps(*copy, toAge, nowMs);
+        StateHeader header{STATE_LAYOUT_VERSION, 0, sizeof(SketchState)};
+        std::memcpy(out, &header, sizeof(header));
+        std::memcpy(out + sizeof(header), copy.get(), sizeof(SketchState));
+    }
+
+    bool Analytics::restoreState(const uint8_t* in, size_t length, int64_t nowMs, int64_t elapsedMs) {
+        if (in == nullptr || length != sizeof(StateHeader) + sizeof(SketchState)) {
+            return false;
+        }
+        StateHeader header{};
+        std::memcpy(&header, in, sizeof(header));
+        if (header.layoutVersion != STATE_LAYOUT_VERSION || header.stateLength != sizeof(SketchState)) {
+            return false;
+        }
+        auto restored = std::make_unique<SketchState>();
+        std::memcpy(restored.get(), in + sizeof(header), sizeof(SketchState));
+        if (restored->current > 1) {
+            return false;
+        }
+        shiftTimestamps(*restored, fromAge, nowMs - std::max<int64_t>(elapsedMs, 0));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        state.swap(restored);
+        return true;
+    }
+
+} // namespace behavior
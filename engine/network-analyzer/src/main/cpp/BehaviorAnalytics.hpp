@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+namespace behavior {
+
+    struct Observation {
+        std::string_view sourceIp;
+        std::string_view destinationIp;
+        std::string_view appPackage;
+        int destinationPort = 0;
+        size_t payloadLength = 0;
+        int64_t timestampMs = 0;
+    };
+
+    // Window estimates derived from fixed-size sketches. Counts are approximate
+    // (count-min never under-estimates, HyperLogLog is within a few percent).
+    struct Signals {
+        uint32_t destinationFanOut = 0;     // distinct hosts contacted by the source
+        uint32_t portsPerHost = 0;          // distinct ports probed on this destination
+        uint32_t hostsPerPort = 0;          // distinct hosts probed on this port
+        uint32_t packetsToDestination = 0;
+        uint32_t smallPacketsToDestination = 0;
+        double appDistinctHosts = 0.0;
+        double appDistinctPorts = 0.0;
+        bool beaconing = false;
+        double beaconPeriodSeconds = 0.0;
+        double beaconJitter = 0.0;
+    };
+
+    struct SketchState;
+
+    class Analytics {
+    public:
+        Analytics();
+        ~Analytics();
+
+        Analytics(const Analytics&) = delete;
+        Analytics& operator=(const Analytics&) = delete;
+
+        // Updates every sketch with one packet and returns the current estimates.
+        // Memory is allocated once; per-packet cost does not depend on traffic volume.
+        Signals observe(const Observation& observation);
+
+        void reset();
+
+        // Raw sketch state for warm-start snapshots. Timestamps are stored as ages
+        // relative to `nowMs`; restore shifts them forward by `elapsedMs` of downtime.
+        // The state is prefixed with a layout version, and restore rejects state
+        // written by a build with a different sketch layout.
+        size_t stateSize() const;
+
+        void saveState(uint8_t* out, int64_t nowMs);
+
+        bool restoreState(const uint8_t* in, size_t length, int64_t nowMs, int64_t elapsedMs);
+
+    private:
+        std::mutex mutex;
+        std::unique_ptr<SketchState> state;   // ~0.4 MB, allocated once per engine
+    };
+
+} // namespace behavior
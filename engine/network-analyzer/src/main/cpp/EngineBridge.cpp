@@ -0,0 +1,69 @@
+#include <jni.h>
+#include <memory>
+#include <string>
+#include <android/log.h>
+
+#include "JniRegistration.hpp"
+#include "NetGuardEngine.hpp"
+
+#define LOG_TAG "EngineBridge"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+    jlong createEngine(JNIEnv* /* env */, jobject /* this */, jint maxTrackedSessions, jlong sessionExpirationMs,
+                       jint fastPathAfterPackets, jlong packetBudgetMicros, jint backlogBudget) {
+        EngineConfig config;
+        if (maxTrackedSessions > 0) config.maxTrackedSessions = static_cast<size_t>(maxTrackedSessions);
+        if (sessionExpirationMs > 0) config.sessionExpirationMs = sessionExpirationMs;
+        if (fastPathAfterPackets >= 0) config.fastPathAfterPackets = static_cast<uint32_t>(fastPathAfterPackets);
+        if (packetBudgetMicros > 0) config.overloadBudget.packetCostNs = packetBudgetMicros * 1000;
+        if (backlogBudget > 0) config.overloadBudget.backlogPackets = static_cast<size_t>(backlogBudget);
+        const int64_t handle = NetGuardEngine::create(config);
+        std::shared_ptr<NetGuardEngine> engine = NetGuardEngine::fromHandle(handle);
+        LOGI("Engine created: %zu sessions, %lld ms expiration, fast path after %u packets",
+             engine->config().maxTrackedSessions, static_cast<long long>(engine->config().sessionExpirationMs),
+             engine->config().fastPathAfterPackets);
+        return static_cast<jlong>(handle);
+    }
+
+    void destroyEngine(JNIEnv* /* env */, jobject /* this */, jlong handle) {
+        if (!NetGuardEngine::destroy(handle)) {
+            LOGE("Ignoring destroy of unknown engine handle: %lld", static_cast<long long>(handle));
+        }
+    }
+
+    jstring getEngineMetrics(JNIEnv* env, jobject /* this */, jlong handle) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        if (engine == nullptr) {
+            return nullptr;
+        }
+        return env->NewStringUTF(engine->metricsJson().c_str());
+    }
+
+    const JNINativeMethod ENGINE_METHODS[] = {
+            {"nativeCreateEngine", "(IJIJI)J", reinterpret_cast<void*>(createEngine)},
+            {"destroyEngine", "(J)V", reinterpret_cast<void*>(destroyEngine)},
+            {"getEngineMetrics", "(J)Ljava/lang/String;", reinterpret_cast<void*>(getEngineMetrics)},
+    };
+
+} // namespace
+
+namespace jni {
+
+    std::shared_ptr<NetGuardEngine> engineFromHandle(JNIEnv* env, jlong handle) {
+        std::shared_ptr<NetGuardEngine> engine = NetGuardEngine::fromHandle(handle);
+        if (engine == nullptr) {
+            LOGE("Invalid engine handle: %lld", static_cast<long long>(handle));
+            env->ThrowNew(illegalStateExceptionClass(), "NetGuard engine is not initialized or was destroyed");
+        }
+        return engine;
+    }
+
+    bool registerEngineNatives(JNIEnv* env, jclass bridge) {
+        return env->RegisterNatives(bridge, ENGINE_METHODS,
+                                    sizeof(ENGINE_METHODS) / sizeof(ENGINE_METHODS[0])) == JNI_OK;
+    }
+
+} // namespace jni
\ No newline at end of file
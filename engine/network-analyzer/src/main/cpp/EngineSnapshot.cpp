@@ -0,0 +1,337 @@
+#include "EngineSnapshot.hpp"
+
+#include "NetGuardEngine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace snapshot {
+
+    namespace {
+
+        constexpr uint32_t MAGIC = 0x4E53474E;      // "NGSN" little-endian
+        constexpr uint16_t FORMAT_VERSION = 1;
+        constexpr uint64_t MAX_SNAPSHOT_BYTES = 64ull * 1024 * 1024;
+        constexpr size_t MAX_KEY_LENGTH = 1024;
+
+        enum SectionType : uint32_t {
+            SECTION_SESSIONS = 1,
+            SECTION_RULES = 2,      // written by older builds; ignored on restore
+            SECTION_BEHAVIOR = 3
+        };
+
+        struct FileHeader {
+            uint32_t magic;
+            uint16_t version;
+            uint16_t headerSize;
+            uint32_t sectionCount;
+            uint32_t crc32;
+            uint64_t payloadLength;
+            int64_t createdWallMs;
+        };
+        static_assert(sizeof(FileHeader) == 32, "snapshot header layout changed");
+
+        struct SectionHeader {
+            uint32_t type;
+            uint32_t reserved;
+            uint64_t length;
+        };
+        static_assert(sizeof(SectionHeader) == 16, "snapshot section layout changed");
+
+        struct SessionEntryHeader {
+            int64_t ageMs;
+            uint64_t count;
+            uint64_t smallPayloadCount;
+            uint32_t keyLength;
+            uint32_t reserved;
+        };
+        static_assert(sizeof(SessionEntryHeader) == 32, "snapshot session layout changed");
+
+        using CrcTables = std::array<std::array<uint32_t, 256>, 8>;
+
+        // Slicing-by-8 tables. A snapshot with 100k sessions is several MB and the
+        // checksum runs on the warm-start path before anything is restored.
+        const CrcTables& crcTables() {
+            static const CrcTables tables = [] {
+                CrcTables t{};
+                for (uint32_t i = 0; i < 256; ++i) {
+                    uint32_t c = i;
+                    for (int k = 0; k < 8; ++k) {
+                        c = (c & 1u) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+                    }
+                    t[0][i] = c;
+                }
+                for (uint32_t i = 0; i < 256; ++i) {
+                    for (size_t slice = 1; slice < t.size(); ++slice) {
+                        t[slice][i] = (t[slice - 1][i] >> 8) ^ t[0][t[slice - 1][i] & 0xFFu];
+                    }
+                }
+                return t;
+            }();
+            return tables;
+        }
+
+        uint32_t crc32(const uint8_t* data, size_t length) {
+            const auto& t = crcTables();
+            uint32_t crc = 0xFFFFFFFFu;
+            for (; length >= 8; data += 8, length -= 8) {
+                const uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+                                            static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24);
+                crc = t[7][low & 0xFFu] ^ t[6][(low >> 8) & 0xFFu] ^ t[5][(low >> 16) & 0xFFu] ^ t[4][low >> 24] ^
+                      t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+            }
+            for (; length > 0; ++data, --length) {
+                crc = t[0][(crc ^ *data) & 0xFFu] ^ (crc >> 8);
+            }
+            return crc ^ 0xFFFFFFFFu;
+        }
+
+        int64_t steadyNowMs() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        int64_t wallNowMs() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        size_t padded(size_t length) {
+            return (length + 7u) & ~static_cast<size_t>(7u);
+        }
+
+        struct Writer {
+            std::vector<uint8_t> buffer;
+
+            void put(const void* data, size_t length) {
+                const uint8_t* bytes = static_cast<const uint8_t*>(data);
+                buffer.insert(buffer.end(), bytes, bytes + length);
+            }
+
+            template <typename T>
+            void put(const T& value) {
+                put(&value, sizeof(T));
+            }
+
+            void align() {
+                buffer.resize(padded(buffer.size()), 0);
+            }
+
+            size_t beginSection(uint32_t type) {
+                size_t offset = buffer.size();
+                SectionHeader header{type, 0, 0};
+                put(header);
+                return offset;
+            }
+
+            void endSection(size_t offset) {
+                uint64_t length = buffer.size() - offset - sizeof(SectionHeader);
+                std::memcpy(buffer.data() + offset + offsetof(SectionHeader, length), &length, sizeof(length));
+                align();
+            }
+        };
+
+        struct Cursor {
+            const uint8_t* data;
+            size_t length;
+            size_t offset = 0;
+
+            bool read(void* out, size_t n) {
+                if (length - offset < n) return false;
+                std::memcpy(out, data + offset, n);
+                offset += n;
+                return true;
+            }
+
+            template <typename T>
+            bool read(T& out) {
+                return read(&out, sizeof(T));
+            }
+
+            const uint8_t* take(size_t n) {
+                if (length - offset < n) return nullptr;
+                const uint8_t* ptr = data + offset;
+                offset += n;
+                return ptr;
+            }
+        };
+
+        bool parseSessions(Cursor section, std::vector<SessionRecord>& out) {
+            uint64_t count = 0;
+            if (!section.read(count)) return false;
+            if (count > section.length / sizeof(SessionEntryHeader)) return false;
+            out.reserve(static_cast<size_t>(count));
+            for (uint64_t i = 0; i < count; ++i) {
+                SessionEntryHeader entry{};
+                if (!section.read(entry) || entry.keyLength > MAX_KEY_LENGTH) return false;
+                const uint8_t* key = section.take(padded(entry.keyLength));
+                if (key == nullptr) return false;
+                SessionRecord record;
+                record.key.assign(reinterpret_cast<const char*>(key), entry.keyLength);
+                record.ageMs = entry.ageMs;
+                record.count = entry.count;
+                record.smallPayloadCount = entry.smallPayloadCount;
+                out.push_back(std::move(record));
+            }
+            return true;
+        }
+
+        bool writeFully(int fd, const uint8_t* data, size_t length) {
+            while (length > 0) {
+                ssize_t written = ::write(fd, data, length);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                data += written;
+                length -= static_cast<size_t>(written);
+            }
+            return true;
+        }
+
+    } // namespace
+
+    bool save(NetGuardEngine& engine, const std::string& path) {
+        Writer writer;
+        writer.buffer.resize(sizeof(FileHeader), 0);
+        const int64_t now = steadyNowMs();
+
+        std::vector<SessionRecord> sessions = engine.analyzer().exportSessions();
+        size_t offset = writer.beginSection(SECTION_SESSIONS);
+        writer.put(static_cast<uint64_t>(sessions.size()));
+        for (const auto& record : sessions) {
+            SessionEntryHeader entry{record.ageMs, record.count, record.smallPayloadCount,
+                                     static_cast<uint32_t>(record.key.size()), 0};
+            writer.put(entry);
+            writer.put(record.key.data(), record.key.size());
+            writer.align();
+        }
+        writer.endSection(offset);
+
+        offset = writer.beginSection(SECTION_BEHAVIOR);
+        size_t behaviorOffset = writer.buffer.size();
+        behavior::Analytics& analytics = engine.behaviorAnalytics();
+        writer.buffer.resize(behaviorOffset + analytics.stateSize());
+        analytics.saveState(writer.buffer.data() + behaviorOffset, now);
+        writer.endSection(offset);
+
+        FileHeader header{};
+        header.magic = MAGIC;
+        header.version = FORMAT_VERSION;
+        header.headerSize = sizeof(FileHeader);
+        header.sectionCount = 2;
+        header.payloadLength = writer.buffer.size() - sizeof(FileHeader);
+        header.crc32 = crc32(writer.buffer.data() + sizeof(FileHeader), static_cast<size_t>(header.payloadLength));
+        header.createdWallMs = wallNowMs();
+        std::memcpy(writer.buffer.data(), &header, sizeof(header));
+
+        const std::string temporary = path + ".tmp";
+        int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = writeFully(fd, writer.buffer.data(), writer.buffer.size()) && ::fsync(fd) == 0;
+        ok = ::close(fd) == 0 && ok;
+        if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+            ::unlink(temporary.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    RestoreStatus restore(NetGuardEngine& engine, const std::string& path, RestoreStats& stats) {
+        stats = RestoreStats{};
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return RestoreStatus::Missing;
+        }
+
+        struct stat info{};
+        if (::fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(FileHeader)) ||
+            static_cast<uint64_t>(info.st_size) > MAX_SNAPSHOT_BYTES) {
+            ::close(fd);
+            return RestoreStatus::Corrupt;
+        }
+
+        const size_t fileSize = static_cast<size_t>(info.st_size);
+        void* mapped = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            return RestoreStatus::Corrupt;
+        }
+        const uint8_t* base = static_cast<const uint8_t*>(mapped);
+
+        RestoreStatus status = RestoreStatus::Corrupt;
+        FileHeader header{};
+        std::memcpy(&header, base, sizeof(header));
+
+        std::vector<SessionRecord> sessions;
+        const uint8_t* behaviorState = nullptr;
+        size_t behaviorLength = 0;
+
+        do {
+            if (header.magic != MAGIC || header.headerSize != sizeof(FileHeader)) break;
+            if (header.version != FORMAT_VERSION) {
+                status = RestoreStatus::IncompatibleVersion;
+                break;
+            }
+            if (header.payloadLength != fileSize - sizeof(FileHeader)) break;
+            const uint8_t* payload = base + sizeof(FileHeader);
+            if (crc32(payload, static_cast<size_t>(header.payloadLength)) != header.crc32) break;
+
+            Cursor cursor{payload, static_cast<size_t>(header.payloadLength)};
+            bool valid = true;
+            for (uint32_t i = 0; i < header.sectionCount && valid; ++i) {
+                SectionHeader section{};
+                if (!cursor.read(section) || section.length > cursor.length - cursor.offset) {
+                    valid = false;
+                    break;
+                }
+                const uint8_t* body = cursor.take(padded(static_cast<size_t>(section.length)));
+                if (body == nullptr) {
+                    valid = false;
+                    break;
+                }
+                Cursor sectionCursor{body, static_cast<size_t>(section.length)};
+                switch (section.type) {
+                    case SECTION_SESSIONS:
+                        valid = parseSessions(sectionCursor, sessions);
+                        break;
+                    case SECTION_RULES:
+                        break;   // stale by definition: rules are re-pushed from the app's store
+                    case SECTION_BEHAVIOR:
+                        behaviorState = body;
+                        behaviorLength = static_cast<size_t>(section.length);
+                        break;
+                    default:
+                        break;   // Unknown sections from newer minor revisions are skipped.
+                }
+            }
+            if (!valid) break;
+
+            const int64_t elapsed = std::max<int64_t>(wallNowMs() - header.createdWallMs, 0);
+            stats.sessions = engine.analyzer().restoreSessions(std::move(sessions), elapsed);
+            if (behaviorState != nullptr) {
+                stats.behavior = engine.behaviorAnalytics().restoreState(
+                        behaviorState, behaviorLength, steadyNowMs(), elapsed);
+            }
+            status = RestoreStatus::Restored;
+        } while (false);
+
+        ::munmap(mapped, fileSize);
+        return status;
+    }
+
+} // namespace snapshot
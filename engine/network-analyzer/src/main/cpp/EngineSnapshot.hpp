@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+class NetGuardEngine;
+
+namespace snapshot {
+
+    enum class RestoreStatus {
+        Restored,
+        Missing,
+        Corrupt,
+        IncompatibleVersion
+    };
+
+    struct RestoreStats {
+        size_t sessions = 0;
+        bool behavior = false;
+    };
+
+    // Writes the engine's flow table and behavior sketches to `path` atomically
+    // (temporary file + rename). Firewall rules are not included: the app's rule
+    // store is their source of truth and is pushed again after every restore.
+    bool save(NetGuardEngine& engine, const std::string& path);
+
+    // Maps `path` read-only, validates header and CRC and restores every section
+    // it understands. Nothing is applied unless the whole file validates.
+    RestoreStatus restore(NetGuardEngine& engine, const std::string& path, RestoreStats& stats);
+
+} // namespace snapshot
@@ -0,0 +1,87 @@
+#include <jni.h>
+#include <memory>
+#include <string>
+#include <android/log.h>
+
+#include "FlowExporter.hpp"
+#include "JniRegistration.hpp"
+#include "NetGuardEngine.hpp"
+
+#define LOG_TAG "ExportBridge"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+    bool readString(JNIEnv* env, jstring value, std::string& out) {
+        if (value == nullptr) {
+            return false;
+        }
+        const char* chars = env->GetStringUTFChars(value, nullptr);
+        if (chars == nullptr) {
+            return false;
+        }
+        out.assign(chars);
+        env->ReleaseStringUTFChars(value, chars);
+        return true;
+    }
+
+    jboolean startFlowExport(
+            JNIEnv* env,
+            jobject /* this */,
+            jlong handle,
+            jstring target,
+            jboolean netflowV9,
+            jint activeTimeoutSeconds,
+            jint idleTimeoutSeconds
+    ) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        flowexport::ExportConfig config;
+        if (engine == nullptr || !readString(env, target, config.target)) {
+            return JNI_FALSE;
+        }
+        config.format = netflowV9 == JNI_TRUE ? flowexport::Format::NetflowV9 : flowexport::Format::Ipfix;
+        if (activeTimeoutSeconds > 0) config.activeTimeoutMs = static_cast<int64_t>(activeTimeoutSeconds) * 1000;
+        if (idleTimeoutSeconds > 0) config.idleTimeoutMs = static_cast<int64_t>(idleTimeoutSeconds) * 1000;
+
+        if (!engine->flowExporter().start(config)) {
+            LOGE("Unable to open flow export target: %s", config.target.c_str());
+            return JNI_FALSE;
+        }
+        LOGI("Flow export started: %s to %s, active %lld ms, idle %lld ms",
+             config.format == flowexport::Format::Ipfix ? "IPFIX" : "NetFlow v9", config.target.c_str(),
+             static_cast<long long>(config.activeTimeoutMs), static_cast<long long>(config.idleTimeoutMs));
+        return JNI_TRUE;
+    }
+
+    void stopFlowExport(JNIEnv* env, jobject /* this */, jlong handle) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        if (engine != nullptr) {
+            engine->flowExporter().stop();
+        }
+    }
+
+    void setFlowOwnerUid(JNIEnv* env, jobject /* this */, jlong handle, jstring packageName, jint uid) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        std::string name;
+        if (engine != nullptr && readString(env, packageName, name)) {
+            engine->flowExporter().setOwnerUid(name, static_cast<int32_t>(uid));
+        }
+    }
+
+    const JNINativeMethod EXPORT_METHODS[] = {
+            {"startFlowExport", "(JLjava/lang/String;ZII)Z", reinterpret_cast<void*>(startFlowExport)},
+            {"stopFlowExport", "(J)V", reinterpret_cast<void*>(stopFlowExport)},
+            {"setFlowOwnerUid", "(JLjava/lang/String;I)V", reinterpret_cast<void*>(setFlowOwnerUid)},
+    };
+
+} // namespace
+
+namespace jni {
+
+    bool registerExportNatives(JNIEnv* env, jclass bridge) {
+        return env->RegisterNatives(bridge, EXPORT_METHODS,
+                                    sizeof(EXPORT_METHODS) / sizeof(EXPORT_METHODS[0])) == JNI_OK;
+    }
+
+} // namespace jni
\ No newline at end of file
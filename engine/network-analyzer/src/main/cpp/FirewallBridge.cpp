@@ -2,33 +2,86 @@
 // Created by Cardiell on 12/10/25.
 //
 #include <jni.h>
+#include <memory>
 #include <string>
+#include <vector>
 #include <android/log.h>
 
-#include "FirewallController.hpp"
+#include "JniRegistration.hpp"
+#include "NetGuardEngine.hpp"
 
 #define LOG_TAG "FirewallBridge"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 
-extern "C" {
-
-JNIEXPORT void JNICALL
-Java_com_clsoft_netguard_engine_network_analyzer_NativeBridge_applyFirewallRule(
-        JNIEnv* env,
-        jobject /* this */,
-        jstring packageName,
-        jboolean allow
-) {
-    const char* pkgChars = env->GetStringUTFChars(packageName, nullptr);
-    if (pkgChars == nullptr) {
-        return;
+namespace {
+
+    void applyFirewallRule(
+            JNIEnv* env,
+            jobject /* this */,
+            jlong handle,
+            jstring packageName,
+            jboolean allow
+    ) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        if (engine == nullptr || packageName == nullptr) {
+            return;
+        }
+
+        const char* pkgChars = env->GetStringUTFChars(packageName, nullptr);
+        if (pkgChars == nullptr) {
+            return;
+        }
+
+        std::string pkg(pkgChars);
+        env->ReleaseStringUTFChars(packageName, pkgChars);
+
+        engine->rules().setRule(pkg, allow);
+        LOGI("Firewall rule applied: %s -> %s", pkg.c_str(), allow ? "ALLOW" : "BLOCK");
     }
 
-    std::string pkg(pkgChars);
-    env->ReleaseStringUTFChars(packageName, pkgChars);
+    void replaceFirewallRules(
+            JNIEnv* env,
+            jobject /* this */,
+            jlong handle,
+            jobjectArray blockedPackages
+    ) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        if (engine == nullptr || blockedPackages == nullptr) {
+            return;
+        }
+
+        const jsize count = env->GetArrayLength(blockedPackages);
+        std::vector<std::string> packages;
+        packages.reserve(static_cast<size_t>(count));
+        for (jsize i = 0; i < count; ++i) {
+            auto name = static_cast<jstring>(env->GetObjectArrayElement(blockedPackages, i));
+            if (name == nullptr) {
+                continue;
+            }
+            const char* nameChars = env->GetStringUTFChars(name, nullptr);
+            if (nameChars != nullptr) {
+                packages.emplace_back(nameChars);
+                env->ReleaseStringUTFChars(name, nameChars);
+            }
+            env->DeleteLocalRef(name);
+        }
 
-    firewall::setRule(pkg, allow);
-    LOGI("Firewall rule applied: %s -> %s", pkg.c_str(), allow ? "ALLOW" : "BLOCK");
-}
+        engine->rules().replaceBlocked(packages);
+        LOGI("Firewall rules replaced: %zu blocked packages", packages.size());
+    }
+
+    const JNINativeMethod FIREWALL_METHODS[] = {
+            {"applyFirewallRule", "(JLjava/lang/String;Z)V", reinterpret_cast<void*>(applyFirewallRule)},
+            {"replaceFirewallRules", "(J[Ljava/lang/String;)V", reinterpret_cast<void*>(replaceFirewallRules)},
+    };
+
+} // namespace
+
+namespace jni {
+
+    bool registerFirewallNatives(JNIEnv* env, jclass bridge) {
+        return env->RegisterNatives(bridge, FIREWALL_METHODS,
+                                    sizeof(FIREWALL_METHODS) / sizeof(FIREWALL_METHODS[0])) == JNI_OK;
+    }
 
-}
\ No newline at end of file
+} // namespace jni
\ No newline at end of file
@@ -1,42 +1,55 @@
 #include "FirewallController.hpp"
 
-#include <mutex>
-#include <unordered_map>
-
 namespace firewall {
 
-    namespace {
-        std::mutex gMutex;
-        std::unordered_map<std::string, bool> gRules;
-    }
-
-    void setRule(const std::string& packageName, bool allow) {
+    void RuleSet::setRule(const std::string& packageName, bool allow) {
         if (packageName.empty()) {
             return;
         }
-        std::lock_guard<std::mutex> lock(gMutex);
+        std::lock_guard<std::mutex> lock(mutex);
         if (allow) {
-            gRules.erase(packageName);
+            rules.erase(packageName);
         } else {
-            gRules[packageName] = false;
+            rules[packageName] = false;
         }
+        changes.fetch_add(1, std::memory_order_release);
     }
 
-    bool isAllowed(const std::string& packageName) {
+    bool RuleSet::isAllowed(const std::string& packageName) const {
         if (packageName.empty()) {
             return true;
         }
-        std::lock_guard<std::mutex> lock(gMutex);
-        const auto it = gRules.find(packageName);
-        if (it == gRules.end()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto it = rules.find(packageName);
+        if (it == rules.end()) {
             return true;
         }
         return it->second;
     }
 
-    void clearAll() {
-        std::lock_guard<std::mutex> lock(gMutex);
-        gRules.clear();
+    void RuleSet::clearAll() {
+        std::lock_guard<std::mutex> lock(mutex);
+        rules.clear();
+        changes.fetch_add(1, std::memory_order_release);
+    }
+
+    std::vector<std::string> RuleSet::blockedPackages() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::string> packages;
+        packages.reserve(rules.size());
+        for (const auto& [packageName, allow] : rules) {
+            if (!allow) packages.push_back(packageName);
+        }
+        return packages;
+    }
+
+    void RuleSet::replaceBlocked(const std::vector<std::string>& packageNames) {
+        std::lock_guard<std::mutex> lock(mutex);
+        rules.clear();
+        for (const auto& packageName : packageNames) {
+            if (!packageName.empty()) rules.emplace(packageName, false);
+        }
+        changes.fetch_add(1, std::memory_order_release);
     }
 
 } // namespace firewall
\ No newline at end of file
@@ -1,13 +1,34 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace firewall {
 
-    void setRule(const std::string& packageName, bool allow);
+    class RuleSet {
+    public:
+        void setRule(const std::string& packageName, bool allow);
 
-    bool isAllowed(const std::string& packageName);
+        bool isAllowed(const std::string& packageName) const;
 
-    void clearAll();
+        void clearAll();
+
+        std::vector<std::string> blockedPackages() const;
+
+        // Makes `packageNames` the complete set of blocked packages.
+        void replaceBlocked(const std::vector<std::string>& packageNames);
+
+        // Increments on every change so cached per-flow verdicts can be dropped.
+        uint64_t generation() const { return changes.load(std::memory_order_acquire); }
+
+    private:
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, bool> rules;
+        std::atomic<uint64_t> changes{0};
+    };
 
 } // namespace firewall
\ No newline at end of file
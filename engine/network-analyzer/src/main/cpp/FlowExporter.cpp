@@ -0,0 +1,545 @@
+#include "FlowExporter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace flowexport {
+
+    namespace {
+
+        constexpr uint16_t TEMPLATE_IPV4 = 256;
+        constexpr uint16_t TEMPLATE_IPV6 = 257;
+        constexpr uint16_t IPFIX_TEMPLATE_SET = 2;
+        constexpr uint16_t V9_TEMPLATE_FLOWSET = 0;
+        constexpr size_t IPFIX_HEADER = 16;
+        constexpr size_t V9_HEADER = 20;
+        constexpr size_t SET_HEADER = 4;
+        constexpr size_t MIN_MESSAGE_BYTES = 512;
+        constexpr size_t MAX_MESSAGE_BYTES = 65000;
+        constexpr int64_t SWEEP_INTERVAL_MS = 1000;
+        constexpr size_t QUEUED_MESSAGES_RESERVED = 16;
+        constexpr size_t MAX_QUEUED_BYTES = 1u << 20;   // a full drain of the table fits
+        constexpr int64_t TCP_END_GRACE_MS = 2000;   // lets the last ACKs of a closing flow land in it
+        constexpr uint8_t TCP_FIN = 0x01;
+        constexpr uint8_t TCP_RST = 0x04;
+        constexpr uint16_t ENTERPRISE_BIT = 0x8000;
+
+        // NetGuard information elements, numbered under ENTERPRISE_NUMBER. NetFlow
+        // v9 has no enterprise numbers, so there they are sent with the high bit
+        // set, like IPFIX enterprise IDs on the wire.
+        constexpr uint16_t IE_APP_PACKAGE = 1;
+        constexpr uint16_t IE_APP_UID = 2;
+        constexpr uint16_t IE_RISK_SCORE = 3;
+        constexpr uint16_t IE_RISK_LABEL = 4;
+        constexpr uint16_t IE_BLOCK_REASON = 5;
+
+        struct FieldSpec {
+            uint16_t id;
+            uint16_t length;
+            bool enterprise;
+        };
+
+        constexpr size_t TEMPLATE_FIELDS = 16;
+        using FieldList = std::array<FieldSpec, TEMPLATE_FIELDS>;
+
+        // Template layout; encodeRecord() writes the fields in exactly this order.
+        FieldList templateFields(Format format, uint8_t family) {
+            const bool v4 = family == 4;
+            const bool ipfix = format == Format::Ipfix;
+            const uint16_t addressLength = v4 ? 4 : 16;
+            const uint16_t timeLength = ipfix ? 8 : 4;
+            return {{
+                    {static_cast<uint16_t>(v4 ? 8 : 27), addressLength, false},     // sourceIPv4/IPv6Address
+                    {static_cast<uint16_t>(v4 ? 12 : 28), addressLength, false},    // destinationIPv4/IPv6Address
+                    {7, 2, false},                                                  // sourceTransportPort
+                    {11, 2, false},                                                 // destinationTransportPort
+                    {4, 1, false},                                                  // protocolIdentifier
+                    {6, 1, false},                                                  // tcpControlBits (reduced size)
+                    {2, 8, false},                                                  // packetDeltaCount
+                    {1, 8, false},                                                  // octetDeltaCount
+                    {static_cast<uint16_t>(ipfix ? 152 : 22), timeLength, false},   // flowStartMilliseconds / FIRST_SWITCHED
+                    {static_cast<uint16_t>(ipfix ? 153 : 21), timeLength, false},   // flowEndMilliseconds / LAST_SWITCHED
+                    {136, 1, false},                                                // flowEndReason
+                    {IE_APP_PACKAGE, static_cast<uint16_t>(PACKAGE_FIELD_BYTES), true},
+                    {IE_APP_UID, 4, true},
+                    {IE_RISK_SCORE, 1, true},
+                    {IE_RISK_LABEL, 1, true},
+                    {IE_BLOCK_REASON, 1, true},
+            }};
+        }
+
+        size_t recordLength(Format format, uint8_t family) {
+            size_t total = 0;
+            for (const FieldSpec& field : templateFields(format, family)) {
+                total += field.length;
+            }
+            return total;
+        }
+
+        int64_t steadyNowMs() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        int64_t wallNowMs() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        uint64_t hashPackage(const char* name, size_t len) {
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (size_t i = 0; i < len; ++i) {
+                hash ^= static_cast<unsigned char>(name[i]);
+                hash *= 0x100000001b3ull;
+            }
+            return hash;
+        }
+
+        uint8_t* put8(uint8_t* p, uint8_t v) {
+            *p = v;
+            return p + 1;
+        }
+
+        uint8_t* put16(uint8_t* p, uint16_t v) {
+            p[0] = static_cast<uint8_t>(v >> 8);
+            p[1] = static_cast<uint8_t>(v);
+            return p + 2;
+        }
+
+        uint8_t* put32(uint8_t* p, uint32_t v) {
+            p[0] = static_cast<uint8_t>(v >> 24);
+            p[1] = static_cast<uint8_t>(v >> 16);
+            p[2] = static_cast<uint8_t>(v >> 8);
+            p[3] = static_cast<uint8_t>(v);
+            return p + 4;
+        }
+
+        uint8_t* put64(uint8_t* p, uint64_t v) {
+            return put32(put32(p, static_cast<uint32_t>(v >> 32)), static_cast<uint32_t>(v));
+        }
+
+        // "udp://host:port" ([v6] hosts allowed) or a file opened for appending.
+        int openTarget(const std::string& target, bool& datagram) {
+            static const std::string UDP_SCHEME = "udp://";
+            datagram = target.compare(0, UDP_SCHEME.size(), UDP_SCHEME) == 0;
+            if (!datagram) {
+                return target.empty() ? -1 : ::open(target.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+            }
+
+            std::string hostPort = target.substr(UDP_SCHEME.size());
+            std::string host;
+            std::string port;
+            if (!hostPort.empty() && hostPort[0] == '[') {
+                size_t close = hostPort.find(']');
+                if (close == std::string::npos || close + 1 >= hostPort.size() || hostPort[close + 1] != ':') return -1;
+                host = hostPort.substr(1, close - 1);
+                port = hostPort.substr(close + 2);
+            } else {
+                size_t colon = hostPort.rfind(':');
+                if (colon == std::string::npos) return -1;
+                host = hostPort.substr(0, colon);
+                port = hostPort.substr(colon + 1);
+            }
+
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_DGRAM;
+            addrinfo* resolved = nullptr;
+            if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &resolved) != 0 || resolved == nullptr) {
+                return -1;
+            }
+            int fd = ::socket(resolved->ai_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+            if (fd >= 0 && ::connect(fd, resolved->ai_addr, resolved->ai_addrlen) != 0) {
+                ::close(fd);
+                fd = -1;
+            }
+            ::freeaddrinfo(resolved);
+            return fd;
+        }
+
+    } // namespace
+
+    Exporter::~Exporter() {
+        stop();
+    }
+
+    bool Exporter::start(const ExportConfig& requested) {
+        stop();
+
+        bool isDatagram = false;
+        int fd = openTarget(requested.target, isDatagram);
+        if (fd < 0) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        config = requested;
+        config.maxMessageBytes = std::min(std::max(config.maxMessageBytes, MIN_MESSAGE_BYTES), MAX_MESSAGE_BYTES);
+        if (config.activeTimeoutMs <= 0) config.activeTimeoutMs = ExportConfig{}.activeTimeoutMs;
+        if (config.idleTimeoutMs <= 0) config.idleTimeoutMs = ExportConfig{}.idleTimeoutMs;
+        outputFd = fd;
+        datagram = isDatagram;
+        flows.assign(FLOW_SLOTS, Flow{});
+        message.assign(config.maxMessageBytes, 0);
+        for (auto* buffer : {&queued, &sending}) {
+            buffer->clear();
+            buffer->reserve(config.maxMessageBytes * QUEUED_MESSAGES_RESERVED);
+        }
+        for (auto* lengths : {&queuedLengths, &sendingLengths}) {
+            lengths->clear();
+            lengths->reserve(QUEUED_MESSAGES_RESERVED);
+        }
+        messageLength = 0;
+        openSetId = 0;
+        sequence = 0;
+        templatesSent = false;
+        counters = ExportStats{};
+        startedSteadyMs = steadyNowMs();
+        wallOffsetMs = wallNowMs() - startedSteadyMs;
+        stopping = false;
+        worker = std::thread(&Exporter::run, this);
+        active.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void Exporter::stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!worker.joinable()) {
+                return;
+            }
+            stopping = true;
+            active.store(false, std::memory_order_release);
+        }
+        wakeup.notify_all();
+        worker.join();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        shutdownLocked();
+    }
+
+    void Exporter::setOwnerUid(const std::string& packageName, int32_t uid) {
+        const size_t length = std::min(packageName.size(), PACKAGE_FIELD_BYTES);
+        std::lock_guard<std::mutex> lock(mutex);
+        ownerUids[hashPackage(packageName.data(), length)] = uid;
+    }
+
+    ExportStats Exporter::stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return counters;
+    }
+
+    void Exporter::account(const uint8_t* data, const conntrack::PacketHeader& header, const std::string& packageName,
+                           conntrack::RiskLabel label, double score, BlockReason blockReason, int64_t nowMs) {
+        if (!active.load(std::memory_order_relaxed)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (flows.empty()) {
+            return;
+        }
+
+        Flow& flow = flows[header.flowKey % FLOW_SLOTS];
+        if (flow.key != header.flowKey) {
+            if (flow.key != 0) {
+                if (flow.packets > 0) emitLocked(flow, EndReason::LackOfResources, nowMs);
+                counters.evicted++;
+            }
+            flow = Flow{};
+            flow.key = header.flowKey;
+            flow.family = static_cast<uint8_t>(data[0] >> 4);
+            if (flow.family == 4) {
+                std::memcpy(flow.src, data + 12, 4);
+                std::memcpy(flow.dst, data + 16, 4);
+            } else {
+                std::memcpy(flow.src, data + 8, 16);
+                std::memcpy(flow.dst, data + 24, 16);
+            }
+            flow.srcPort = header.srcPort;
+            flow.dstPort = header.dstPort;
+            flow.protocol = header.protocol;
+            const size_t length = std::min(packageName.size(), PACKAGE_FIELD_BYTES);
+            std::memcpy(flow.package, packageName.data(), length);
+            flow.packageHash = length > 0 ? hashPackage(packageName.data(), length) : 0;
+        }
+
+        if (flow.packets == 0) {
+            flow.firstMs = nowMs;   // new flow, or the first packet after an active-timeout export
+        }
+        flow.packets++;
+        flow.bytes += header.length;
+        flow.lastMs = nowMs;
+        flow.tcpFlags |= header.tcpFlags;
+        const auto scaled = static_cast<uint8_t>(std::lround(std::min(std::max(score, 0.0), 1.0) * 100.0));
+        flow.riskScore = std::max(flow.riskScore, scaled);
+        flow.riskLabel = std::max(flow.riskLabel, static_cast<uint8_t>(label));
+        if (blockReason != BlockReason::None) {
+            flow.blockReason = static_cast<uint8_t>(blockReason);
+        }
+    }
+
+    void Exporter::run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        int64_t nextSweepMs = steadyNowMs() + SWEEP_INTERVAL_MS;
+        while (!stopping) {
+            const int64_t waitMs = std::max<int64_t>(nextSweepMs - steadyNowMs(), 0);
+            wakeup.wait_for(lock, std::chrono::milliseconds(waitMs),
+                            [this] { return stopping || !queuedLengths.empty(); });
+            if (stopping) {
+                break;
+            }
+            const int64_t nowMs = steadyNowMs();
+            if (nowMs >= nextSweepMs) {
+                sweepLocked(nowMs, false);
+                nextSweepMs = nowMs + SWEEP_INTERVAL_MS;
+            }
+            sendQueued(lock);
+        }
+    }
+
+    // Writes the queued messages with the lock released. Only the expiry thread
+    // calls this, and start()/stop() join that thread before touching the target.
+    void Exporter::sendQueued(std::unique_lock<std::mutex>& lock) {
+        if (queuedLengths.empty()) {
+            return;
+        }
+        sending.swap(queued);
+        sendingLengths.swap(queuedLengths);
+        lock.unlock();
+        const size_t written = writeMessages(sending, sendingLengths);
+        lock.lock();
+        counters.messages += written;
+        counters.errors += sendingLengths.size() - written;
+        sending.clear();
+        sendingLengths.clear();
+    }
+
+    size_t Exporter::writeMessages(const std::vector<uint8_t>& bytes, const std::vector<uint32_t>& lengths) {
+        size_t written = 0;
+        const uint8_t* data = bytes.data();
+        for (uint32_t length : lengths) {
+            bool ok = true;
+            if (datagram) {
+                // A full socket buffer drops the datagram instead of blocking the thread.
+                ok = ::send(outputFd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL) == static_cast<ssize_t>(length);
+            } else {
+                size_t offset = 0;
+                while (offset < length) {
+                    ssize_t n = ::write(outputFd, data + offset, length - offset);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) {
+                        ok = false;
+                        break;
+                    }
+                    offset += static_cast<size_t>(n);
+                }
+            }
+            if (ok) written++;
+            data += length;
+        }
+        return written;
+    }
+
+    void Exporter::sweepLocked(int64_t nowMs, bool drain) {
+        for (Flow& flow : flows) {
+            if (flow.key == 0) {
+                continue;
+            }
+            EndReason reason;
+            bool expire = true;
+            if (drain) {
+                reason = EndReason::ForcedEnd;
+            } else if (nowMs - flow.lastMs >= config.idleTimeoutMs) {
+                reason = EndReason::IdleTimeout;
+            } else if ((flow.tcpFlags & (TCP_FIN | TCP_RST)) != 0 && nowMs - flow.lastMs >= TCP_END_GRACE_MS) {
+                reason = EndReason::EndOfFlow;
+            } else if (flow.packets > 0 && nowMs - flow.firstMs >= config.activeTimeoutMs) {
+                reason = EndReason::ActiveTimeout;
+                expire = false;
+            } else {
+                continue;
+            }
+
+            if (flow.packets > 0) {
+                emitLocked(flow, reason, nowMs);
+            }
+            if (expire) {
+                flow = Flow{};
+            } else {
+                flow.packets = 0;
+                flow.bytes = 0;
+                flow.tcpFlags = 0;
+            }
+        }
+        if (messageLength != 0 && (drain || nowMs - messageOpenedMs >= config.flushIntervalMs)) {
+            flushLocked(nowMs);
+        }
+    }
+
+    void Exporter::emitLocked(const Flow& flow, EndReason reason, int64_t nowMs) {
+        const uint16_t templateId = flow.family == 4 ? TEMPLATE_IPV4 : TEMPLATE_IPV6;
+        const size_t length = recordLength(config.format, flow.family);
+        const size_t needed = length + (openSetId != templateId ? SET_HEADER : 0) + 3;   // + v9 padding
+        if (messageLength != 0 && messageLength + needed > message.size()) {
+            flushLocked(nowMs);
+        }
+        if (messageLength == 0) {
+            beginMessageLocked(nowMs);
+        }
+        if (openSetId != templateId) {
+            closeSetLocked();
+            setStart = messageLength;
+            put16(message.data() + messageLength, templateId);
+            messageLength += SET_HEADER;
+            openSetId = templateId;
+        }
+
+        const size_t addressLength = flow.family == 4 ? 4 : 16;
+        uint8_t* p = message.data() + messageLength;
+        std::memcpy(p, flow.src, addressLength);
+        p += addressLength;
+        std::memcpy(p, flow.dst, addressLength);
+        p += addressLength;
+        p = put16(p, flow.srcPort);
+        p = put16(p, flow.dstPort);
+        p = put8(p, flow.protocol);
+        p = put8(p, flow.tcpFlags);
+        p = put64(p, flow.packets);
+        p = put64(p, flow.bytes);
+        if (config.format == Format::Ipfix) {
+            p = put64(p, static_cast<uint64_t>(flow.firstMs + wallOffsetMs));
+            p = put64(p, static_cast<uint64_t>(flow.lastMs + wallOffsetMs));
+        } else {
+            p = put32(p, static_cast<uint32_t>(flow.firstMs - startedSteadyMs));
+            p = put32(p, static_cast<uint32_t>(flow.lastMs - startedSteadyMs));
+        }
+        p = put8(p, static_cast<uint8_t>(reason));
+        std::memcpy(p, flow.package, PACKAGE_FIELD_BYTES);
+        p += PACKAGE_FIELD_BYTES;
+        int32_t uid = -1;
+        if (flow.packageHash != 0) {
+            auto owner = ownerUids.find(flow.packageHash);
+            if (owner != ownerUids.end()) uid = owner->second;
+        }
+        p = put32(p, static_cast<uint32_t>(uid));
+        p = put8(p, flow.riskScore);
+        p = put8(p, flow.riskLabel);
+        p = put8(p, flow.blockReason);
+        messageLength += length;
+        messageRecords++;
+        counters.records++;
+    }
+
+    void Exporter::beginMessageLocked(int64_t nowMs) {
+        messageLength = config.format == Format::Ipfix ? IPFIX_HEADER : V9_HEADER;
+        messageRecords = 0;
+        messageTemplates = 0;
+        messageOpenedMs = nowMs;
+        openSetId = 0;
+        if (!templatesSent || (datagram && nowMs - templatesSentMs >= config.templateRefreshMs)) {
+            appendTemplatesLocked();
+            templatesSent = true;
+            templatesSentMs = nowMs;
+        }
+    }
+
+    void Exporter::appendTemplatesLocked() {
+        const bool ipfix = config.format == Format::Ipfix;
+        const size_t start = messageLength;
+        uint8_t* p = put16(message.data() + start, ipfix ? IPFIX_TEMPLATE_SET : V9_TEMPLATE_FLOWSET);
+        p += 2;   // length, written below
+        for (uint8_t family : {static_cast<uint8_t>(4), static_cast<uint8_t>(6)}) {
+            const FieldList fields = templateFields(config.format, family);
+            p = put16(p, family == 4 ? TEMPLATE_IPV4 : TEMPLATE_IPV6);
+            p = put16(p, static_cast<uint16_t>(fields.size()));
+            for (const FieldSpec& field : fields) {
+                p = put16(p, field.enterprise ? static_cast<uint16_t>(field.id | ENTERPRISE_BIT) : field.id);
+                p = put16(p, field.length);
+                if (ipfix && field.enterprise) {
+                    p = put32(p, ENTERPRISE_NUMBER);
+                }
+            }
+            messageTemplates++;
+        }
+        messageLength = static_cast<size_t>(p - message.data());
+        put16(message.data() + start + 2, static_cast<uint16_t>(messageLength - start));
+    }
+
+    void Exporter::closeSetLocked() {
+        if (openSetId == 0) {
+            return;
+        }
+        if (config.format == Format::NetflowV9) {
+            while ((messageLength - setStart) % 4 != 0) {
+                message[messageLength++] = 0;
+            }
+        }
+        put16(message.data() + setStart + 2, static_cast<uint16_t>(messageLength - setStart));
+        openSetId = 0;
+    }
+
+    void Exporter::flushLocked(int64_t nowMs) {
+        if (messageLength == 0) {
+            return;
+        }
+        closeSetLocked();
+
+        uint8_t* p = message.data();
+        const auto exportSeconds = static_cast<uint32_t>((nowMs + wallOffsetMs) / 1000);
+        if (config.format == Format::Ipfix) {
+            p = put16(p, 10);
+            p = put16(p, static_cast<uint16_t>(messageLength));
+            p = put32(p, exportSeconds);
+            p = put32(p, sequence);             // data records sent before this message
+            put32(p, config.observationDomain);
+            sequence += messageRecords;
+        } else {
+            p = put16(p, 9);
+            p = put16(p, static_cast<uint16_t>(messageRecords + messageTemplates));
+            p = put32(p, static_cast<uint32_t>(nowMs - startedSteadyMs));
+            p = put32(p, exportSeconds);
+            p = put32(p, sequence);             // export packets sent before this one
+            put32(p, config.observationDomain);
+            sequence += 1;
+        }
+
+        // The expiry thread writes it once the lock is released.
+        if (queued.size() + messageLength > MAX_QUEUED_BYTES) {
+            counters.dropped += messageRecords;   // the target is not keeping up
+        } else {
+            queued.insert(queued.end(), message.data(), message.data() + messageLength);
+            queuedLengths.push_back(static_cast<uint32_t>(messageLength));
+            wakeup.notify_one();
+        }
+        messageLength = 0;
+    }
+
+    void Exporter::shutdownLocked() {
+        const int64_t nowMs = steadyNowMs();
+        sweepLocked(nowMs, true);
+        flushLocked(nowMs);
+        // The expiry thread is gone; the last messages are written here.
+        const size_t written = writeMessages(queued, queuedLengths);
+        counters.messages += written;
+        counters.errors += queuedLengths.size() - written;
+        if (outputFd >= 0) {
+            ::close(outputFd);
+            outputFd = -1;
+        }
+        std::vector<Flow>().swap(flows);
+        std::vector<uint8_t>().swap(message);
+        std::vector<uint8_t>().swap(queued);
+        std::vector<uint32_t>().swap(queuedLengths);
+        std::vector<uint8_t>().swap(sending);
+        std::vector<uint32_t>().swap(sendingLengths);
+    }
+
+} // namespace flowexport
\ No newline at end of file
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "FlowVerdictCache.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace flowexport {
+
+    constexpr size_t FLOW_SLOTS = 4096;
+    constexpr size_t PACKAGE_FIELD_BYTES = 64;
+
+    // Private enterprise number for the NetGuard information elements. 32473 is
+    // the number IANA reserves for documentation (RFC 5612); collectors map it
+    // through their custom field definitions.
+    constexpr uint32_t ENTERPRISE_NUMBER = 32473;
+
+    enum class Format : uint8_t {
+        NetflowV9 = 9,
+        Ipfix = 10
+    };
+
+    enum class BlockReason : uint8_t {
+        None = 0,
+        Firewall = 1,
+        Risk = 2
+    };
+
+    // Values of IPFIX flowEndReason (IE 136).
+    enum class EndReason : uint8_t {
+        IdleTimeout = 1,
+        ActiveTimeout = 2,
+        EndOfFlow = 3,
+        ForcedEnd = 4,
+        LackOfResources = 5
+    };
+
+    struct ExportConfig {
+        Format format = Format::Ipfix;
+        std::string target;                  // "udp://host:port" or a file path
+        uint32_t observationDomain = 1;
+        int64_t activeTimeoutMs = 60000;
+        int64_t idleTimeoutMs = 15000;
+        int64_t templateRefreshMs = 60000;   // UDP only: a file carries its templates once
+        int64_t flushIntervalMs = 1000;
+        size_t maxMessageBytes = 1400;
+    };
+
+    struct ExportStats {
+        uint64_t records = 0;
+        uint64_t messages = 0;
+        uint64_t errors = 0;
+        uint64_t evicted = 0;
+        uint64_t dropped = 0;            // records in messages the send queue had no room for
+    };
+
+    // Unidirectional flow accounting fed by the analyzer, exported as IPFIX or
+    // NetFlow v9 when a flow goes idle, hits the active timeout, ends (FIN/RST)
+    // or loses its slot. The table and the message buffers are allocated once in
+    // start(); recording and encoding a flow does not allocate. Finished messages
+    // are queued under the lock and written by the expiry thread after releasing
+    // it, so a slow target never stalls account().
+    class Exporter {
+    public:
+        Exporter() = default;
+        ~Exporter();
+
+        Exporter(const Exporter&) = delete;
+        Exporter& operator=(const Exporter&) = delete;
+
+        // Opens the target and starts the expiry thread, replacing (and draining)
+        // any export already running. Returns false if the target is unusable.
+        bool start(const ExportConfig& config);
+
+        // Exports every open flow, flushes and closes the target.
+        void stop();
+
+        bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+        // UID reported for flows of `packageName`; unknown packages export -1.
+        void setOwnerUid(const std::string& packageName, int32_t uid);
+
+        // Accounts one analyzed packet. `data` must be the packet `header` was
+        // peeked from.
+        void account(const uint8_t* data, const conntrack::PacketHeader& header, const std::string& packageName,
+                     conntrack::RiskLabel label, double score, BlockReason blockReason, int64_t nowMs);
+
+        ExportStats stats() const;
+
+    private:
+        struct Flow {
+            uint64_t key = 0;            // 0 marks an empty slot
+            uint64_t packageHash = 0;
+            uint64_t packets = 0;
+            uint64_t bytes = 0;
+            int64_t firstMs = 0;
+            int64_t lastMs = 0;
+            uint8_t src[16] = {};
+            uint8_t dst[16] = {};
+            uint16_t srcPort = 0;
+            uint16_t dstPort = 0;
+            uint8_t family = 0;
+            uint8_t protocol = 0;
+            uint8_t tcpFlags = 0;
+            uint8_t riskScore = 0;       // 0..100
+            uint8_t riskLabel = 0;
+            uint8_t blockReason = 0;
+            char package[PACKAGE_FIELD_BYTES] = {};
+        };
+
+        void run();
+        void sweepLocked(int64_t nowMs, bool drain);
+        void emitLocked(const Flow& flow, EndReason reason, int64_t nowMs);
+        void beginMessageLocked(int64_t nowMs);
+        void appendTemplatesLocked();
+        void closeSetLocked();
+        void flushLocked(int64_t nowMs);
+        void sendQueued(std::unique_lock<std::mutex>& lock);
+        size_t writeMessages(const std::vector<uint8_t>& bytes, const std::vector<uint32_t>& lengths);
+        void shutdownLocked();
+
+        mutable std::mutex mutex;
+        std::atomic<bool> active{false};
+        ExportConfig config;
+        int outputFd = -1;
+        bool datagram = false;
+
+        std::vector<Flow> flows;
+        std::unordered_map<uint64_t, int32_t> ownerUids;   // by package hash
+
+        std::vector<uint8_t> message;
+        size_t messageLength = 0;        // 0 while no message is open
+        size_t setStart = 0;
+        uint16_t openSetId = 0;
+        uint32_t messageRecords = 0;     // data records in the open message
+        uint32_t messageTemplates = 0;
+        int64_t messageOpenedMs = 0;
+        std::vector<uint8_t> queued;           // finished messages, back to back
+        std::vector<uint32_t> queuedLengths;
+        std::vector<uint8_t> sending;          // swapped with `queued` by the expiry thread
+        std::vector<uint32_t> sendingLengths;
+        uint32_t sequence = 0;
+        bool templatesSent = false;
+        int64_t templatesSentMs = 0;
+        int64_t startedSteadyMs = 0;
+        int64_t wallOffsetMs = 0;        // system_clock - steady_clock at start()
+        ExportStats counters;
+
+        std::thread worker;
+        std::condition_variable wakeup;
+        bool stopping = false;
+    };
+
+} // namespace flowexport
\ No newline at end of file
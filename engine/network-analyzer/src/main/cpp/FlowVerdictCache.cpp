@@ -0,0 +1,184 @@
+#include "FlowVerdictCache.hpp"
+
+#include <algorithm>
+#include <netinet/in.h>
+
+namespace conntrack {
+
+    namespace {
+
+        constexpr uint32_t REVALIDATE_PACKETS = 512;
+        constexpr int64_t REVALIDATE_MS = 2000;
+        constexpr uint8_t TCP_FAST_PATH_FLAGS = 0x18;   // ACK | PSH
+        constexpr uint16_t DNS_PORT = 53;
+
+        uint64_t mix64(uint64_t x) {
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdull;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ull;
+            x ^= x >> 33;
+            return x;
+        }
+
+        uint64_t hashBytes(uint64_t hash, const uint8_t* data, size_t len) {
+            for (size_t i = 0; i < len; ++i) {
+                hash ^= data[i];
+                hash *= 0x100000001b3ull;
+            }
+            return hash;
+        }
+
+        uint16_t readPort(const uint8_t* data) {
+            return static_cast<uint16_t>((data[0] << 8) | data[1]);
+        }
+
+        // Payload size buckets; a bucket not yet seen by the slow path forces
+        // another full analysis. Mirrors the thresholds used by the heuristics.
+        uint8_t payloadClass(size_t payloadLength) {
+            if (payloadLength == 0) return 1u << 0;
+            if (payloadLength <= 150) return 1u << 1;
+            if (payloadLength <= 1000) return 1u << 2;
+            return 1u << 3;
+        }
+
+    } // namespace
+
+    bool peekHeader(const uint8_t* data, size_t len, uint64_t appHash, PacketHeader& out) {
+        if (data == nullptr || len < 20) {
+            return false;
+        }
+
+        uint64_t hash = 0xcbf29ce484222325ull ^ appHash;
+        size_t headerLen = 0;
+        uint8_t version = data[0] >> 4;
+        if (version == 4) {
+            headerLen = static_cast<size_t>(data[0] & 0x0F) * 4u;
+            bool fragmented = ((data[6] & 0x3F) | data[7]) != 0;   // MF flag or offset
+            if (headerLen < 20 || headerLen > len || fragmented) {
+                return false;
+            }
+            out.protocol = data[9];
+            hash = hashBytes(hash, data + 12, 8);
+        } else if (version == 6) {
+            headerLen = 40;
+            if (len < headerLen) {
+                return false;
+            }
+            out.protocol = data[6];
+            hash = hashBytes(hash, data + 8, 32);
+        } else {
+            return false;
+        }
+
+        const uint8_t* l4 = data + headerLen;
+        size_t remain = len - headerLen;
+        out.tcpFlags = 0;
+        out.tcpSeq = 0;
+        if (out.protocol == IPPROTO_TCP) {
+            if (remain < 20) return false;
+            size_t tcpHeaderLen = static_cast<size_t>(l4[12] >> 4) * 4u;
+            if (tcpHeaderLen < 20 || tcpHeaderLen > remain) return false;
+            out.tcpFlags = l4[13];
+            out.tcpSeq = (static_cast<uint32_t>(l4[4]) << 24) | (static_cast<uint32_t>(l4[5]) << 16) |
+                         (static_cast<uint32_t>(l4[6]) << 8) | l4[7];
+            out.payloadLength = remain - tcpHeaderLen;
+        } else if (out.protocol == IPPROTO_UDP) {
+            if (remain < 8) return false;
+            out.payloadLength = remain - 8;
+        } else {
+            return false;
+        }
+
+        out.srcPort = readPort(l4);
+        out.dstPort = readPort(l4 + 2);
+        out.length = len;
+        hash = hashBytes(hash, l4, 4);
+        hash ^= out.protocol;
+        out.flowKey = mix64(hash) | 1u;   // never 0, which marks an empty slot
+        return true;
+    }
+
+    VerdictCache::VerdictCache(uint32_t slowPathPackets) : slowPathPackets(slowPathPackets) {}
+
+    VerdictCache::Entry& VerdictCache::slotLocked(const PacketHeader& header, uint64_t generation) {
+        Entry& entry = entries[header.flowKey % VERDICT_SLOTS];
+        if (entry.flowKey != header.flowKey) {
+            entry = Entry{};
+            entry.flowKey = header.flowKey;
+            entry.generation = generation;
+        } else if (entry.generation != generation) {
+            // Policy inputs changed: forget the verdict, keep the flow's history.
+            Entry reset;
+            reset.flowKey = entry.flowKey;
+            reset.generation = generation;
+            reset.packets = entry.packets;
+            reset.highRiskSeen = entry.highRiskSeen;
+            entry = reset;
+        }
+        return entry;
+    }
+
+    bool VerdictCache::lookup(const PacketHeader& header, uint64_t generation, int64_t nowMs, Verdict& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& entry = slotLocked(header, generation);
+        entry.packets++;
+        out = entry.verdict;
+        out.known = entry.hasVerdict;
+        out.highRiskHistory = entry.highRiskSeen;
+        out.flowPackets = entry.packets;
+
+        if (slowPathPackets == 0 || !entry.hasVerdict || entry.packets <= slowPathPackets) {
+            return false;
+        }
+        if ((header.tcpFlags & ~TCP_FAST_PATH_FLAGS) != 0) {
+            return false;   // SYN, FIN, RST, URG, ECN: state changes are always analyzed
+        }
+        if (header.srcPort == DNS_PORT || header.dstPort == DNS_PORT) {
+            return false;
+        }
+        if (header.payloadLength > entry.maxPayload ||
+            (entry.payloadClasses & payloadClass(header.payloadLength)) == 0) {
+            return false;
+        }
+        if (entry.sinceValidation >= REVALIDATE_PACKETS || nowMs - entry.validatedMs >= REVALIDATE_MS) {
+            return false;
+        }
+
+        entry.sinceValidation++;
+        return true;
+    }
+
+    void VerdictCache::store(const PacketHeader& header, uint64_t generation, int64_t nowMs, const Verdict& verdict) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& entry = slotLocked(header, generation);
+        if (entry.packets == 0) {
+            entry.packets = 1;   // evicted by a colliding flow in between
+        }
+        if (!entry.hasVerdict || verdict.score >= entry.verdict.score || verdict.label > entry.verdict.label) {
+            entry.verdict = verdict;
+        }
+        entry.verdict.blockedByFirewall = verdict.blockedByFirewall;
+        entry.hasVerdict = true;
+        entry.highRiskSeen = entry.highRiskSeen || verdict.label == RiskLabel::High;
+        entry.maxPayload = std::max(entry.maxPayload, header.payloadLength);
+        entry.payloadClasses |= payloadClass(header.payloadLength);
+        entry.sinceValidation = 0;
+        entry.validatedMs = nowMs;
+    }
+
+    void VerdictCache::clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.fill(Entry{});
+    }
+
+    const char* labelName(RiskLabel label) {
+        switch (label) {
+            case RiskLabel::High: return "High";
+            case RiskLabel::Medium: return "Medium";
+            case RiskLabel::Low: break;
+        }
+        return "Low";
+    }
+
+} // namespace conntrack
\ No newline at end of file
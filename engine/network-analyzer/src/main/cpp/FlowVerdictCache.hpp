@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace conntrack {
+
+    constexpr size_t VERDICT_SLOTS = 4096;
+
+    enum class RiskLabel : uint8_t {
+        Low,
+        Medium,
+        High
+    };
+
+    // Just enough of the L3/L4 headers to key a flow and spot packets that
+    // carry new signals. Parsing does not allocate.
+    struct PacketHeader {
+        uint64_t flowKey = 0;
+        size_t length = 0;
+        size_t payloadLength = 0;           // the payload is the last payloadLength bytes
+        uint32_t tcpSeq = 0;
+        uint16_t srcPort = 0;
+        uint16_t dstPort = 0;
+        uint8_t protocol = 0;
+        uint8_t tcpFlags = 0;
+    };
+
+    // Returns false for anything the fast path must not handle (fragments,
+    // extension headers, truncated or unknown packets). `appHash` separates the
+    // same 5-tuple seen under different packages.
+    bool peekHeader(const uint8_t* data, size_t len, uint64_t appHash, PacketHeader& out);
+
+    struct Verdict {
+        RiskLabel label = RiskLabel::Low;
+        double score = 0.0;
+        bool blockedByFirewall = false;
+        bool known = false;             // a full analysis has run in this generation
+        bool highRiskHistory = false;   // the flow was ever judged High
+        uint32_t flowPackets = 0;
+    };
+
+    // Conntrack-style table of per-flow verdicts. The first packets of a flow
+    // and any packet with new signals go through full analysis; later packets
+    // reuse the cached verdict until `generation` (rules, fingerprints,
+    // signatures) changes or the entry is due for revalidation.
+    class VerdictCache {
+    public:
+        explicit VerdictCache(uint32_t slowPathPackets);
+
+        // Counts the packet against its flow and fills `out` with what is known
+        // about it. Returns true when the cached verdict may be used as is.
+        bool lookup(const PacketHeader& header, uint64_t generation, int64_t nowMs, Verdict& out);
+
+        // Records the outcome of a full analysis. The flow keeps the highest-risk
+        // verdict seen within a generation.
+        void store(const PacketHeader& header, uint64_t generation, int64_t nowMs, const Verdict& verdict);
+
+        void clear();
+
+    private:
+        struct Entry {
+            uint64_t flowKey = 0;
+            uint64_t generation = 0;
+            uint32_t packets = 0;
+            uint32_t sinceValidation = 0;
+            int64_t validatedMs = 0;
+            size_t maxPayload = 0;
+            uint8_t payloadClasses = 0;
+            bool hasVerdict = false;
+            bool highRiskSeen = false;
+            Verdict verdict;
+        };
+
+        Entry& slotLocked(const PacketHeader& header, uint64_t generation);
+
+        const uint32_t slowPathPackets;
+        std::mutex mutex;
+        std::array<Entry, VERDICT_SLOTS> entries;
+    };
+
+    const char* labelName(RiskLabel label);
+
+} // namespace conntrack
\ No newline at end of file
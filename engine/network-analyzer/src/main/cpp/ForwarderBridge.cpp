@@ -0,0 +1,259 @@
+#include <jni.h>
+#include <memory>
+#include <string>
+#include <android/log.h>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "JniRegistration.hpp"
+#include "NetGuardEngine.hpp"
+#include "TunForwarder.hpp"
+
+#define LOG_TAG "ForwarderBridge"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+    // Frame written to the packet mirror for every TUN packet: this header, then
+    // the raw packet. It carries the verdict the forwarder applied so the Kotlin
+    // monitor only reports it and never analyzes the packet a second time.
+    //   [0] format version  [1] flags  [2] risk label (0 low, 1 medium, 2 high)
+    //   [3] reserved        [4..7] risk score, IEEE-754 float, big-endian
+    constexpr size_t MIRROR_HEADER_BYTES = 8;
+    constexpr uint8_t MIRROR_VERSION = 1;
+    constexpr uint8_t MIRROR_INSPECTED = 0x01;          // packets without it (bare ACKs) carry no verdict
+    constexpr uint8_t MIRROR_BLOCKED = 0x02;            // the forwarder dropped or reset the flow
+    constexpr uint8_t MIRROR_FIREWALL_BLOCKED = 0x04;
+    constexpr uint8_t MIRROR_APPROXIMATE = 0x08;
+
+    // Used only from the forwarder thread: inspect() records the verdict and the
+    // observe hook that follows sends it along with the packet.
+    struct PacketMirror {
+        int fd = -1;
+        uint8_t header[MIRROR_HEADER_BYTES] = {};
+        PacketAnalysisResult result;   // verdict fields only, for the flow export
+        bool blocked = false;
+
+        void record(const PacketAnalysisResult& analysis, bool block) {
+            blocked = block;
+            result.highRisk = analysis.highRisk;
+            result.blockedByFirewall = analysis.blockedByFirewall;
+            result.approximate = analysis.approximate;
+            result.label = analysis.label;
+            result.riskScore = analysis.riskScore;
+            uint8_t flags = MIRROR_INSPECTED;
+            if (blocked) flags |= MIRROR_BLOCKED;
+            if (result.blockedByFirewall) flags |= MIRROR_FIREWALL_BLOCKED;
+            if (result.approximate) flags |= MIRROR_APPROXIMATE;
+            const auto score = static_cast<float>(result.riskScore);
+            uint32_t bits = 0;
+            std::memcpy(&bits, &score, sizeof(bits));
+            header[1] = flags;
+            header[2] = static_cast<uint8_t>(result.label);
+            header[3] = 0;
+            header[4] = static_cast<uint8_t>(bits >> 24);
+            header[5] = static_cast<uint8_t>(bits >> 16);
+            header[6] = static_cast<uint8_t>(bits >> 8);
+            header[7] = static_cast<uint8_t>(bits);
+        }
+
+        bool send(const uint8_t* packet, size_t len, bool inspected) {
+            if (!inspected) {
+                std::memset(header + 1, 0, MIRROR_HEADER_BYTES - 1);
+            }
+            header[0] = MIRROR_VERSION;
+            iovec iov[2] = {{header, MIRROR_HEADER_BYTES}, {const_cast<uint8_t*>(packet), len}};
+            msghdr message{};
+            message.msg_iov = iov;
+            message.msg_iovlen = 2;
+            return ::sendmsg(fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL) >= 0;
+        }
+    };
+
+    // Kotlin-side ForwarderHost (protect + owner lookup), shared by the callbacks
+    // the forwarder thread runs. The thread attaches itself to the VM once.
+    struct JavaHost {
+        JavaVM* vm = nullptr;
+        jobject callbacks = nullptr;
+        jmethodID protectMethod = nullptr;
+        jmethodID resolveOwnerMethod = nullptr;
+        JNIEnv* threadEnv = nullptr;
+
+        ~JavaHost() {
+            JNIEnv* env = nullptr;
+            if (callbacks != nullptr && vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_OK) {
+                env->DeleteGlobalRef(callbacks);
+            }
+        }
+
+        bool protect(int fd) {
+            if (threadEnv == nullptr) {
+                return false;
+            }
+            jboolean ok = threadEnv->CallBooleanMethod(callbacks, protectMethod, static_cast<jint>(fd));
+            if (threadEnv->ExceptionCheck()) {
+                threadEnv->ExceptionClear();
+                return false;
+            }
+            return ok == JNI_TRUE;
+        }
+
+        std::string resolveOwner(const tun::FlowEndpoints& flow) {
+            if (threadEnv == nullptr) {
+                return std::string();
+            }
+            jstring sourceIp = threadEnv->NewStringUTF(flow.sourceIp.c_str());
+            jstring destinationIp = threadEnv->NewStringUTF(flow.destinationIp.c_str());
+            auto owner = static_cast<jstring>(threadEnv->CallObjectMethod(
+                    callbacks, resolveOwnerMethod, static_cast<jint>(flow.protocol),
+                    sourceIp, static_cast<jint>(flow.sourcePort),
+                    destinationIp, static_cast<jint>(flow.destinationPort)));
+            threadEnv->DeleteLocalRef(sourceIp);
+            threadEnv->DeleteLocalRef(destinationIp);
+            if (threadEnv->ExceptionCheck()) {
+                threadEnv->ExceptionClear();
+                return std::string();
+            }
+            std::string result;
+            if (owner != nullptr) {
+                const char* chars = threadEnv->GetStringUTFChars(owner, nullptr);
+                if (chars != nullptr) {
+                    result.assign(chars);
+                    threadEnv->ReleaseStringUTFChars(owner, chars);
+                }
+                threadEnv->DeleteLocalRef(owner);
+            }
+            return result;
+        }
+    };
+
+    jint startForwarder(
+            JNIEnv* env,
+            jobject /* this */,
+            jlong handle,
+            jint tunFd,
+            jint mtu,
+            jboolean enforceRiskVerdicts,
+            jobject callbacks
+    ) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        if (engine == nullptr || callbacks == nullptr || tunFd < 0) {
+            return -1;
+        }
+        engine->attachForwarder(nullptr);
+
+        auto javaHost = std::make_shared<JavaHost>();
+        env->GetJavaVM(&javaHost->vm);
+        jclass callbacksClass = env->GetObjectClass(callbacks);
+        javaHost->protectMethod = env->GetMethodID(callbacksClass, "protect", "(I)Z");
+        javaHost->resolveOwnerMethod = env->GetMethodID(
+                callbacksClass, "resolveOwner", "(ILjava/lang/String;ILjava/lang/String;I)Ljava/lang/String;");
+        env->DeleteLocalRef(callbacksClass);
+        if (javaHost->protectMethod == nullptr || javaHost->resolveOwnerMethod == nullptr) {
+            return -1;   // NoSuchMethodError is pending
+        }
+        javaHost->callbacks = env->NewGlobalRef(callbacks);
+
+        // The Kotlin monitor keeps reading raw packets from its end of this pair
+        // instead of the TUN itself, which the forwarder now owns.
+        int mirror[2] = {-1, -1};
+        if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, mirror) != 0) {
+            LOGE("Unable to create forwarder mirror socket");
+            return -1;
+        }
+
+        tun::ForwarderConfig config;
+        config.tunFd = tunFd;
+        auto packetMirror = std::make_shared<PacketMirror>();
+        packetMirror->fd = mirror[0];
+        if (mtu > 0 && mtu <= 65535) config.mtu = static_cast<uint16_t>(mtu);
+
+        const bool enforceRisk = enforceRiskVerdicts == JNI_TRUE;
+        // The engine owns the forwarder and stops it before it is freed, so the
+        // thread can use a plain pointer (a shared_ptr here would be a cycle).
+        NetGuardEngine* owner = engine.get();
+        tun::Host host;
+        host.protect = [javaHost](int fd) { return javaHost->protect(fd); };
+        host.resolveOwner = [javaHost](const tun::FlowEndpoints& flow) { return javaHost->resolveOwner(flow); };
+        host.inspect = [owner, enforceRisk, packetMirror](const uint8_t* packet, size_t len,
+                                                          const std::string& packageName) {
+            PacketAnalysisResult result = owner->analyzer().analyzePacket(packet, len, packageName);
+            const bool block = result.blockedByFirewall || (enforceRisk && result.highRisk);
+            packetMirror->record(result, block);
+            return block ? tun::Action::Block : tun::Action::Allow;
+        };
+        host.observe = [owner, packetMirror](const uint8_t* packet, size_t len, const std::string& packageName,
+                                             bool inspected) {
+            // Every relayed packet is exported exactly once here, under the flow's
+            // owner; packets that skipped inspection add traffic at Low risk.
+            owner->analyzer().exportFlow(packet, len, packageName,
+                                         inspected ? packetMirror->result : PacketAnalysisResult{},
+                                         inspected && packetMirror->blocked);
+            return packetMirror->send(packet, len, inspected);
+        };
+        host.backlog = [owner](size_t pendingPackets, int64_t nowMs) {
+            overload::Controller& controller = owner->overload();
+            controller.reportBacklog(pendingPackets);
+            controller.tick(nowMs);
+        };
+        host.threadStarted = [javaHost]() {
+            JNIEnv* threadEnv = nullptr;
+            if (javaHost->vm->AttachCurrentThread(&threadEnv, nullptr) == JNI_OK) {
+                javaHost->threadEnv = threadEnv;
+            }
+        };
+        host.threadStopping = [javaHost, mirrorFd = mirror[0]]() {
+            ::close(mirrorFd);
+            javaHost->threadEnv = nullptr;
+            javaHost->vm->DetachCurrentThread();
+        };
+
+        auto forwarder = std::make_unique<tun::Forwarder>(config, std::move(host));
+        if (!forwarder->start()) {
+            LOGE("Unable to start TUN forwarder on fd %d", static_cast<int>(tunFd));
+            ::close(mirror[0]);
+            ::close(mirror[1]);
+            return -1;
+        }
+        engine->attachForwarder(std::move(forwarder));
+        LOGI("TUN forwarder started: fd %d, mtu %d, risk enforcement %s",
+             static_cast<int>(tunFd), static_cast<int>(config.mtu), enforceRisk ? "on" : "off");
+        return mirror[1];
+    }
+
+    void stopForwarder(JNIEnv* env, jobject /* this */, jlong handle) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        if (engine != nullptr) {
+            engine->attachForwarder(nullptr);
+        }
+    }
+
+    jstring getForwarderStats(JNIEnv* env, jobject /* this */, jlong handle) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        if (engine == nullptr) {
+            return nullptr;
+        }
+        return env->NewStringUTF(engine->forwarderStatsJson().c_str());
+    }
+
+    const JNINativeMethod FORWARDER_METHODS[] = {
+            {"startForwarder",
+             "(JIIZLcom/clsoft/netguard/engine/network/analyzer/ForwarderHost;)I",
+             reinterpret_cast<void*>(startForwarder)},
+            {"stopForwarder", "(J)V", reinterpret_cast<void*>(stopForwarder)},
+            {"getForwarderStats", "(J)Ljava/lang/String;", reinterpret_cast<void*>(getForwarderStats)},
+    };
+
+} // namespace
+
+namespace jni {
+
+    bool registerForwarderNatives(JNIEnv* env, jclass bridge) {
+        return env->RegisterNatives(bridge, FORWARDER_METHODS,
+                                    sizeof(FORWARDER_METHODS) / sizeof(FORWARDER_METHODS[0])) == JNI_OK;
+    }
+
+} // namespace jni
\ No newline at end of file
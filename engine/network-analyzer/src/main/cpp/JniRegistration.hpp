@@ -0,0 +1,31 @@
+#pragma once
+
+#include <jni.h>
+#include <memory>
+
+class NetGuardEngine;
+
+// Natives are bound explicitly from JNI_OnLoad (analyzer.cpp) instead of relying
+// on Java_* symbol lookup; every bridge file contributes its own table.
+namespace jni {
+
+    constexpr const char* NATIVE_BRIDGE_CLASS = "com/clsoft/netguard/engine/network/analyzer/NativeBridge";
+
+    // Global references resolved once in JNI_OnLoad.
+    jclass stringClass();
+    jclass illegalStateExceptionClass();
+
+    // Resolves an engine handle, throwing IllegalStateException if it is not live.
+    // Hold the returned reference for the whole call.
+    std::shared_ptr<NetGuardEngine> engineFromHandle(JNIEnv* env, jlong handle);
+
+    bool registerAnalyzerNatives(JNIEnv* env, jclass bridge);
+    bool registerEngineNatives(JNIEnv* env, jclass bridge);
+    bool registerFirewallNatives(JNIEnv* env, jclass bridge);
+    bool registerTlsNatives(JNIEnv* env, jclass bridge);
+    bool registerSignatureNatives(JNIEnv* env, jclass bridge);
+    bool registerSnapshotNatives(JNIEnv* env, jclass bridge);
+    bool registerForwarderNatives(JNIEnv* env, jclass bridge);
+    bool registerExportNatives(JNIEnv* env, jclass bridge);
+
+} // namespace jni
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "NetGuardEngine.hpp"
+
+#include <condition_variable>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+    struct Registry {
+        std::mutex mutex;
+        std::condition_variable released;
+        std::unordered_map<int64_t, std::shared_ptr<NetGuardEngine>> engines;
+        std::unordered_set<int64_t> retiring;   // destroyed, still referenced by in-flight calls
+        int64_t nextHandle = 1;
+    };
+
+    // Leaked on purpose: JNI calls may still arrive while static destructors run.
+    Registry& registry() {
+        static auto* instance = new Registry();
+        return *instance;
+    }
+
+    EngineConfig sanitize(EngineConfig config) {
+        if (config.maxTrackedSessions == 0) {
+            config.maxTrackedSessions = EngineConfig{}.maxTrackedSessions;
+        }
+        if (config.sessionExpirationMs <= 0) {
+            config.sessionExpirationMs = EngineConfig{}.sessionExpirationMs;
+        }
+        return config;
+    }
+
+} // namespace
+
+NetGuardEngine::NetGuardEngine(const EngineConfig& config)
+        : engineConfig(sanitize(config)),
+          verdicts(engineConfig.fastPathAfterPackets),
+          overloadController(engineConfig.overloadBudget),
+          packetAnalyzer(*this) {}
+
+NetGuardEngine::~NetGuardEngine() {
+    attachForwarder(nullptr);
+}
+
+std::string NetGuardEngine::metricsJson() const {
+    const overload::ShedCounts shed = overloadController.shedCounts();
+    const flowexport::ExportStats exported = exporter.stats();
+    std::ostringstream out;
+    out << "{\"packets\":" << engineMetrics.packets.load(std::memory_order_relaxed)
+        << ",\"bytes\":" << engineMetrics.bytes.load(std::memory_order_relaxed)
+        << ",\"highRisk\":" << engineMetrics.highRisk.load(std::memory_order_relaxed)
+        << ",\"firewallBlocks\":" << engineMetrics.firewallBlocks.load(std::memory_order_relaxed)
+        << ",\"malformed\":" << engineMetrics.malformed.load(std::memory_order_relaxed)
+        << ",\"fastPath\":" << engineMetrics.fastPath.load(std::memory_order_relaxed)
+        << ",\"loadMode\":\"" << overload::modeName(overloadController.mode()) << '"'
+        << ",\"shedChecksums\":" << shed.checksums
+        << ",\"shedPayloads\":" << shed.payloads
+        << ",\"headerOnly\":" << shed.headerOnly
+        << ",\"flowExport\":" << (exporter.enabled() ? "true" : "false")
+        << ",\"exportedFlows\":" << exported.records
+        << ",\"exportMessages\":" << exported.messages
+        << ",\"exportErrors\":" << exported.errors
+        << ",\"exportEvicted\":" << exported.evicted
+        << ",\"exportDropped\":" << exported.dropped
+        << '}';
+    return out.str();
+}
+
+void NetGuardEngine::attachForwarder(std::unique_ptr<tun::Forwarder> forwarder) {
+    std::unique_ptr<tun::Forwarder> previous;
+    {
+        std::lock_guard<std::mutex> lock(forwarderMutex);
+        previous = std::move(tunForwarder);
+        tunForwarder = std::move(forwarder);
+    }
+    previous.reset();   // joins the old thread outside the lock
+}
+
+std::string NetGuardEngine::forwarderStatsJson() {
+    std::lock_guard<std::mutex> lock(forwarderMutex);
+    return tunForwarder ? tunForwarder->statsJson() : std::string();
+}
+
+int64_t NetGuardEngine::create(const EngineConfig& config) {
+    Registry& engines = registry();
+    std::lock_guard<std::mutex> lock(engines.mutex);
+    const int64_t handle = engines.nextHandle++;
+    // The last reference may be dropped by any thread; destroy() waits for it.
+    std::shared_ptr<NetGuardEngine> engine(new NetGuardEngine(config), [handle](NetGuardEngine* retired) {
+        delete retired;
+        Registry& owner = registry();
+        std::lock_guard<std::mutex> retiredLock(owner.mutex);
+        owner.retiring.erase(handle);
+        owner.released.notify_all();
+    });
+    engines.engines.emplace(handle, std::move(engine));
+    return handle;
+}
+
+std::shared_ptr<NetGuardEngine> NetGuardEngine::fromHandle(int64_t handle) {
+    if (handle == 0) {
+        return nullptr;
+    }
+    Registry& engines = registry();
+    std::lock_guard<std::mutex> lock(engines.mutex);
+    const auto it = engines.engines.find(handle);
+    return it != engines.engines.end() ? it->second : nullptr;
+}
+
+bool NetGuardEngine::destroy(int64_t handle) {
+    Registry& engines = registry();
+    std::shared_ptr<NetGuardEngine> engine;
+    {
+        std::lock_guard<std::mutex> lock(engines.mutex);
+        const auto it = engines.engines.find(handle);
+        if (it == engines.engines.end()) {
+            return false;
+        }
+        engine = std::move(it->second);
+        engines.engines.erase(it);
+        engines.retiring.insert(handle);
+    }
+
+    // Background threads go first so nothing but JNI callers still touches it.
+    engine->attachForwarder(nullptr);
+    engine->exporter.stop();
+    engine.reset();
+
+    std::unique_lock<std::mutex> lock(engines.mutex);
+    engines.released.wait(lock, [&engines, handle] { return engines.retiring.count(handle) == 0; });
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "BehaviorAnalytics.hpp"
+#include "FirewallController.hpp"
+#include "FlowExporter.hpp"
+#include "FlowVerdictCache.hpp"
+#include "OverloadController.hpp"
+#include "PacketAnalyzer.hpp"
+#include "SignatureScanner.hpp"
+#include "TlsInspector.hpp"
+#include "TunForwarder.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+struct EngineConfig {
+    size_t maxTrackedSessions = 2048;
+    int64_t sessionExpirationMs = 10000;
+    uint32_t fastPathAfterPackets = 8;   // 0 disables the established-flow fast path
+    overload::Budget overloadBudget;
+};
+
+struct EngineMetrics {
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> highRisk{0};
+    std::atomic<uint64_t> firewallBlocks{0};
+    std::atomic<uint64_t> malformed{0};
+    std::atomic<uint64_t> fastPath{0};
+};
+
+// One analysis engine: flow table, firewall rules, detection data, sketches and
+// counters. Nothing is shared between instances, so several engines (or tests)
+// can live in the same process. Java holds it as an opaque `long` handle that
+// indexes a process-wide registry; the raw pointer never crosses JNI.
+class NetGuardEngine {
+public:
+    explicit NetGuardEngine(const EngineConfig& config);
+    ~NetGuardEngine();
+
+    NetGuardEngine(const NetGuardEngine&) = delete;
+    NetGuardEngine& operator=(const NetGuardEngine&) = delete;
+
+    const EngineConfig& config() const { return engineConfig; }
+    PacketAnalyzer& analyzer() { return packetAnalyzer; }
+    firewall::RuleSet& rules() { return ruleSet; }
+    tls::Reassembler& tlsReassembler() { return reassembler; }
+    tls::FingerprintSet& tlsFingerprints() { return fingerprints; }
+    signatures::Scanner& signatureScanner() { return scanner; }
+    behavior::Analytics& behaviorAnalytics() { return analytics; }
+    conntrack::VerdictCache& verdictCache() { return verdicts; }
+    overload::Controller& overload() { return overloadController; }
+    flowexport::Exporter& flowExporter() { return exporter; }
+    EngineMetrics& metrics() { return engineMetrics; }
+
+    std::string metricsJson() const;
+
+    // Installs the engine's TUN forwarder, stopping any previous one; nullptr just
+    // stops it. The forwarder thread analyzes packets through this engine.
+    void attachForwarder(std::unique_ptr<tun::Forwarder> forwarder);
+
+    // Forwarder counters as JSON, or an empty string if none is attached.
+    std::string forwarderStatsJson();
+
+    // Changes whenever anything a cached flow verdict depends on is replaced.
+    uint64_t verdictGeneration() const {
+        return ruleSet.generation() + fingerprints.version() + scanner.databaseVersion();
+    }
+
+    // Registers a new engine and returns its handle (never 0).
+    static int64_t create(const EngineConfig& config);
+
+    // Returns the engine registered under `handle`, or nullptr. The reference
+    // keeps the engine alive for the caller's work even if destroy() runs.
+    static std::shared_ptr<NetGuardEngine> fromHandle(int64_t handle);
+
+    // Unregisters `handle`, stops the forwarder and the flow export, and waits
+    // until calls still using the engine return before it is freed. Returns
+    // false for an unknown or already destroyed handle.
+    static bool destroy(int64_t handle);
+
+private:
+    EngineConfig engineConfig;
+    EngineMetrics engineMetrics;
+    firewall::RuleSet ruleSet;
+    tls::Reassembler reassembler;
+    tls::FingerprintSet fingerprints;
+    signatures::Scanner scanner;
+    behavior::Analytics analytics;
+    conntrack::VerdictCache verdicts;
+    overload::Controller overloadController;
+    flowexport::Exporter exporter;
+    PacketAnalyzer packetAnalyzer;   // refers back to the members above
+
+    std::mutex forwarderMutex;
+    std::unique_ptr<tun::Forwarder> tunForwarder;   // destroyed first: its thread uses the analyzer
+};
\ No newline at end of file
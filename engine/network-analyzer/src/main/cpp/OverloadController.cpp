@@ -0,0 +1,108 @@
+#include "OverloadController.hpp"
+
+#include <algorithm>
+
+namespace overload {
+
+    namespace {
+
+        constexpr double COST_SMOOTHING = 0.05;
+        constexpr int64_t EVALUATE_INTERVAL_MS = 10;   // time between decisions
+        constexpr int64_t COST_STALE_MS = 1000;        // no full analysis for this long: no cost pressure
+        constexpr int64_t ESCALATE_HOLD_MS = 100;      // settle time after stepping up
+        constexpr int64_t RECOVER_HOLD_MS = 2000;      // calm time before stepping down
+        constexpr double RECOVER_PRESSURE = 0.5;
+
+        // Shedding lowers the measured cost by roughly this much per step, so the
+        // recovery check compares against what Full mode would cost.
+        constexpr double MODE_COST_FACTOR[] = {1.0, 0.7, 0.35, 0.1};
+
+    } // namespace
+
+    Controller::Controller(const Budget& budget) : budget(budget) {}
+
+    void Controller::reportBacklog(size_t pendingPackets) {
+        backlog.store(pendingPackets, std::memory_order_relaxed);
+    }
+
+    void Controller::recordCost(int64_t costNs, int64_t nowMs) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (averageCostNs == 0.0) {
+                averageCostNs = static_cast<double>(costNs);
+            } else {
+                averageCostNs += COST_SMOOTHING * (static_cast<double>(costNs) - averageCostNs);
+            }
+            lastSampleMs = nowMs;
+        }
+        tick(nowMs);
+    }
+
+    void Controller::tick(int64_t nowMs) {
+        if (nowMs < nextEvaluationMs.load(std::memory_order_relaxed)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (nowMs < nextEvaluationMs.load(std::memory_order_relaxed)) {
+            return;   // another thread evaluated while this one waited
+        }
+        nextEvaluationMs.store(nowMs + EVALUATE_INTERVAL_MS, std::memory_order_relaxed);
+        evaluateLocked(nowMs);
+    }
+
+    void Controller::evaluateLocked(int64_t nowMs) {
+        const Mode mode = current.load(std::memory_order_relaxed);
+        const auto step = static_cast<size_t>(mode);
+        // Without recent samples (idle, or every packet on the fast path) the old
+        // average says nothing about the current load.
+        const bool costFresh = averageCostNs > 0.0 && nowMs - lastSampleMs < COST_STALE_MS;
+        const double fullCost = costFresh ? averageCostNs / MODE_COST_FACTOR[step] : 0.0;
+        const double costPressure = budget.packetCostNs > 0
+                                    ? fullCost / static_cast<double>(budget.packetCostNs) : 0.0;
+        const double backlogPressure = budget.backlogPackets > 0
+                                       ? static_cast<double>(backlog.load(std::memory_order_relaxed)) /
+                                         static_cast<double>(budget.backlogPackets)
+                                       : 0.0;
+        const double pressure = std::max(costPressure, backlogPressure);
+
+        if (pressure > 1.0) {
+            calmSinceMs = 0;
+            if (mode != Mode::HeaderOnly && nowMs - lastChangeMs >= ESCALATE_HOLD_MS) {
+                current.store(static_cast<Mode>(step + 1), std::memory_order_relaxed);
+                lastChangeMs = nowMs;
+            }
+            return;
+        }
+
+        if (mode == Mode::Full || pressure > RECOVER_PRESSURE) {
+            calmSinceMs = 0;
+            return;
+        }
+        if (calmSinceMs == 0) {
+            calmSinceMs = nowMs;
+        } else if (nowMs - calmSinceMs >= RECOVER_HOLD_MS) {
+            current.store(static_cast<Mode>(step - 1), std::memory_order_relaxed);
+            lastChangeMs = nowMs;
+            calmSinceMs = 0;
+        }
+    }
+
+    ShedCounts Controller::shedCounts() const {
+        ShedCounts counts;
+        counts.checksums = shedChecksums.load(std::memory_order_relaxed);
+        counts.payloads = shedPayloads.load(std::memory_order_relaxed);
+        counts.headerOnly = shedHeaderOnly.load(std::memory_order_relaxed);
+        return counts;
+    }
+
+    const char* modeName(Mode mode) {
+        switch (mode) {
+            case Mode::Full: return "full";
+            case Mode::SkipChecksums: return "skip-checksums";
+            case Mode::SamplePayload: return "sample-payload";
+            case Mode::HeaderOnly: return "header-only";
+        }
+        return "full";
+    }
+
+} // namespace overload
\ No newline at end of file
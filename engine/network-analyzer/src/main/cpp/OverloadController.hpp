@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace overload {
+
+    // Degradation ladder, cheapest loss first. Firewall decisions are exact in
+    // every mode; only detection work is shed.
+    enum class Mode : uint8_t {
+        Full,
+        SkipChecksums,    // no CRC32 / entropy
+        SamplePayload,    // TLS and signature inspection on a per-flow sample
+        HeaderOnly        // header accounting plus the flow's last verdict
+    };
+
+    struct Budget {
+        int64_t packetCostNs = 250000;   // average full-analysis cost per packet
+        size_t backlogPackets = 512;     // packets queued ahead of the analyzer
+    };
+
+    struct ShedCounts {
+        uint64_t checksums = 0;
+        uint64_t payloads = 0;
+        uint64_t headerOnly = 0;
+    };
+
+    // Measures the cost of fully analyzed packets and the backlog reported by the
+    // packet source, and moves one step along the ladder when either exceeds its
+    // budget. It steps back only after pressure stays low for a hold period, so
+    // the mode does not flap as shedding itself lowers the measured cost.
+    // Decisions are taken in tick(), which the analyzer calls for every packet and
+    // the packet source calls on its idle timer so an idle engine recovers too.
+    class Controller {
+    public:
+        explicit Controller(const Budget& budget);
+
+        Mode mode() const { return current.load(std::memory_order_relaxed); }
+
+        // Packets waiting to be analyzed right now, as seen by the packet source.
+        void reportBacklog(size_t pendingPackets);
+        void recordCost(int64_t costNs, int64_t nowMs);
+
+        // Re-evaluates the mode if the evaluation interval has passed. Lock-free
+        // when it has not, so it is cheap enough for every packet.
+        void tick(int64_t nowMs);
+
+        void countShedChecksums() { shedChecksums.fetch_add(1, std::memory_order_relaxed); }
+        void countShedPayload() { shedPayloads.fetch_add(1, std::memory_order_relaxed); }
+        void countHeaderOnly() { shedHeaderOnly.fetch_add(1, std::memory_order_relaxed); }
+        ShedCounts shedCounts() const;
+
+    private:
+        void evaluateLocked(int64_t nowMs);
+
+        const Budget budget;
+        std::atomic<Mode> current{Mode::Full};
+        std::atomic<size_t> backlog{0};
+        std::atomic<uint64_t> shedChecksums{0};
+        std::atomic<uint64_t> shedPayloads{0};
+        std::atomic<uint64_t> shedHeaderOnly{0};
+        std::atomic<int64_t> nextEvaluationMs{0};
+
+        std::mutex mutex;
+        double averageCostNs = 0.0;
+        int64_t lastSampleMs = 0;
+        int64_t lastChangeMs = 0;
+        int64_t calmSinceMs = 0;
+    };
+
+    const char* modeName(Mode mode);
+
+} // namespace overload
\ No newline at end of file
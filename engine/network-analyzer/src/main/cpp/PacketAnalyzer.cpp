@@ -1,6 +1,6 @@
 #include "PacketAnalyzer.hpp"
 
-#include "FirewallController.hpp"
+#include "NetGuardEngine.hpp"
 
 #include <algorithm>
 #include <android/log.h>
@@ -9,17 +9,18 @@
 #include <chrono>
 #include <cmath>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <dlfcn.h>
 #include <iomanip>
-#include <mutex>
 #include <netinet/ip.h>
 #include <netinet/ip6.h>
 #include <netinet/tcp.h>
 #include <netinet/udp.h>
 #include <sstream>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace {
@@ -29,8 +30,13 @@ namespace {
     constexpr double HIGH_RISK_THRESHOLD = 0.82;
     constexpr double MEDIUM_RISK_THRESHOLD = 0.45;
     constexpr double ABSOLUTE_HIGH_SCORE = 0.98;
-    constexpr size_t MAX_TRACKED_SESSIONS = 2048;
-    constexpr std::chrono::seconds SESSION_EXPIRATION(10);
+    constexpr uint32_t FAN_OUT_THRESHOLD = 64;
+    constexpr uint32_t HORIZONTAL_SCAN_THRESHOLD = 24;
+    constexpr uint32_t VERTICAL_SCAN_THRESHOLD = 24;
+    constexpr uint32_t FLOOD_PACKET_THRESHOLD = 4000;
+    constexpr double APP_HOST_SPREAD_THRESHOLD = 200.0;
+    constexpr uint32_t PAYLOAD_SAMPLE_INTERVAL = 8;     // 1 in N packets per flow under SamplePayload
+    constexpr size_t SWEEP_BUCKETS_PER_PACKET = 4;      // session-table buckets expired per packet
 
     struct JsonBuilder {
         std::ostringstream out;
@@ -136,6 +142,8 @@ namespace {
         bool tampered = false;
         size_t length = 0;
         size_t payloadLength = 0;
+        const uint8_t* payload = nullptr;
+        uint32_t tcpSeq = 0;
         uint32_t crc32 = 0;
         double entropy = 0.0;
         std::string srcIp;
@@ -146,6 +154,10 @@ namespace {
         int dstPort = 0;
         uint8_t hopLimit = 0;
         DnsMinimal dns;
+        tls::ParseStatus tlsStatus = tls::ParseStatus::NotClientHello;
+        tls::ClientHelloInfo tls;
+        bool tlsKnownFingerprint = false;
+        signatures::ScanResult signatureMatches;
     };
 
     struct RiskAssessment {
@@ -159,15 +171,6 @@ namespace {
         std::string correlationReason;
     };
 
-    struct SessionInfo {
-        std::chrono::steady_clock::time_point lastSeen{};
-        size_t count = 0;
-        size_t smallPayloadCount = 0;
-    };
-
-    std::mutex gSessionMutex;
-    std::unordered_map<std::string, SessionInfo> gSessions;
-
     uint32_t computeCrc32(const uint8_t* data, size_t len) {
         uint32_t crc = 0xFFFFFFFFu;
         for (size_t i = 0; i < len; ++i) {
@@ -277,7 +280,7 @@ namespace {
 
     bool detectHooking() {
         Dl_info info{};
-        if (dladdr(reinterpret_cast<const void*>(&PacketAnalyzer::analyzePacket), &info) == 0) {
+        if (dladdr(reinterpret_cast<const void*>(&detectHooking), &info) == 0) {
             return true;
         }
         if (info.dli_fname == nullptr) {
@@ -287,36 +290,64 @@ namespace {
         return libraryName.find("netguard_native") == std::string::npos;
     }
 
-    void cleanupSessionsLocked(const std::chrono::steady_clock::time_point& now) {
-        for (auto it = gSessions.begin(); it != gSessions.end();) {
-            if (now - it->second.lastSeen > SESSION_EXPIRATION) {
-                it = gSessions.erase(it);
-            } else {
-                ++it;
+    // Printable addresses of a packet conntrack::peekHeader() accepted (IPv4, or
+    // IPv6 without extension headers), formatted without allocating.
+    struct FlowAddresses {
+        char src[INET6_ADDRSTRLEN] = {};
+        char dst[INET6_ADDRSTRLEN] = {};
+    };
+
+    FlowAddresses formatAddresses(const uint8_t* data) {
+        FlowAddresses out;
+        if ((data[0] >> 4) == 4) {
+            inet_ntop(AF_INET, data + 12, out.src, sizeof(out.src));
+            inet_ntop(AF_INET, data + 16, out.dst, sizeof(out.dst));
+        } else {
+            inet_ntop(AF_INET6, data + 8, out.src, sizeof(out.src));
+            inet_ntop(AF_INET6, data + 24, out.dst, sizeof(out.dst));
+        }
+        return out;
+    }
+
+    uint64_t computeFlowHash(std::string_view srcIp, std::string_view dstIp, int srcPort, int dstPort) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        auto mix = [&hash](std::string_view value) {
+            for (unsigned char c : value) {
+                hash ^= c;
+                hash *= 0x100000001b3ull;
             }
+            hash ^= '|';
+            hash *= 0x100000001b3ull;
+        };
+        mix(srcIp);
+        mix(dstIp);
+        hash ^= (static_cast<uint64_t>(srcPort) << 16) | static_cast<uint64_t>(dstPort);
+        hash *= 0x100000001b3ull;
+        return hash;
+    }
+
+    uint64_t computeFlowHash(const PacketContext& ctx) {
+        return computeFlowHash(ctx.srcIp, ctx.dstIp, ctx.srcPort, ctx.dstPort);
+    }
+
+    void inspectTls(NetGuardEngine& engine, PacketContext& ctx) {
+        if (!ctx.valid || ctx.protocol != "TCP" || ctx.payload == nullptr || ctx.payloadLength == 0) {
+            return;
         }
-        if (gSessions.size() > MAX_TRACKED_SESSIONS) {
-            gSessions.clear();
+        ctx.tlsStatus = engine.tlsReassembler().inspectSegment(computeFlowHash(ctx), ctx.tcpSeq,
+                                                               ctx.payload, ctx.payloadLength, ctx.tls);
+        if (ctx.tlsStatus == tls::ParseStatus::Complete) {
+            ctx.tlsKnownFingerprint = engine.tlsFingerprints().contains(ctx.tls);
         }
     }
 
-    SessionInfo registerSession(const std::string& key, size_t payloadLength) {
-        auto now = std::chrono::steady_clock::now();
-        std::lock_guard<std::mutex> lock(gSessionMutex);
-        cleanupSessionsLocked(now);
-
-        SessionInfo& info = gSessions[key];
-        if (now - info.lastSeen < std::chrono::milliseconds(500)) {
-            info.count++;
-            if (payloadLength <= 150) {
-                info.smallPayloadCount++;
-            }
-        } else {
-            info.count = 1;
-            info.smallPayloadCount = payloadLength <= 150 ? 1 : 0;
+    void inspectPayload(NetGuardEngine& engine, PacketContext& ctx) {
+        if (!ctx.valid || ctx.payload == nullptr || ctx.payloadLength == 0) {
+            return;
         }
-        info.lastSeen = now;
-        return info;
+        const int64_t sequence = ctx.protocol == "TCP" ? static_cast<int64_t>(ctx.tcpSeq) : signatures::NO_SEQUENCE;
+        engine.signatureScanner().scanFlow(computeFlowHash(ctx), ctx.payload, ctx.payloadLength,
+                                           ctx.signatureMatches, sequence);
     }
 
     void applyPortHeuristics(const PacketContext& ctx, RiskAssessment& risk) {
@@ -378,17 +409,62 @@ namespace {
         }
     }
 
-    void applyBehaviorHeuristics(const PacketContext& ctx, const SessionInfo& session, RiskAssessment& risk) {
-        if (ctx.protocol == "TCP") {
-            if (ctx.payloadLength == 0 && session.count > 6) {
-                risk.correlationScore = std::max(risk.correlationScore, 0.65);
-                risk.correlationReason = "Repeated empty TCP frames";
-            }
-            if (ctx.payloadLength > 1400) {
-                risk.secondaryScore = std::max(risk.secondaryScore, 0.6);
-                if (risk.secondaryReason.empty()) risk.secondaryReason = "Oversized TCP payload";
+    void applyTlsHeuristics(const PacketContext& ctx, RiskAssessment& risk) {
+        if (ctx.tlsStatus == tls::ParseStatus::Malformed) {
+            risk.secondaryScore = std::max(risk.secondaryScore, 0.6);
+            risk.secondaryReason = "Malformed TLS ClientHello";
+            return;
+        }
+        if (ctx.tlsStatus != tls::ParseStatus::Complete) {
+            return;
+        }
+
+        if (ctx.tlsKnownFingerprint) {
+            risk.highRiskConfirmed = true;
+            risk.primaryScore = std::max(risk.primaryScore, 0.92);
+            risk.primaryReason = "Known malicious TLS fingerprint";
+        }
+
+        uint16_t version = ctx.tls.negotiatedVersion != 0 ? ctx.tls.negotiatedVersion : ctx.tls.helloVersion;
+        if (version < 0x0303) {
+            risk.secondaryScore = std::max(risk.secondaryScore, 0.6);
+            risk.secondaryReason = "Deprecated TLS version";
+        }
+
+        if (ctx.tls.sniLength == 0 && ctx.direction == "outbound") {
+            risk.secondaryScore = std::max(risk.secondaryScore, 0.5);
+            if (risk.secondaryReason.empty()) risk.secondaryReason = "TLS ClientHello without SNI";
+        }
+    }
+
+    void applySignatureHeuristics(const PacketContext& ctx, RiskAssessment& risk) {
+        const auto& scan = ctx.signatureMatches;
+        const signatures::Signature* strongest = nullptr;
+        for (size_t i = 0; i < scan.count; ++i) {
+            if (strongest == nullptr || scan.matches[i]->severity > strongest->severity) {
+                strongest = scan.matches[i];
             }
         }
+        if (strongest == nullptr) {
+            return;
+        }
+
+        risk.primaryScore = std::max(risk.primaryScore, strongest->severity);
+        risk.primaryReason = "Payload signature: " + strongest->name;
+        if (strongest->severity >= HIGH_RISK_THRESHOLD) {
+            risk.highRiskConfirmed = true;
+        }
+    }
+
+    // Checks that depend only on packet sizes and the flow's history, not on its
+    // content. The fast path runs them too, so a cached verdict cannot hide a
+    // scan, flood or beacon that builds up after the flow was first analyzed.
+    void applyCorrelationHeuristics(bool tcp, size_t payloadLength, const SessionInfo& session,
+                                    const behavior::Signals& signals, RiskAssessment& risk) {
+        if (tcp && payloadLength == 0 && session.count > 6) {
+            risk.correlationScore = std::max(risk.correlationScore, 0.65);
+            risk.correlationReason = "Repeated empty TCP frames";
+        }
 
         if (session.count > 20 && session.smallPayloadCount > 15) {
             risk.highRiskConfirmed = true;
@@ -396,6 +472,44 @@ namespace {
             risk.correlationReason = "Persistent low-latency stream";
         }
 
+        if (signals.hostsPerPort > HORIZONTAL_SCAN_THRESHOLD) {
+            risk.correlationScore = std::max(risk.correlationScore, 0.88);
+            risk.correlationReason = "Horizontal port scan";
+        } else if (signals.portsPerHost > VERTICAL_SCAN_THRESHOLD) {
+            risk.correlationScore = std::max(risk.correlationScore, 0.88);
+            risk.correlationReason = "Vertical port scan";
+        } else if (signals.destinationFanOut > FAN_OUT_THRESHOLD) {
+            risk.correlationScore = std::max(risk.correlationScore, 0.75);
+            risk.correlationReason = "Destination fan-out";
+        }
+
+        if (signals.packetsToDestination > FLOOD_PACKET_THRESHOLD &&
+            signals.smallPacketsToDestination * 2 > signals.packetsToDestination) {
+            risk.correlationScore = std::max(risk.correlationScore, 0.8);
+            risk.correlationReason = "Small-packet flood";
+        }
+
+        if (signals.beaconing) {
+            risk.correlationScore = std::max(risk.correlationScore, 0.78);
+            risk.correlationReason = "Periodic beaconing";
+        }
+
+        if (signals.appDistinctHosts > APP_HOST_SPREAD_THRESHOLD) {
+            risk.secondaryScore = std::max(risk.secondaryScore, 0.55);
+            if (risk.secondaryReason.empty()) risk.secondaryReason = "Unusual destination spread for app";
+        }
+    }
+
+    void applyBehaviorHeuristics(const PacketContext& ctx, const SessionInfo& session,
+                                 const behavior::Signals& signals, RiskAssessment& risk) {
+        const bool tcp = ctx.protocol == "TCP";
+        if (tcp && ctx.payloadLength > 1400) {
+            risk.secondaryScore = std::max(risk.secondaryScore, 0.6);
+            if (risk.secondaryReason.empty()) risk.secondaryReason = "Oversized TCP payload";
+        }
+
+        applyCorrelationHeuristics(tcp, ctx.payloadLength, session, signals, risk);
+
         if (ctx.entropy > 7.5 && ctx.payloadLength > 200) {
             risk.secondaryScore = std::max(risk.secondaryScore, 0.7);
             risk.secondaryReason = "High-entropy payload";
@@ -431,32 +545,90 @@ namespace {
         return "Low";
     }
 
-    PacketContext parsePacket(const std::vector<uint8_t>& rawData) {
+    uint64_t hashPackage(const std::string& packageName) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (unsigned char c : packageName) {
+            hash ^= c;
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    void recordMetrics(EngineMetrics& metrics, size_t bytes, bool valid, bool highRisk, bool blockedByFirewall) {
+        metrics.packets.fetch_add(1, std::memory_order_relaxed);
+        metrics.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        if (!valid) metrics.malformed.fetch_add(1, std::memory_order_relaxed);
+        if (highRisk) metrics.highRisk.fetch_add(1, std::memory_order_relaxed);
+        if (blockedByFirewall) metrics.firewallBlocks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::string overloadJson(overload::Mode mode, const overload::ShedCounts& shed) {
+        JsonBuilder json;
+        json.kv("mode", overload::modeName(mode));
+        json.kv("shedChecksums", shed.checksums);
+        json.kv("shedPayloads", shed.payloads);
+        json.kv("headerOnly", shed.headerOnly);
+        return json.str();
+    }
+
+    // Established flows (fast path) and header-only accounting skip parsing,
+    // inspection and heuristics; the JSON carries the flow's verdict plus the
+    // per-packet sizes. `extra` holds the trailing fields, already formatted.
+    PacketAnalysisResult compactResult(const conntrack::PacketHeader& header, const conntrack::Verdict& verdict,
+                                       bool blockedByFirewall, const char* extra) {
+        const bool highRisk = verdict.label == conntrack::RiskLabel::High;
+        const bool blocked = blockedByFirewall || highRisk;
+        const char* protocol = header.protocol == IPPROTO_TCP ? "TCP" : "UDP";
+
+        std::array<char, 512> buffer{};
+        int written = std::snprintf(
+                buffer.data(), buffer.size(),
+                "{\"bytes\":%zu,\"proto\":\"%s\",\"srcPort\":%u,\"dstPort\":%u,\"payloadBytes\":%zu,"
+                "\"riskLabel\":\"%s\",\"riskScore\":%g,\"firewallBlocked\":%s,\"blocked\":%s,"
+                "\"flowPackets\":%u,%s}",
+                header.length, protocol, static_cast<unsigned>(header.srcPort),
+                static_cast<unsigned>(header.dstPort), header.payloadLength,
+                conntrack::labelName(verdict.label), verdict.score,
+                blockedByFirewall ? "true" : "false", blocked ? "true" : "false",
+                verdict.flowPackets, extra);
+
+        PacketAnalysisResult result;
+        result.json.assign(buffer.data(), written > 0 ? std::min(static_cast<size_t>(written), buffer.size() - 1) : 0);
+        result.highRisk = highRisk;
+        result.blockedByFirewall = blockedByFirewall;
+        result.label = verdict.label;
+        result.riskScore = verdict.score;
+        return result;
+    }
+
+    PacketContext parsePacket(const uint8_t* data, size_t size, bool skipChecksums) {
         PacketContext ctx;
-        ctx.length = rawData.size();
-        ctx.tampered = rawData.empty();
+        ctx.length = size;
+        ctx.tampered = size == 0;
         ctx.hookSuspected = detectHooking();
 
-        if (rawData.empty()) {
+        if (size == 0) {
             return ctx;
         }
 
-        if (rawData.size() > MAX_PACKET_SIZE) {
+        if (size > MAX_PACKET_SIZE) {
             ctx.truncated = true;
         }
 
-        const uint8_t* bytes = rawData.data();
-        ctx.crc32 = computeCrc32(bytes, std::min(rawData.size(), MAX_PACKET_SIZE));
+        const uint8_t* bytes = data;
+        if (!skipChecksums) {
+            ctx.crc32 = computeCrc32(bytes, std::min(size, MAX_PACKET_SIZE));
+        }
 
         uint8_t version = (bytes[0] >> 4) & 0x0F;
         if (version == 4) {
-            if (rawData.size() < sizeof(iphdr)) {
+            if (size < sizeof(iphdr)) {
                 ctx.tampered = true;
                 return ctx;
             }
             const iphdr* ip = reinterpret_cast<const iphdr*>(bytes);
             size_t headerLen = static_cast<size_t>(ip->ihl) * 4u;
-            if (headerLen < sizeof(iphdr) || headerLen > rawData.size()) {
+            if (headerLen < sizeof(iphdr) || headerLen > size) {
                 ctx.tampered = true;
                 return ctx;
             }
@@ -473,7 +645,7 @@ namespace {
             }
 
             const uint8_t* l4 = bytes + headerLen;
-            size_t remain = rawData.size() - headerLen;
+            size_t remain = size - headerLen;
             ctx.payloadLength = remain;
 
             if (ip->protocol == IPPROTO_TCP && remain >= sizeof(tcphdr)) {
@@ -487,6 +659,8 @@ namespace {
                     return ctx;
                 }
                 ctx.payloadLength = remain - tcpHeaderLen;
+                ctx.payload = l4 + tcpHeaderLen;
+                ctx.tcpSeq = ntohl(tcp->seq);
             } else if (ip->protocol == IPPROTO_UDP && remain >= sizeof(udphdr)) {
                 ctx.protocol = "UDP";
                 const udphdr* udp = reinterpret_cast<const udphdr*>(l4);
@@ -494,6 +668,7 @@ namespace {
                 ctx.dstPort = ntohs(udp->dest);
                 size_t udpHeaderLen = sizeof(udphdr);
                 ctx.payloadLength = remain > udpHeaderLen ? remain - udpHeaderLen : 0;
+                ctx.payload = ctx.payloadLength > 0 ? l4 + udpHeaderLen : nullptr;
                 if (ctx.srcPort == 53 || ctx.dstPort == 53) {
                     const uint8_t* dnsPtr = l4 + udpHeaderLen;
                     size_t dnsLen = remain > udpHeaderLen ? remain - udpHeaderLen : 0;
@@ -502,7 +677,7 @@ namespace {
                 }
             }
         } else if (version == 6) {
-            if (rawData.size() < sizeof(ip6_hdr)) {
+            if (size < sizeof(ip6_hdr)) {
                 ctx.tampered = true;
                 return ctx;
             }
@@ -512,7 +687,7 @@ namespace {
             ctx.hopLimit = ip6->ip6_hlim;
 
             const uint8_t* l4 = bytes + sizeof(ip6_hdr);
-            size_t remain = rawData.size() - sizeof(ip6_hdr);
+            size_t remain = size - sizeof(ip6_hdr);
             ctx.payloadLength = remain;
             uint8_t next = ip6->ip6_nxt;
 
@@ -527,6 +702,8 @@ namespace {
                     return ctx;
                 }
                 ctx.payloadLength = remain - tcpHeaderLen;
+                ctx.payload = l4 + tcpHeaderLen;
+                ctx.tcpSeq = ntohl(tcp->seq);
             } else if (next == IPPROTO_UDP && remain >= sizeof(udphdr)) {
                 ctx.protocol = "UDP";
                 const udphdr* udp = reinterpret_cast<const udphdr*>(l4);
@@ -534,6 +711,7 @@ namespace {
                 ctx.dstPort = ntohs(udp->dest);
                 size_t udpHeaderLen = sizeof(udphdr);
                 ctx.payloadLength = remain > udpHeaderLen ? remain - udpHeaderLen : 0;
+                ctx.payload = ctx.payloadLength > 0 ? l4 + udpHeaderLen : nullptr;
                 if (ctx.srcPort == 53 || ctx.dstPort == 53) {
                     const uint8_t* dnsPtr = l4 + udpHeaderLen;
                     size_t dnsLen = remain > udpHeaderLen ? remain - udpHeaderLen : 0;
@@ -547,19 +725,196 @@ namespace {
         }
 
         ctx.valid = true;
-        ctx.entropy = calculateEntropy(rawData.data(), std::min(rawData.size(), static_cast<size_t>(512)));
+        if (!skipChecksums) {
+            ctx.entropy = calculateEntropy(data, std::min(size, static_cast<size_t>(512)));
+        }
         return ctx;
     }
 
 } // namespace
 
+PacketAnalyzer::PacketAnalyzer(NetGuardEngine& engine) : engine(engine) {}
+
+// Expires a few buckets per packet instead of walking the whole table, so the
+// per-packet cost stays flat however many sessions a snapshot restored. Stale
+// entries the sweep has not reached yet are discarded lazily: registerSession()
+// restarts their counts and exportSessions() leaves them out.
+void PacketAnalyzer::cleanupSessionsLocked(const std::chrono::steady_clock::time_point& now) {
+    const EngineConfig& config = engine.config();
+    const std::chrono::milliseconds expiration(config.sessionExpirationMs);
+    for (size_t n = 0; n < SWEEP_BUCKETS_PER_PACKET && !sessions.empty(); ++n) {
+        const size_t bucket = sweepBucket++ % sessions.bucket_count();
+        for (auto it = sessions.begin(bucket); it != sessions.end(bucket);) {
+            auto stale = it++;
+            if (now - stale->second.lastSeen > expiration) {
+                sessions.erase(sessions.find(stale->first));
+            }
+        }
+    }
+    if (sessions.size() > config.maxTrackedSessions) {
+        sessions.clear();
+    }
+}
+
+PacketAnalyzer::FlowObservation PacketAnalyzer::observeFlow(
+        std::string_view srcIp, std::string_view dstIp, int dstPort, size_t payloadLength,
+        const std::string& packageName, bool updateSketches, int64_t nowMs) {
+    std::string key;
+    if (!srcIp.empty() || !dstIp.empty()) {
+        key.reserve(srcIp.size() + dstIp.size() + 8);
+        key.append(srcIp).append("->").append(dstIp).append(1, ':');
+    } else {
+        key = "unknown:";
+    }
+    key += std::to_string(dstPort);
+
+    FlowObservation observed;
+    observed.session = registerSession(key, payloadLength);
+    if (updateSketches) {
+        behavior::Observation observation;
+        observation.sourceIp = srcIp;
+        observation.destinationIp = dstIp;
+        observation.appPackage = packageName;
+        observation.destinationPort = dstPort;
+        observation.payloadLength = payloadLength;
+        observation.timestampMs = nowMs;
+        observed.signals = engine.behaviorAnalytics().observe(observation);
+    }
+    return observed;
+}
+
+SessionInfo PacketAnalyzer::registerSession(const std::string& key, size_t payloadLength) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    cleanupSessionsLocked(now);
+
+    SessionInfo& info = sessions[key];
+    const auto idle = now - info.lastSeen;
+    if (idle < std::chrono::milliseconds(500) &&
+        idle <= std::chrono::milliseconds(engine.config().sessionExpirationMs)) {
+        info.count++;
+        if (payloadLength <= 150) {
+            info.smallPayloadCount++;
+        }
+    } else {
+        info.count = 1;
+        info.smallPayloadCount = payloadLength <= 150 ? 1 : 0;
+    }
+    info.lastSeen = now;
+    return info;
+}
+
 PacketAnalysisResult PacketAnalyzer::analyzePacket(
         const std::vector<uint8_t>& rawData,
         const std::string& packageName
 ) {
+    return analyzePacket(rawData.data(), rawData.size(), packageName);
+}
+
+PacketAnalysisResult PacketAnalyzer::analyzePacket(
+        const uint8_t* data,
+        size_t size,
+        const std::string& packageName
+) {
+    const auto started = std::chrono::steady_clock::now();
+    const int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(started.time_since_epoch()).count();
+    const uint64_t generation = engine.verdictGeneration();
+    overload::Controller& controller = engine.overload();
+    controller.tick(nowMs);
+    const overload::Mode engineMode = controller.mode();
+
+    conntrack::PacketHeader header;
+    conntrack::Verdict cached;
+    FlowObservation observed;
+    bool observedFlow = false;
+    bool escalated = false;
+    signatures::ScanResult fastScan;
+    bool fastScanned = false;
+    const bool trackable = conntrack::peekHeader(data, size, hashPackage(packageName), header);
+    if (trackable && engine.verdictCache().lookup(header, generation, nowMs, cached)) {
+        const FlowAddresses addresses = formatAddresses(data);
+        observed = observeFlow(addresses.src, addresses.dst, header.dstPort, header.payloadLength,
+                               packageName, true, nowMs);
+        observedFlow = true;
+
+        RiskAssessment correlation;
+        applyCorrelationHeuristics(header.protocol == IPPROTO_TCP, header.payloadLength,
+                                   observed.session, observed.signals, correlation);
+        // The payload still goes through the streaming signature scan so the
+        // automaton follows the whole flow; only TLS and the other payload checks
+        // are skipped.
+        if (header.payloadLength > 0) {
+            const int64_t sequence = header.protocol == IPPROTO_TCP ? static_cast<int64_t>(header.tcpSeq)
+                                                                    : signatures::NO_SEQUENCE;
+            engine.signatureScanner().scanFlow(computeFlowHash(addresses.src, addresses.dst,
+                                                               header.srcPort, header.dstPort),
+                                               data + size - header.payloadLength, header.payloadLength,
+                                               fastScan, sequence);
+            fastScanned = true;
+        }
+        escalated = correlation.correlationScore > cached.score ||
+                    (correlation.highRiskConfirmed && cached.label != conntrack::RiskLabel::High) ||
+                    fastScan.count > 0;
+        if (!escalated) {
+            PacketAnalysisResult fast = compactResult(header, cached, cached.blockedByFirewall, "\"fastPath\":true");
+            recordMetrics(engine.metrics(), header.length, true, fast.highRisk, fast.blockedByFirewall);
+            engine.metrics().fastPath.fetch_add(1, std::memory_order_relaxed);
+            return fast;
+        }
+        // The flow's behavior now outweighs its cached verdict, or its payload
+        // matched a signature: analyze this packet in full, reusing the accounting
+        // and the scan already done for it.
+    }
+
+    // Flows with high-risk history, flows whose behavior escalated past the cached
+    // verdict, and anything the flow table cannot key are always analyzed in full
+    // regardless of load.
+    const bool exempt = !trackable || cached.highRiskHistory || escalated;
+    overload::Mode mode = exempt ? overload::Mode::Full : engineMode;
+    if (mode == overload::Mode::HeaderOnly && !cached.known) {
+        mode = overload::Mode::SamplePayload;   // every flow gets one analyzed verdict first
+    }
+
+    if (mode == overload::Mode::HeaderOnly) {
+        controller.countHeaderOnly();
+        const FlowAddresses addresses = formatAddresses(data);
+        observeFlow(addresses.src, addresses.dst, header.dstPort, header.payloadLength, packageName, true, nowMs);
+        if (header.payloadLength > 0) {
+            engine.signatureScanner().skipFlow(computeFlowHash(addresses.src, addresses.dst,
+                                                               header.srcPort, header.dstPort));
+        }
+        const bool blockedByFirewall = !engine.rules().isAllowed(packageName);
+        const std::string extra = "\"approximate\":true,\"overload\":" + overloadJson(mode, controller.shedCounts());
+        PacketAnalysisResult shed = compactResult(header, cached, blockedByFirewall, extra.c_str());
+        shed.approximate = true;
+        recordMetrics(engine.metrics(), header.length, true, shed.highRisk, blockedByFirewall);
+        controller.recordCost(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - started).count(), nowMs);
+        return shed;
+    }
+
+    const bool skipChecksums = mode >= overload::Mode::SkipChecksums;
+    const bool skipPayload = mode >= overload::Mode::SamplePayload &&
+                             cached.flowPackets > engine.config().fastPathAfterPackets &&
+                             cached.flowPackets % PAYLOAD_SAMPLE_INTERVAL != 0;
+    if (skipChecksums) controller.countShedChecksums();
+    if (skipPayload) controller.countShedPayload();
+
     PacketAnalysisResult result;
 
-    PacketContext ctx = parsePacket(rawData);
+    PacketContext ctx = parsePacket(data, size, skipChecksums);
+    if (!skipPayload) {
+        inspectTls(engine, ctx);
+        if (fastScanned) {
+            ctx.signatureMatches = std::move(fastScan);
+        } else {
+            inspectPayload(engine, ctx);
+        }
+    } else if (ctx.valid && ctx.payloadLength > 0) {
+        // The scanner carries automaton state across segments; a skipped one
+        // breaks that stream, so the flow restarts at the next sampled packet.
+        engine.signatureScanner().skipFlow(computeFlowHash(ctx));
+    }
     JsonBuilder json;
     json.kv("bytes", static_cast<int64_t>(ctx.length));
     json.kv("crc32", static_cast<uint64_t>(ctx.crc32));
@@ -588,6 +943,29 @@ PacketAnalysisResult PacketAnalyzer::analyzePacket(
         json.raw("dns", dnsJson.str());
     }
 
+    if (ctx.tlsStatus == tls::ParseStatus::Complete) {
+        JsonBuilder tlsJson;
+        tlsJson.kv("version", tls::versionName(
+                ctx.tls.negotiatedVersion != 0 ? ctx.tls.negotiatedVersion : ctx.tls.helloVersion));
+        if (ctx.tls.sniLength > 0) tlsJson.kv("sni", ctx.tls.sni.data());
+        if (ctx.tls.alpnLength > 0) tlsJson.kv("alpn", ctx.tls.alpn.data());
+        tlsJson.kv("ja3", ctx.tls.ja3.data());
+        tlsJson.kv("ja4", ctx.tls.ja4.data());
+        tlsJson.kv("knownFingerprint", ctx.tlsKnownFingerprint);
+        tlsJson.kv("reassembled", ctx.tls.reassembled);
+        json.raw("tls", tlsJson.str());
+    }
+
+    if (ctx.signatureMatches.count > 0) {
+        std::string ids = "[";
+        for (size_t i = 0; i < ctx.signatureMatches.count; ++i) {
+            if (i > 0) ids += ',';
+            ids += std::to_string(ctx.signatureMatches.matches[i]->id);
+        }
+        ids += ']';
+        json.raw("signatures", ids);
+    }
+
     RiskAssessment risk;
     if (!ctx.valid) {
         risk.highRiskConfirmed = true;
@@ -602,14 +980,30 @@ PacketAnalysisResult PacketAnalyzer::analyzePacket(
         __android_log_print(ANDROID_LOG_WARN, LOG_TAG, "Packet integrity violation detected");
     }
 
-    const std::string sessionKey = (!ctx.srcIp.empty() || !ctx.dstIp.empty())
-                                   ? (ctx.srcIp + "->" + ctx.dstIp + ':' + std::to_string(ctx.dstPort))
-                                   : std::string("unknown:") + std::to_string(ctx.dstPort);
-    SessionInfo sessionInfo = registerSession(sessionKey, ctx.payloadLength);
+    if (!observedFlow) {
+        observed = observeFlow(ctx.srcIp, ctx.dstIp, ctx.dstPort, ctx.payloadLength, packageName, ctx.valid, nowMs);
+    }
+    const SessionInfo& sessionInfo = observed.session;
+    const behavior::Signals& behaviorSignals = observed.signals;
+    if (ctx.valid) {
+        JsonBuilder behaviorJson;
+        behaviorJson.kv("fanOut", static_cast<int64_t>(behaviorSignals.destinationFanOut));
+        behaviorJson.kv("portsPerHost", static_cast<int64_t>(behaviorSignals.portsPerHost));
+        behaviorJson.kv("hostsPerPort", static_cast<int64_t>(behaviorSignals.hostsPerPort));
+        behaviorJson.kv("appHosts", behaviorSignals.appDistinctHosts);
+        behaviorJson.kv("appPorts", behaviorSignals.appDistinctPorts);
+        behaviorJson.kv("beaconing", behaviorSignals.beaconing);
+        if (behaviorSignals.beaconPeriodSeconds > 0.0) {
+            behaviorJson.kv("beaconPeriod", behaviorSignals.beaconPeriodSeconds);
+        }
+        json.raw("behavior", behaviorJson.str());
+    }
 
     applyPortHeuristics(ctx, risk);
     applyDnsHeuristics(ctx, risk);
-    applyBehaviorHeuristics(ctx, sessionInfo, risk);
+    applyTlsHeuristics(ctx, risk);
+    applySignatureHeuristics(ctx, risk);
+    applyBehaviorHeuristics(ctx, sessionInfo, behaviorSignals, risk);
 
     if (ctx.direction == "inbound" && ctx.payloadLength > 512 && ctx.entropy > 6.5) {
         risk.secondaryScore = std::max(risk.secondaryScore, 0.7);
@@ -633,7 +1027,7 @@ PacketAnalysisResult PacketAnalyzer::analyzePacket(
     json.kv("riskLabel", label);
     json.kv("riskScore", finalScore);
 
-    bool blockedByFirewall = !firewall::isAllowed(packageName);
+    bool blockedByFirewall = !engine.rules().isAllowed(packageName);
     if (blockedByFirewall) {
         __android_log_print(ANDROID_LOG_INFO, LOG_TAG,
                             "Firewall blocked packet for package %s", packageName.c_str());
@@ -651,8 +1045,94 @@ PacketAnalysisResult PacketAnalyzer::analyzePacket(
     assurance.kv("highRiskConfirmed", risk.highRiskConfirmed);
     json.raw("assurance", assurance.str());
 
+    if (engineMode != overload::Mode::Full) {
+        json.kv("approximate", skipChecksums || skipPayload);
+        json.raw("overload", overloadJson(mode, controller.shedCounts()));
+    }
+
+    recordMetrics(engine.metrics(), ctx.length, ctx.valid, label == "High", blockedByFirewall);
+    const conntrack::RiskLabel riskLabel = label == "High" ? conntrack::RiskLabel::High
+                                         : label == "Medium" ? conntrack::RiskLabel::Medium
+                                         : conntrack::RiskLabel::Low;
+    if (trackable && ctx.valid) {
+        conntrack::Verdict verdict;
+        verdict.label = riskLabel;
+        verdict.score = finalScore;
+        verdict.blockedByFirewall = blockedByFirewall;
+        engine.verdictCache().store(header, generation, nowMs, verdict);
+    }
+    if (mode == engineMode) {
+        controller.recordCost(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - started).count(), nowMs);
+    }
+
     result.json = json.str();
     result.highRisk = (label == "High");
     result.blockedByFirewall = blockedByFirewall;
+    result.approximate = engineMode != overload::Mode::Full && (skipChecksums || skipPayload);
+    result.label = riskLabel;
+    result.riskScore = finalScore;
     return result;
-}
\ No newline at end of file
+}
+
+void PacketAnalyzer::exportFlow(const uint8_t* data, size_t size, const std::string& packageName,
+                                const PacketAnalysisResult& result, bool blocked) {
+    flowexport::Exporter& exporter = engine.flowExporter();
+    conntrack::PacketHeader header;
+    if (!exporter.enabled() || !conntrack::peekHeader(data, size, hashPackage(packageName), header)) {
+        return;
+    }
+    const int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    const flowexport::BlockReason reason = !blocked ? flowexport::BlockReason::None
+                                         : result.blockedByFirewall ? flowexport::BlockReason::Firewall
+                                         : flowexport::BlockReason::Risk;
+    exporter.account(data, header, packageName, result.label, result.riskScore, reason, nowMs);
+}
+
+std::vector<SessionRecord> PacketAnalyzer::exportSessions() {
+    auto now = std::chrono::steady_clock::now();
+    const std::chrono::milliseconds expiration(engine.config().sessionExpirationMs);
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    std::vector<SessionRecord> records;
+    records.reserve(sessions.size());
+    for (const auto& [key, info] : sessions) {
+        if (now - info.lastSeen > expiration) {
+            continue;
+        }
+        SessionRecord record;
+        record.key = key;
+        record.ageMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - info.lastSeen).count();
+        record.count = info.count;
+        record.smallPayloadCount = info.smallPayloadCount;
+        records.push_back(std::move(record));
+    }
+    return records;
+}
+
+size_t PacketAnalyzer::restoreSessions(std::vector<SessionRecord>&& records, int64_t elapsedMs) {
+    auto now = std::chrono::steady_clock::now();
+    const EngineConfig& config = engine.config();
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    sessions.reserve(std::min(sessions.size() + records.size(), config.maxTrackedSessions));
+    size_t restored = 0;
+    for (auto& record : records) {
+        if (sessions.size() >= config.maxTrackedSessions) {
+            break;
+        }
+        std::chrono::milliseconds age(record.ageMs + std::max<int64_t>(elapsedMs, 0));
+        if (age.count() > config.sessionExpirationMs) {
+            continue;
+        }
+        auto [slot, inserted] = sessions.try_emplace(std::move(record.key));
+        if (!inserted) {
+            continue;
+        }
+        SessionInfo& info = slot->second;
+        info.lastSeen = now - age;
+        info.count = static_cast<size_t>(record.count);
+        info.smallPayloadCount = static_cast<size_t>(record.smallPayloadCount);
+        ++restored;
+    }
+    return restored;
+}
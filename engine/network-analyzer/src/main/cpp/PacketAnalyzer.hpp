@@ -5,21 +5,86 @@
 #ifndef PACKET_ANALYZER_H
 #define PACKET_ANALYZER_H
 
+#include "BehaviorAnalytics.hpp"
+#include "FlowVerdictCache.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+class NetGuardEngine;
+
 struct PacketAnalysisResult {
     std::string json;
     bool highRisk = false;
     bool blockedByFirewall = false;
+    bool approximate = false;   // some detection work was shed under load
+    conntrack::RiskLabel label = conntrack::RiskLabel::Low;
+    double riskScore = 0.0;
+};
+
+struct SessionRecord {
+    std::string key;
+    int64_t ageMs = 0;
+    uint64_t count = 0;
+    uint64_t smallPayloadCount = 0;
+};
+
+struct SessionInfo {
+    std::chrono::steady_clock::time_point lastSeen{};
+    size_t count = 0;
+    size_t smallPayloadCount = 0;
 };
 
 class PacketAnalyzer {
 public:
-    static PacketAnalysisResult analyzePacket(
+    explicit PacketAnalyzer(NetGuardEngine& engine);
+
+    PacketAnalysisResult analyzePacket(
             const std::vector<uint8_t>& rawData,
             const std::string& packageName = ""
     );
+
+    PacketAnalysisResult analyzePacket(
+            const uint8_t* data,
+            size_t size,
+            const std::string& packageName = ""
+    );
+
+    // Accounts one packet in the flow export under the verdict it was given.
+    // analyzePacket() does not export: the path that owns the packet (forwarder
+    // or capture) calls this once per packet. `blocked` is what that path did with
+    // the packet; a High verdict that was still forwarded carries no block reason.
+    void exportFlow(const uint8_t* data, size_t size, const std::string& packageName,
+                    const PacketAnalysisResult& result, bool blocked);
+
+    std::vector<SessionRecord> exportSessions();
+
+    // `elapsedMs` is the wall time that passed since the records were exported.
+    size_t restoreSessions(std::vector<SessionRecord>&& records, int64_t elapsedMs);
+
+private:
+    // Per-packet correlation state: the session counters and the behavior sketches.
+    // Every analyzed packet, fast path included, is counted exactly once.
+    struct FlowObservation {
+        SessionInfo session;
+        behavior::Signals signals;
+    };
+
+    FlowObservation observeFlow(std::string_view srcIp, std::string_view dstIp, int dstPort,
+                                size_t payloadLength, const std::string& packageName,
+                                bool updateSketches, int64_t nowMs);
+    SessionInfo registerSession(const std::string& key, size_t payloadLength);
+    void cleanupSessionsLocked(const std::chrono::steady_clock::time_point& now);
+
+    NetGuardEngine& engine;
+    std::mutex sessionMutex;
+    std::unordered_map<std::string, SessionInfo> sessions;
+    size_t sweepBucket = 0;   // next bucket cleanupSessionsLocked() expires
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include <jni.h>
+#include <memory>
+#include <string>
+#include <android/log.h>
+
+#include "JniRegistration.hpp"
+#include "NetGuardEngine.hpp"
+
+#define LOG_TAG "SignatureBridge"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+    jint loadSignatureDatabase(
+            JNIEnv* env,
+            jobject /* this */,
+            jlong handle,
+            jstring path
+    ) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        if (engine == nullptr || path == nullptr) {
+            return -1;
+        }
+        const char* pathChars = env->GetStringUTFChars(path, nullptr);
+        if (pathChars == nullptr) {
+            return -1;
+        }
+
+        std::string filePath(pathChars);
+        env->ReleaseStringUTFChars(path, pathChars);
+
+        int loaded = engine->signatureScanner().loadDatabase(filePath);
+        if (loaded < 0) {
+            LOGE("Unable to read payload signature database: %s", filePath.c_str());
+        } else {
+            LOGI("Loaded %d payload signatures from %s", loaded, filePath.c_str());
+        }
+        return loaded;
+    }
+
+    const JNINativeMethod SIGNATURE_METHODS[] = {
+            {"loadSignatureDatabase", "(JLjava/lang/String;)I", reinterpret_cast<void*>(loadSignatureDatabase)},
+    };
+
+} // namespace
+
+namespace jni {
+
+    bool registerSignatureNatives(JNIEnv* env, jclass bridge) {
+        return env->RegisterNatives(bridge, SIGNATURE_METHODS,
+                                    sizeof(SIGNATURE_METHODS) / sizeof(SIGNATURE_METHODS[0])) == JNI_OK;
+    }
+
+} // namespace jni
\ No newline at end of file
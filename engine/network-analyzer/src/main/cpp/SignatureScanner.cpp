@@ -0,0 +1,467 @@
+#include "SignatureScanner.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// NETGUARD_SCALAR_PREFILTER forces the portable prefilter loop on any target;
+// the host tests build both variants and check that they agree.
+#if defined(__SSSE3__) && !defined(NETGUARD_SCALAR_PREFILTER)
+#define PREFILTER_SSSE3 1
+#include <tmmintrin.h>
+#elif defined(__aarch64__) && !defined(NETGUARD_SCALAR_PREFILTER)
+#define PREFILTER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace signatures {
+
+    namespace {
+
+        constexpr uint32_t ROOT_STATE = 0;
+        constexpr uint32_t NO_ROW = 0xFFFFFFFFu;
+        constexpr size_t DENSE_DEPTH = 2;          // states this shallow get full rows
+        constexpr size_t MAX_PATTERN_LENGTH = 255;
+        constexpr std::chrono::seconds FLOW_EXPIRATION(30);
+
+    } // namespace
+
+    // Teddy-style prefilter: each pattern is assigned to one of 8 buckets and its
+    // first two bytes set that bucket's bit in nibble-indexed masks. A position can
+    // only start a match if the AND of the four lookups is non-zero.
+    struct Prefilter {
+        alignas(16) std::array<uint8_t, 16> lo0{};
+        alignas(16) std::array<uint8_t, 16> hi0{};
+        alignas(16) std::array<uint8_t, 16> lo1{};
+        alignas(16) std::array<uint8_t, 16> hi1{};
+
+        bool candidate(uint8_t b0, uint8_t b1) const {
+            return (lo0[b0 & 0xF] & hi0[b0 >> 4] & lo1[b1 & 0xF] & hi1[b1 >> 4]) != 0;
+        }
+
+        bool candidateLast(uint8_t b0) const {
+            return (lo0[b0 & 0xF] & hi0[b0 >> 4]) != 0;
+        }
+
+        size_t next(const uint8_t* data, size_t len, size_t pos) const;
+    };
+
+    size_t Prefilter::next(const uint8_t* data, size_t len, size_t pos) const {
+#if defined(PREFILTER_SSSE3)
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        const __m128i l0 = _mm_load_si128(reinterpret_cast<const __m128i*>(lo0.data()));
+        const __m128i h0 = _mm_load_si128(reinterpret_cast<const __m128i*>(hi0.data()));
+        const __m128i l1 = _mm_load_si128(reinterpret_cast<const __m128i*>(lo1.data()));
+        const __m128i h1 = _mm_load_si128(reinterpret_cast<const __m128i*>(hi1.data()));
+        while (pos + 17 <= len) {
+            __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+            __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 1));
+            __m128i m0 = _mm_and_si128(_mm_shuffle_epi8(l0, _mm_and_si128(v0, nibble)),
+                                       _mm_shuffle_epi8(h0, _mm_and_si128(_mm_srli_epi16(v0, 4), nibble)));
+            __m128i m1 = _mm_and_si128(_mm_shuffle_epi8(l1, _mm_and_si128(v1, nibble)),
+                                       _mm_shuffle_epi8(h1, _mm_and_si128(_mm_srli_epi16(v1, 4), nibble)));
+            __m128i hits = _mm_and_si128(m0, m1);
+            unsigned empty = static_cast<unsigned>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(hits, _mm_setzero_si128())));
+            if (empty != 0xFFFFu) {
+                return pos + static_cast<size_t>(__builtin_ctz(~empty & 0xFFFFu));
+            }
+            pos += 16;
+        }
+#elif defined(PREFILTER_NEON)
+        const uint8x16_t nibble = vdupq_n_u8(0x0F);
+        const uint8x16_t l0 = vld1q_u8(lo0.data());
+        const uint8x16_t h0 = vld1q_u8(hi0.data());
+        const uint8x16_t l1 = vld1q_u8(lo1.data());
+        const uint8x16_t h1 = vld1q_u8(hi1.data());
+        while (pos + 17 <= len) {
+            uint8x16_t v0 = vld1q_u8(data + pos);
+            uint8x16_t v1 = vld1q_u8(data + pos + 1);
+            uint8x16_t m0 = vandq_u8(vqtbl1q_u8(l0, vandq_u8(v0, nibble)), vqtbl1q_u8(h0, vshrq_n_u8(v0, 4)));
+            uint8x16_t m1 = vandq_u8(vqtbl1q_u8(l1, vandq_u8(v1, nibble)), vqtbl1q_u8(h1, vshrq_n_u8(v1, 4)));
+            if (vmaxvq_u8(vandq_u8(m0, m1)) != 0) {
+                break;
+            }
+            pos += 16;
+        }
+#endif
+        for (; pos + 1 < len; ++pos) {
+            if (candidate(data[pos], data[pos + 1])) return pos;
+        }
+        if (pos < len && candidateLast(data[pos])) return pos;
+        return len;
+    }
+
+    struct Database {
+        uint64_t version = 0;
+        std::array<uint16_t, 256> byteClass{};
+        uint32_t classCount = 1;
+
+        std::vector<uint32_t> denseRow;        // per state: row in `dense` or NO_ROW
+        std::vector<uint32_t> dense;           // fully resolved rows, classCount wide
+        std::vector<uint32_t> sparseBegin;     // per state + 1
+        std::vector<uint16_t> sparseClass;     // sorted per state
+        std::vector<uint32_t> sparseTarget;
+        std::vector<uint32_t> fail;
+        std::vector<uint32_t> outputBegin;     // per state + 1, failure outputs merged
+        std::vector<uint32_t> outputs;         // indices into `signatures`
+
+        std::vector<Signature> signatures;
+        Prefilter prefilter;
+
+        uint32_t step(uint32_t state, uint8_t byte) const {
+            const uint16_t cls = byteClass[byte];
+            while (true) {
+                uint32_t row = denseRow[state];
+                if (row != NO_ROW) {
+                    return dense[static_cast<size_t>(row) * classCount + cls];
+                }
+                auto begin = sparseClass.begin() + sparseBegin[state];
+                auto end = sparseClass.begin() + sparseBegin[state + 1];
+                auto it = std::lower_bound(begin, end, cls);
+                if (it != end && *it == cls) {
+                    return sparseTarget[static_cast<size_t>(it - sparseClass.begin())];
+                }
+                state = fail[state];
+            }
+        }
+    };
+
+    namespace {
+
+        struct PendingSignature {
+            Signature signature;
+            std::string pattern;
+        };
+
+        bool decodePattern(const std::string& text, std::string& out) {
+            out.clear();
+            for (size_t i = 0; i < text.size(); ++i) {
+                char c = text[i];
+                if (c != '\\') {
+                    out.push_back(c);
+                    continue;
+                }
+                if (i + 1 >= text.size()) return false;
+                char next = text[++i];
+                if (next == '\\') {
+                    out.push_back('\\');
+                } else if (next == 'x' && i + 2 < text.size()) {
+                    char hex[3] = {text[i + 1], text[i + 2], '\0'};
+                    char* end = nullptr;
+                    long value = std::strtol(hex, &end, 16);
+                    if (end != hex + 2) return false;
+                    out.push_back(static_cast<char>(value));
+                    i += 2;
+                } else {
+                    return false;
+                }
+            }
+            return !out.empty() && out.size() <= MAX_PATTERN_LENGTH;
+        }
+
+        bool parseLine(const std::string& line, PendingSignature& out) {
+            size_t start = line.find_first_not_of(" \t\r");
+            if (start == std::string::npos || line[start] == '#') return false;
+
+            std::array<std::string, 4> fields;
+            size_t field = 0;
+            size_t pos = start;
+            while (field < 3) {
+                size_t tab = line.find('\t', pos);
+                if (tab == std::string::npos) return false;
+                fields[field++] = line.substr(pos, tab - pos);
+                pos = tab + 1;
+            }
+            fields[3] = line.substr(pos);
+            while (!fields[3].empty() && (fields[3].back() == '\r' || fields[3].back() == '\n')) {
+                fields[3].pop_back();
+            }
+
+            char* end = nullptr;
+            unsigned long id = std::strtoul(fields[0].c_str(), &end, 10);
+            if (end == fields[0].c_str()) return false;
+            double severity = std::strtod(fields[1].c_str(), &end);
+            if (end == fields[1].c_str()) return false;
+
+            out.signature.id = static_cast<uint32_t>(id);
+            out.signature.severity = std::min(std::max(severity, 0.0), 1.0);
+            out.signature.name = fields[2];
+            return decodePattern(fields[3], out.pattern);
+        }
+
+        std::shared_ptr<Database> compile(std::vector<PendingSignature>& pending) {
+            auto db = std::make_shared<Database>();
+
+            std::array<bool, 256> used{};
+            for (const auto& entry : pending) {
+                for (unsigned char c : entry.pattern) used[c] = true;
+            }
+            for (size_t b = 0; b < 256; ++b) {
+                db->byteClass[b] = used[b] ? static_cast<uint16_t>(db->classCount++) : 0;
+            }
+
+            // Trie construction.
+            std::vector<std::map<uint16_t, uint32_t>> children(1);
+            std::vector<size_t> depth(1, 0);
+            std::vector<std::vector<uint32_t>> terminal(1);
+            for (uint32_t index = 0; index < pending.size(); ++index) {
+                uint32_t state = ROOT_STATE;
+                for (unsigned char c : pending[index].pattern) {
+                    uint16_t cls = db->byteClass[c];
+                    auto it = children[state].find(cls);
+                    if (it == children[state].end()) {
+                        uint32_t created = static_cast<uint32_t>(children.size());
+                        children[state][cls] = created;
+                        children.emplace_back();
+                        depth.push_back(depth[state] + 1);
+                        terminal.emplace_back();
+                        state = created;
+                    } else {
+                        state = it->second;
+                    }
+                }
+                terminal[state].push_back(index);
+            }
+
+            const size_t stateCount = children.size();
+            db->fail.assign(stateCount, ROOT_STATE);
+            db->denseRow.assign(stateCount, NO_ROW);
+
+            // Breadth-first failure links; dense rows are resolved in the same order so
+            // a state's failure row is always complete before it is consulted.
+            std::vector<uint32_t> order;
+            order.reserve(stateCount);
+            std::deque<uint32_t> queue;
+            queue.push_back(ROOT_STATE);
+            while (!queue.empty()) {
+                uint32_t state = queue.front();
+                queue.pop_front();
+                order.push_back(state);
+                for (const auto& [cls, child] : children[state]) {
+                    if (state != ROOT_STATE) {
+                        uint32_t f = db->fail[state];
+                        while (true) {
+                            auto it = children[f].find(cls);
+                            if (it != children[f].end()) {
+                                db->fail[child] = it->second;
+                                break;
+                            }
+                            if (f == ROOT_STATE) break;
+                            f = db->fail[f];
+                        }
+                    }
+                    queue.push_back(child);
+                }
+            }
+
+            uint32_t rows = 0;
+            for (uint32_t state : order) {
+                if (depth[state] > DENSE_DEPTH) continue;
+                db->denseRow[state] = rows++;
+                db->dense.resize(static_cast<size_t>(rows) * db->classCount);
+                uint32_t* row = &db->dense[static_cast<size_t>(rows - 1) * db->classCount];
+                for (uint32_t cls = 0; cls < db->classCount; ++cls) {
+                    auto it = children[state].find(static_cast<uint16_t>(cls));
+                    if (it != children[state].end()) {
+                        row[cls] = it->second;
+                    } else if (state == ROOT_STATE) {
+                        row[cls] = ROOT_STATE;
+                    } else {
+                        uint32_t failRow = db->denseRow[db->fail[state]];
+                        row[cls] = db->dense[static_cast<size_t>(failRow) * db->classCount + cls];
+                    }
+                }
+            }
+
+            db->sparseBegin.assign(stateCount + 1, 0);
+            for (uint32_t state = 0; state < stateCount; ++state) {
+                db->sparseBegin[state] = static_cast<uint32_t>(db->sparseClass.size());
+                if (db->denseRow[state] != NO_ROW) continue;
+                for (const auto& [cls, child] : children[state]) {
+                    db->sparseClass.push_back(cls);
+                    db->sparseTarget.push_back(child);
+                }
+            }
+            db->sparseBegin[stateCount] = static_cast<uint32_t>(db->sparseClass.size());
+
+            // Outputs in BFS order so each state can append its failure state's list.
+            std::vector<std::vector<uint32_t>> merged(stateCount);
+            for (uint32_t state : order) {
+                merged[state] = terminal[state];
+                if (state != ROOT_STATE) {
+                    const auto& inherited = merged[db->fail[state]];
+                    merged[state].insert(merged[state].end(), inherited.begin(), inherited.end());
+                }
+            }
+            db->outputBegin.assign(stateCount + 1, 0);
+            for (uint32_t state = 0; state < stateCount; ++state) {
+                db->outputBegin[state] = static_cast<uint32_t>(db->outputs.size());
+                db->outputs.insert(db->outputs.end(), merged[state].begin(), merged[state].end());
+            }
+            db->outputBegin[stateCount] = static_cast<uint32_t>(db->outputs.size());
+
+            for (uint32_t index = 0; index < pending.size(); ++index) {
+                const std::string& pattern = pending[index].pattern;
+                uint8_t b0 = static_cast<uint8_t>(pattern[0]);
+                uint8_t bucket = static_cast<uint8_t>(1u << ((b0 * 31u + index) & 7u));
+                db->prefilter.lo0[b0 & 0xF] |= bucket;
+                db->prefilter.hi0[b0 >> 4] |= bucket;
+                if (pattern.size() > 1) {
+                    uint8_t b1 = static_cast<uint8_t>(pattern[1]);
+                    db->prefilter.lo1[b1 & 0xF] |= bucket;
+                    db->prefilter.hi1[b1 >> 4] |= bucket;
+                } else {
+                    for (size_t n = 0; n < 16; ++n) {
+                        db->prefilter.lo1[n] |= bucket;
+                        db->prefilter.hi1[n] |= bucket;
+                    }
+                }
+            }
+
+            db->signatures.reserve(pending.size());
+            for (auto& entry : pending) {
+                db->signatures.push_back(std::move(entry.signature));
+            }
+            return db;
+        }
+
+        // Hash of the whole payload, a word at a time.
+        uint64_t payloadDigest(const uint8_t* data, size_t len) {
+            auto mix = [](uint64_t x) {
+                x ^= x >> 33;
+                x *= 0xff51afd7ed558ccdull;
+                x ^= x >> 33;
+                return x;
+            };
+            uint64_t hash = mix(0xcbf29ce484222325ull ^ len);
+            size_t i = 0;
+            for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+                uint64_t word;
+                std::memcpy(&word, data + i, sizeof(word));
+                hash = mix(hash ^ word) * 0x100000001b3ull;
+            }
+            uint64_t tail = 0;
+            std::memcpy(&tail, data + i, len - i);
+            return mix(hash ^ tail);
+        }
+
+        void record(const Database& db, uint32_t state, ScanResult& out) {
+            for (uint32_t i = db.outputBegin[state]; i < db.outputBegin[state + 1]; ++i) {
+                const Signature* signature = &db.signatures[db.outputs[i]];
+                bool seen = false;
+                for (size_t m = 0; m < out.count; ++m) {
+                    if (out.matches[m] == signature) {
+                        seen = true;
+                        break;
+                    }
+                }
+                if (!seen && out.count < MAX_MATCHES_PER_SCAN) {
+                    out.matches[out.count++] = signature;
+                }
+            }
+        }
+
+    } // namespace
+
+    int Scanner::loadDatabase(const std::string& path) {
+        std::ifstream input(path);
+        if (!input.is_open()) {
+            return -1;
+        }
+
+        std::vector<PendingSignature> pending;
+        std::string line;
+        PendingSignature entry;
+        while (std::getline(input, line)) {
+            if (parseLine(line, entry)) {
+                pending.push_back(std::move(entry));
+                entry = PendingSignature{};
+            }
+        }
+
+        std::shared_ptr<Database> db = compile(pending);
+        db->version = version.fetch_add(1) + 1;
+        int count = static_cast<int>(db->signatures.size());
+        std::atomic_store(&database, std::shared_ptr<const Database>(db));
+        return count;
+    }
+
+    uint64_t Scanner::databaseVersion() const {
+        return version.load();
+    }
+
+    void Scanner::scanFlow(uint64_t flowHash, const uint8_t* data, size_t len, ScanResult& out,
+                           int64_t tcpSequence) {
+        out.database = std::atomic_load(&database);
+        out.count = 0;
+        out.scannedBytes = 0;
+        if (!out.database || out.database->signatures.empty() || data == nullptr || len == 0) {
+            return;
+        }
+        const Database& db = *out.database;
+
+        auto now = std::chrono::steady_clock::now();
+        const uint64_t digest = tcpSequence != NO_SEQUENCE ? payloadDigest(data, len) : 0;
+        uint32_t state = ROOT_STATE;
+        FlowState* slot = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(flowMutex);
+            slot = &flows[flowHash % FLOW_SLOTS];
+            if (slot->flowHash != flowHash || slot->version != db.version ||
+                now - slot->lastTouched > FLOW_EXPIRATION) {
+                *slot = FlowState{};
+                slot->flowHash = flowHash;
+                slot->version = db.version;
+            } else if (tcpSequence != NO_SEQUENCE && slot->lastSequence == tcpSequence &&
+                       slot->lastDigest == digest) {
+                // Retransmitted segment: rescan from the state that preceded it instead
+                // of carrying the state across itself.
+                slot->state = slot->previousState;
+            }
+            state = slot->state;
+        }
+        const uint32_t initialState = state;
+
+        size_t pos = 0;
+        while (pos < len) {
+            if (state == ROOT_STATE) {
+                pos = db.prefilter.next(data, len, pos);
+                if (pos >= len) break;
+            }
+            state = db.step(state, data[pos++]);
+            if (db.outputBegin[state] != db.outputBegin[state + 1]) {
+                record(db, state, out);
+            }
+        }
+        out.scannedBytes = len;
+
+        std::lock_guard<std::mutex> lock(flowMutex);
+        if (slot->flowHash == flowHash && slot->version == db.version) {
+            slot->previousState = initialState;
+            slot->state = state;
+            slot->lastSequence = tcpSequence;
+            slot->lastDigest = digest;
+            slot->lastTouched = now;
+        }
+    }
+
+    void Scanner::skipFlow(uint64_t flowHash) {
+        std::lock_guard<std::mutex> lock(flowMutex);
+        FlowState& slot = flows[flowHash % FLOW_SLOTS];
+        if (slot.flowHash == flowHash) {
+            slot.state = ROOT_STATE;
+            slot.previousState = ROOT_STATE;
+            slot.lastSequence = NO_SEQUENCE;
+            slot.lastDigest = 0;
+        }
+    }
+
+} // namespace signatures
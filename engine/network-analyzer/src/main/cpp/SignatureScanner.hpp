@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace signatures {
+
+    constexpr size_t MAX_MATCHES_PER_SCAN = 8;
+    constexpr size_t FLOW_SLOTS = 1024;
+    constexpr int64_t NO_SEQUENCE = -1;     // payloads without a TCP sequence number
+
+    struct Signature {
+        uint32_t id = 0;
+        double severity = 0.0;
+        std::string name;
+    };
+
+    struct Database;
+
+    struct ScanResult {
+        // Keeps the database (and therefore the signature names) alive even if a new
+        // database is swapped in while the caller is still reporting.
+        std::shared_ptr<const Database> database;
+        std::array<const Signature*, MAX_MATCHES_PER_SCAN> matches{};
+        size_t count = 0;
+        size_t scannedBytes = 0;
+    };
+
+    class Scanner {
+    public:
+        // Loads a signature file and atomically replaces the active database.
+        // Format, one signature per line ('#' comments):
+        //     <id> <TAB> <severity 0..1> <TAB> <name> <TAB> <pattern>
+        // Patterns are literal bytes; "\xHH" and "\\" escapes are accepted.
+        // Returns the number of signatures compiled, or -1 if the file cannot be read.
+        int loadDatabase(const std::string& path);
+
+        // Scans one payload of a flow. The automaton state is carried per flow so a
+        // signature split across consecutive packets still matches. A TCP segment
+        // that repeats the previous one's sequence number and bytes is a
+        // retransmission and is rescanned from the state that preceded it.
+        void scanFlow(uint64_t flowHash, const uint8_t* data, size_t len, ScanResult& out,
+                      int64_t tcpSequence = NO_SEQUENCE);
+
+        // Records that a payload of the flow went by without being scanned. The
+        // carried state no longer continues into the next packet, so the flow
+        // restarts from the root instead of matching across the gap.
+        void skipFlow(uint64_t flowHash);
+
+        // Increments every time a new database is installed.
+        uint64_t databaseVersion() const;
+
+    private:
+        struct FlowState {
+            uint64_t flowHash = 0;
+            uint64_t version = 0;
+            uint32_t state = 0;
+            uint32_t previousState = 0;
+            int64_t lastSequence = NO_SEQUENCE;
+            uint64_t lastDigest = 0;
+            std::chrono::steady_clock::time_point lastTouched{};
+        };
+
+        std::shared_ptr<const Database> database;
+        std::atomic<uint64_t> version{0};
+
+        std::mutex flowMutex;
+        std::array<FlowState, FLOW_SLOTS> flows;
+    };
+
+} // namespace signatures
@@ -0,0 +1,96 @@
+#include <jni.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <android/log.h>
+
+#include "EngineSnapshot.hpp"
+#include "JniRegistration.hpp"
+#include "NetGuardEngine.hpp"
+
+#define LOG_TAG "SnapshotBridge"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+    bool readPath(JNIEnv* env, jstring path, std::string& out) {
+        if (path == nullptr) {
+            return false;
+        }
+        const char* pathChars = env->GetStringUTFChars(path, nullptr);
+        if (pathChars == nullptr) {
+            return false;
+        }
+        out.assign(pathChars);
+        env->ReleaseStringUTFChars(path, pathChars);
+        return true;
+    }
+
+    jboolean saveEngineSnapshot(
+            JNIEnv* env,
+            jobject /* this */,
+            jlong handle,
+            jstring path
+    ) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        std::string filePath;
+        if (engine == nullptr || !readPath(env, path, filePath)) {
+            return JNI_FALSE;
+        }
+        bool saved = snapshot::save(*engine, filePath);
+        if (!saved) {
+            LOGE("Unable to write engine snapshot: %s", filePath.c_str());
+        }
+        return saved ? JNI_TRUE : JNI_FALSE;
+    }
+
+    jboolean restoreEngineSnapshot(
+            JNIEnv* env,
+            jobject /* this */,
+            jlong handle,
+            jstring path
+    ) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        std::string filePath;
+        if (engine == nullptr || !readPath(env, path, filePath)) {
+            return JNI_FALSE;
+        }
+
+        snapshot::RestoreStats stats;
+        const auto started = std::chrono::steady_clock::now();
+        const snapshot::RestoreStatus status = snapshot::restore(*engine, filePath, stats);
+        const double elapsedMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - started).count();
+        switch (status) {
+            case snapshot::RestoreStatus::Restored:
+                LOGI("Engine snapshot restored in %.1f ms: %zu sessions, behavior=%s",
+                     elapsedMs, stats.sessions, stats.behavior ? "yes" : "no");
+                return JNI_TRUE;
+            case snapshot::RestoreStatus::Missing:
+                return JNI_FALSE;
+            case snapshot::RestoreStatus::IncompatibleVersion:
+                LOGI("Ignoring engine snapshot with incompatible version: %s", filePath.c_str());
+                return JNI_FALSE;
+            case snapshot::RestoreStatus::Corrupt:
+                LOGE("Rejected corrupt engine snapshot: %s", filePath.c_str());
+                return JNI_FALSE;
+        }
+        return JNI_FALSE;
+    }
+
+    const JNINativeMethod SNAPSHOT_METHODS[] = {
+            {"saveEngineSnapshot", "(JLjava/lang/String;)Z", reinterpret_cast<void*>(saveEngineSnapshot)},
+            {"restoreEngineSnapshot", "(JLjava/lang/String;)Z", reinterpret_cast<void*>(restoreEngineSnapshot)},
+    };
+
+} // namespace
+
+namespace jni {
+
+    bool registerSnapshotNatives(JNIEnv* env, jclass bridge) {
+        return env->RegisterNatives(bridge, SNAPSHOT_METHODS,
+                                    sizeof(SNAPSHOT_METHODS) / sizeof(SNAPSHOT_METHODS[0])) == JNI_OK;
+    }
+
+} // namespace jni
\ No newline at end of file
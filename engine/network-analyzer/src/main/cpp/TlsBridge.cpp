@@ -0,0 +1,55 @@
+#include <jni.h>
+#include <memory>
+#include <string>
+#include <android/log.h>
+
+#include "JniRegistration.hpp"
+#include "NetGuardEngine.hpp"
+
+#define LOG_TAG "TlsBridge"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+    jint loadTlsFingerprints(
+            JNIEnv* env,
+            jobject /* this */,
+            jlong handle,
+            jstring path
+    ) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        if (engine == nullptr || path == nullptr) {
+            return -1;
+        }
+        const char* pathChars = env->GetStringUTFChars(path, nullptr);
+        if (pathChars == nullptr) {
+            return -1;
+        }
+
+        std::string filePath(pathChars);
+        env->ReleaseStringUTFChars(path, pathChars);
+
+        int loaded = engine->tlsFingerprints().load(filePath);
+        if (loaded < 0) {
+            LOGE("Unable to read TLS fingerprint set: %s", filePath.c_str());
+        } else {
+            LOGI("Loaded %d TLS fingerprints from %s", loaded, filePath.c_str());
+        }
+        return loaded;
+    }
+
+    const JNINativeMethod TLS_METHODS[] = {
+            {"loadTlsFingerprints", "(JLjava/lang/String;)I", reinterpret_cast<void*>(loadTlsFingerprints)},
+    };
+
+} // namespace
+
+namespace jni {
+
+    bool registerTlsNatives(JNIEnv* env, jclass bridge) {
+        return env->RegisterNatives(bridge, TLS_METHODS,
+                                    sizeof(TLS_METHODS) / sizeof(TLS_METHODS[0])) == JNI_OK;
+    }
+
+} // namespace jni
\ No newline at end of file
@@ -0,0 +1,684 @@
+#include "TlsInspector.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace tls {
+
+    namespace {
+
+        constexpr uint8_t CONTENT_TYPE_HANDSHAKE = 0x16;
+        constexpr uint8_t HANDSHAKE_CLIENT_HELLO = 0x01;
+        constexpr size_t RECORD_HEADER_LENGTH = 5;
+        constexpr size_t HANDSHAKE_HEADER_LENGTH = 4;
+        constexpr size_t MAX_RECORD_LENGTH = 16384 + 2048;   // RFC 8446 5.2
+
+        constexpr uint16_t EXT_SERVER_NAME = 0x0000;
+        constexpr uint16_t EXT_SUPPORTED_GROUPS = 0x000a;
+        constexpr uint16_t EXT_EC_POINT_FORMATS = 0x000b;
+        constexpr uint16_t EXT_SIGNATURE_ALGORITHMS = 0x000d;
+        constexpr uint16_t EXT_ALPN = 0x0010;
+        constexpr uint16_t EXT_SUPPORTED_VERSIONS = 0x002b;
+
+        constexpr std::chrono::seconds REASSEMBLY_EXPIRATION(5);
+
+        constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+        bool isGrease(uint16_t value) {
+            return (value & 0x0F0Fu) == 0x0A0Au && (value >> 8) == (value & 0xFFu);
+        }
+
+        struct Reader {
+            const uint8_t* data;
+            size_t length;
+            size_t offset = 0;
+            bool failed = false;
+
+            Reader(const uint8_t* d, size_t len) : data(d), length(len) {}
+
+            size_t remaining() const { return failed ? 0 : length - offset; }
+
+            bool require(size_t n) {
+                if (failed || length - offset < n) {
+                    failed = true;
+                    return false;
+                }
+                return true;
+            }
+
+            uint8_t u8() {
+                if (!require(1)) return 0;
+                return data[offset++];
+            }
+
+            uint16_t u16() {
+                if (!require(2)) return 0;
+                uint16_t value = static_cast<uint16_t>((data[offset] << 8) | data[offset + 1]);
+                offset += 2;
+                return value;
+            }
+
+            const uint8_t* take(size_t n) {
+                if (!require(n)) return nullptr;
+                const uint8_t* ptr = data + offset;
+                offset += n;
+                return ptr;
+            }
+
+            Reader sub(size_t n) {
+                const uint8_t* ptr = take(n);
+                Reader child(ptr, ptr != nullptr ? n : 0);
+                child.failed = ptr == nullptr;
+                return child;
+            }
+        };
+
+        // Bounded text sink used to build fingerprint inputs on the stack.
+        struct TextBuffer {
+            std::array<char, 2048> data{};
+            size_t length = 0;
+
+            void put(char c) {
+                if (length < data.size()) data[length++] = c;
+            }
+
+            void putDecimal(unsigned value) {
+                char digits[10];
+                size_t n = 0;
+                do {
+                    digits[n++] = static_cast<char>('0' + value % 10);
+                    value /= 10;
+                } while (value != 0);
+                while (n > 0) put(digits[--n]);
+            }
+
+            void putHex16(uint16_t value) {
+                put(HEX_DIGITS[(value >> 12) & 0xF]);
+                put(HEX_DIGITS[(value >> 8) & 0xF]);
+                put(HEX_DIGITS[(value >> 4) & 0xF]);
+                put(HEX_DIGITS[value & 0xF]);
+            }
+
+            const uint8_t* bytes() const { return reinterpret_cast<const uint8_t*>(data.data()); }
+        };
+
+        uint32_t rotl(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+        uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+        void md5(const uint8_t* message, size_t length, uint8_t digest[16]) {
+            static constexpr uint32_t K[64] = {
+                    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+                    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+                    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+                    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+                    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+                    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+                    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+                    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+            static constexpr int S[64] = {
+                    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+                    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+                    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+                    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+
+            uint32_t h[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+            const uint64_t bitLength = static_cast<uint64_t>(length) * 8u;
+            const size_t blocks = (length + 8) / 64 + 1;
+
+            for (size_t block = 0; block < blocks; ++block) {
+                uint8_t chunk[64];
+                for (size_t i = 0; i < 64; ++i) {
+                    size_t index = block * 64 + i;
+                    if (index < length) {
+                        chunk[i] = message[index];
+                    } else if (index == length) {
+                        chunk[i] = 0x80;
+                    } else if (index >= blocks * 64 - 8) {
+                        chunk[i] = static_cast<uint8_t>(bitLength >> (8 * (index - (blocks * 64 - 8))));
+                    } else {
+                        chunk[i] = 0;
+                    }
+                }
+
+                uint32_t w[16];
+                for (int i = 0; i < 16; ++i) {
+                    w[i] = static_cast<uint32_t>(chunk[i * 4]) |
+                           (static_cast<uint32_t>(chunk[i * 4 + 1]) << 8) |
+                           (static_cast<uint32_t>(chunk[i * 4 + 2]) << 16) |
+                           (static_cast<uint32_t>(chunk[i * 4 + 3]) << 24);
+                }
+
+                uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+                for (int i = 0; i < 64; ++i) {
+                    uint32_t f;
+                    int g;
+                    if (i < 16) {
+                        f = (b & c) | (~b & d);
+                        g = i;
+                    } else if (i < 32) {
+                        f = (d & b) | (~d & c);
+                        g = (5 * i + 1) % 16;
+                    } else if (i < 48) {
+                        f = b ^ c ^ d;
+                        g = (3 * i + 5) % 16;
+                    } else {
+                        f = c ^ (b | ~d);
+                        g = (7 * i) % 16;
+                    }
+                    uint32_t next = d;
+                    d = c;
+                    c = b;
+                    b = b + rotl(a + f + K[i] + w[g], S[i]);
+                    a = next;
+                }
+                h[0] += a;
+                h[1] += b;
+                h[2] += c;
+                h[3] += d;
+            }
+
+            for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 4; ++j) {
+                    digest[i * 4 + j] = static_cast<uint8_t>(h[i] >> (8 * j));
+                }
+            }
+        }
+
+        void sha256(const uint8_t* message, size_t length, uint8_t digest[32]) {
+            static constexpr uint32_t K[64] = {
+                    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+            uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                             0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+            const uint64_t bitLength = static_cast<uint64_t>(length) * 8u;
+            const size_t blocks = (length + 8) / 64 + 1;
+
+            for (size_t block = 0; block < blocks; ++block) {
+                uint8_t chunk[64];
+                for (size_t i = 0; i < 64; ++i) {
+                    size_t index = block * 64 + i;
+                    if (index < length) {
+                        chunk[i] = message[index];
+                    } else if (index == length) {
+                        chunk[i] = 0x80;
+                    } else if (index >= blocks * 64 - 8) {
+                        chunk[i] = static_cast<uint8_t>(bitLength >> (8 * (blocks * 64 - 1 - index)));
+                    } else {
+                        chunk[i] = 0;
+                    }
+                }
+
+                uint32_t w[64];
+                for (int i = 0; i < 16; ++i) {
+                    w[i] = (static_cast<uint32_t>(chunk[i * 4]) << 24) |
+                           (static_cast<uint32_t>(chunk[i * 4 + 1]) << 16) |
+                           (static_cast<uint32_t>(chunk[i * 4 + 2]) << 8) |
+                           static_cast<uint32_t>(chunk[i * 4 + 3]);
+                }
+                for (int i = 16; i < 64; ++i) {
+                    uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                    uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+                }
+
+                uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+                uint32_t e = h[4], f = h[5], g = h[6], k = h[7];
+                for (int i = 0; i < 64; ++i) {
+                    uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+                    uint32_t ch = (e & f) ^ (~e & g);
+                    uint32_t t1 = k + s1 + ch + K[i] + w[i];
+                    uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+                    uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+                    uint32_t t2 = s0 + maj;
+                    k = g;
+                    g = f;
+                    f = e;
+                    e = d + t1;
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = t1 + t2;
+                }
+                h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+                h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+            }
+
+            for (int i = 0; i < 8; ++i) {
+                digest[i * 4] = static_cast<uint8_t>(h[i] >> 24);
+                digest[i * 4 + 1] = static_cast<uint8_t>(h[i] >> 16);
+                digest[i * 4 + 2] = static_cast<uint8_t>(h[i] >> 8);
+                digest[i * 4 + 3] = static_cast<uint8_t>(h[i]);
+            }
+        }
+
+        void writeHex(const uint8_t* digest, size_t digits, char* out) {
+            for (size_t i = 0; i < digits; ++i) {
+                uint8_t byte = digest[i / 2];
+                out[i] = HEX_DIGITS[(i % 2 == 0) ? (byte >> 4) : (byte & 0xF)];
+            }
+        }
+
+        template <size_t N>
+        void putDashList(TextBuffer& text, const std::array<uint16_t, N>& values, size_t count) {
+            bool first = true;
+            for (size_t i = 0; i < count; ++i) {
+                if (isGrease(values[i])) continue;
+                if (!first) text.put('-');
+                text.putDecimal(values[i]);
+                first = false;
+            }
+        }
+
+        template <size_t N>
+        size_t copySortedWithoutGrease(const std::array<uint16_t, N>& values, size_t count,
+                                       std::array<uint16_t, N>& out,
+                                       bool skipSniAndAlpn) {
+            size_t n = 0;
+            for (size_t i = 0; i < count; ++i) {
+                uint16_t value = values[i];
+                if (isGrease(value)) continue;
+                if (skipSniAndAlpn && (value == EXT_SERVER_NAME || value == EXT_ALPN)) continue;
+                out[n++] = value;
+            }
+            std::sort(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(n));
+            return n;
+        }
+
+        void computeJa3(ClientHelloInfo& info) {
+            TextBuffer text;
+            text.putDecimal(info.helloVersion);
+            text.put(',');
+            putDashList(text, info.ciphers, info.cipherCount);
+            text.put(',');
+            putDashList(text, info.extensions, info.extensionCount);
+            text.put(',');
+            putDashList(text, info.groups, info.groupCount);
+            text.put(',');
+            for (size_t i = 0; i < info.pointFormatCount; ++i) {
+                if (i > 0) text.put('-');
+                text.putDecimal(info.pointFormats[i]);
+            }
+
+            uint8_t digest[16];
+            md5(text.bytes(), text.length, digest);
+            writeHex(digest, 32, info.ja3.data());
+            info.ja3[32] = '\0';
+        }
+
+        void truncatedSha256(const TextBuffer& text, char* out) {
+            if (text.length == 0) {
+                std::memset(out, '0', 12);
+                return;
+            }
+            uint8_t digest[32];
+            sha256(text.bytes(), text.length, digest);
+            writeHex(digest, 12, out);
+        }
+
+        bool isAlnum(char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        }
+
+        void computeJa4(ClientHelloInfo& info) {
+            char* out = info.ja4.data();
+            out[0] = 't';
+
+            uint16_t version = info.negotiatedVersion != 0 ? info.negotiatedVersion : info.helloVersion;
+            const char* versionCode = "00";
+            switch (version) {
+                case 0x0304: versionCode = "13"; break;
+                case 0x0303: versionCode = "12"; break;
+                case 0x0302: versionCode = "11"; break;
+                case 0x0301: versionCode = "10"; break;
+                case 0x0300: versionCode = "s3"; break;
+                default: break;
+            }
+            out[1] = versionCode[0];
+            out[2] = versionCode[1];
+            out[3] = info.sniLength > 0 ? 'd' : 'i';
+
+            size_t ciphers = 0;
+            for (size_t i = 0; i < info.cipherCount; ++i) {
+                if (!isGrease(info.ciphers[i])) ++ciphers;
+            }
+            size_t extensions = 0;
+            for (size_t i = 0; i < info.extensionCount; ++i) {
+                if (!isGrease(info.extensions[i])) ++extensions;
+            }
+            ciphers = std::min<size_t>(ciphers, 99);
+            extensions = std::min<size_t>(extensions, 99);
+            out[4] = static_cast<char>('0' + ciphers / 10);
+            out[5] = static_cast<char>('0' + ciphers % 10);
+            out[6] = static_cast<char>('0' + extensions / 10);
+            out[7] = static_cast<char>('0' + extensions % 10);
+
+            if (info.alpnLength == 0) {
+                out[8] = '0';
+                out[9] = '0';
+            } else {
+                char first = info.alpnFirst;
+                char last = info.alpnLast;
+                if (isAlnum(first) && isAlnum(last)) {
+                    out[8] = first;
+                    out[9] = last;
+                } else {
+                    out[8] = HEX_DIGITS[(static_cast<uint8_t>(first) >> 4) & 0xF];
+                    out[9] = HEX_DIGITS[static_cast<uint8_t>(last) & 0xF];
+                }
+            }
+            out[10] = '_';
+
+            std::array<uint16_t, MAX_CIPHERS> sortedCiphers{};
+            size_t cipherTotal = copySortedWithoutGrease(info.ciphers, info.cipherCount, sortedCiphers, false);
+            TextBuffer cipherText;
+            for (size_t i = 0; i < cipherTotal; ++i) {
+                if (i > 0) cipherText.put(',');
+                cipherText.putHex16(sortedCiphers[i]);
+            }
+            truncatedSha256(cipherText, out + 11);
+            out[23] = '_';
+
+            std::array<uint16_t, MAX_EXTENSIONS> sortedExtensions{};
+            size_t extensionTotal = copySortedWithoutGrease(info.extensions, info.extensionCount,
+                                                            sortedExtensions, true);
+            TextBuffer extensionText;
+            for (size_t i = 0; i < extensionTotal; ++i) {
+                if (i > 0) extensionText.put(',');
+                extensionText.putHex16(sortedExtensions[i]);
+            }
+            if (info.signatureAlgorithmCount > 0) {
+                extensionText.put('_');
+                for (size_t i = 0; i < info.signatureAlgorithmCount; ++i) {
+                    if (i > 0) extensionText.put(',');
+                    extensionText.putHex16(info.signatureAlgorithms[i]);
+                }
+            }
+            truncatedSha256(extensionText, out + 24);
+            out[36] = '\0';
+        }
+
+        void parseExtension(uint16_t type, Reader body, ClientHelloInfo& out) {
+            switch (type) {
+                case EXT_SERVER_NAME: {
+                    Reader list = body.sub(body.u16());
+                    while (list.remaining() >= 3) {
+                        uint8_t nameType = list.u8();
+                        uint16_t nameLength = list.u16();
+                        const uint8_t* name = list.take(nameLength);
+                        if (name == nullptr) break;
+                        if (nameType == 0 && out.sniLength == 0) {
+                            size_t n = std::min<size_t>(nameLength, MAX_SNI_LENGTH);
+                            std::memcpy(out.sni.data(), name, n);
+                            out.sni[n] = '\0';
+                            out.sniLength = n;
+                        }
+                    }
+                    break;
+                }
+                case EXT_ALPN: {
+                    Reader list = body.sub(body.u16());
+                    uint8_t protocolLength = list.u8();
+                    const uint8_t* protocol = list.take(protocolLength);
+                    if (protocol != nullptr && protocolLength > 0) {
+                        size_t n = std::min<size_t>(protocolLength, MAX_ALPN_LENGTH);
+                        std::memcpy(out.alpn.data(), protocol, n);
+                        out.alpn[n] = '\0';
+                        out.alpnLength = n;
+                        out.alpnFirst = static_cast<char>(protocol[0]);
+                        out.alpnLast = static_cast<char>(protocol[protocolLength - 1]);
+                    }
+                    break;
+                }
+                case EXT_SUPPORTED_GROUPS: {
+                    Reader list = body.sub(body.u16());
+                    while (list.remaining() >= 2) {
+                        uint16_t group = list.u16();
+                        if (out.groupCount < MAX_GROUPS) out.groups[out.groupCount++] = group;
+                    }
+                    break;
+                }
+                case EXT_EC_POINT_FORMATS: {
+                    Reader list = body.sub(body.u8());
+                    while (list.remaining() >= 1) {
+                        uint8_t format = list.u8();
+                        if (out.pointFormatCount < MAX_POINT_FORMATS) {
+                            out.pointFormats[out.pointFormatCount++] = format;
+                        }
+                    }
+                    break;
+                }
+                case EXT_SIGNATURE_ALGORITHMS: {
+                    Reader list = body.sub(body.u16());
+                    while (list.remaining() >= 2) {
+                        uint16_t algorithm = list.u16();
+                        if (out.signatureAlgorithmCount < MAX_SIGNATURE_ALGORITHMS) {
+                            out.signatureAlgorithms[out.signatureAlgorithmCount++] = algorithm;
+                        }
+                    }
+                    break;
+                }
+                case EXT_SUPPORTED_VERSIONS: {
+                    Reader list = body.sub(body.u8());
+                    while (list.remaining() >= 2) {
+                        uint16_t version = list.u16();
+                        if (!isGrease(version) && version > out.negotiatedVersion) {
+                            out.negotiatedVersion = version;
+                        }
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        uint64_t fnv1a(const char* data, size_t length) {
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (size_t i = 0; i < length; ++i) {
+                char c = data[i];
+                if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 0x100000001b3ull;
+            }
+            return hash;
+        }
+
+        bool seqBeforeOrEqual(uint32_t a, uint32_t b) {
+            return static_cast<int32_t>(a - b) <= 0;
+        }
+
+    } // namespace
+
+    ParseStatus parseClientHello(const uint8_t* data, size_t len, ClientHelloInfo& out) {
+        if (len == 0 || data[0] != CONTENT_TYPE_HANDSHAKE) {
+            return ParseStatus::NotClientHello;
+        }
+        if (len >= 2 && data[1] != 0x03) {
+            return ParseStatus::NotClientHello;
+        }
+        if (len < RECORD_HEADER_LENGTH + HANDSHAKE_HEADER_LENGTH) {
+            return ParseStatus::Incomplete;
+        }
+
+        size_t recordLength = (static_cast<size_t>(data[3]) << 8) | data[4];
+        if (recordLength < HANDSHAKE_HEADER_LENGTH || recordLength > MAX_RECORD_LENGTH) {
+            return ParseStatus::Malformed;
+        }
+        if (data[5] != HANDSHAKE_CLIENT_HELLO) {
+            return ParseStatus::NotClientHello;
+        }
+
+        size_t helloLength = (static_cast<size_t>(data[6]) << 16) |
+                             (static_cast<size_t>(data[7]) << 8) | data[8];
+        if (helloLength + HANDSHAKE_HEADER_LENGTH > recordLength) {
+            // ClientHello fragmented over several records; not worth reassembling here.
+            return ParseStatus::NotClientHello;
+        }
+        if (len < RECORD_HEADER_LENGTH + HANDSHAKE_HEADER_LENGTH + helloLength) {
+            return ParseStatus::Incomplete;
+        }
+
+        out = ClientHelloInfo{};
+        out.recordVersion = static_cast<uint16_t>((data[1] << 8) | data[2]);
+
+        Reader hello(data + RECORD_HEADER_LENGTH + HANDSHAKE_HEADER_LENGTH, helloLength);
+        out.helloVersion = hello.u16();
+        hello.take(32);                       // random
+        hello.take(hello.u8());               // legacy session id
+
+        Reader cipherList = hello.sub(hello.u16());
+        while (cipherList.remaining() >= 2) {
+            uint16_t cipher = cipherList.u16();
+            if (out.cipherCount < MAX_CIPHERS) out.ciphers[out.cipherCount++] = cipher;
+        }
+        hello.take(hello.u8());               // compression methods
+        if (hello.failed || cipherList.failed) {
+            return ParseStatus::Malformed;
+        }
+
+        if (hello.remaining() > 0) {
+            Reader extensionList = hello.sub(hello.u16());
+            while (extensionList.remaining() >= 4) {
+                uint16_t type = extensionList.u16();
+                uint16_t length = extensionList.u16();
+                Reader body = extensionList.sub(length);
+                if (body.failed) break;
+                if (out.extensionCount < MAX_EXTENSIONS) out.extensions[out.extensionCount++] = type;
+                parseExtension(type, body, out);
+            }
+            if (hello.failed || extensionList.failed) {
+                return ParseStatus::Malformed;
+            }
+        }
+
+        computeJa3(out);
+        computeJa4(out);
+        return ParseStatus::Complete;
+    }
+
+    Reassembler::Slot* Reassembler::findSlotLocked(uint64_t flowHash) {
+        for (auto& slot : slots) {
+            if (slot.used && slot.flowHash == flowHash) return &slot;
+        }
+        return nullptr;
+    }
+
+    Reassembler::Slot& Reassembler::acquireSlotLocked(const std::chrono::steady_clock::time_point& now) {
+        Slot* oldest = &slots[0];
+        for (auto& slot : slots) {
+            if (!slot.used || now - slot.lastTouched > REASSEMBLY_EXPIRATION) {
+                return slot;
+            }
+            if (slot.lastTouched < oldest->lastTouched) oldest = &slot;
+        }
+        return *oldest;
+    }
+
+    ParseStatus Reassembler::inspectSegment(uint64_t flowHash, uint32_t seq,
+                                            const uint8_t* payload, size_t len,
+                                            ClientHelloInfo& out) {
+        if (payload == nullptr || len == 0) {
+            return ParseStatus::NotClientHello;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        Slot* slot = findSlotLocked(flowHash);
+
+        if (slot == nullptr) {
+            ParseStatus status = parseClientHello(payload, len, out);
+            if (status == ParseStatus::Incomplete && len < REASSEMBLY_CAPACITY) {
+                Slot& fresh = acquireSlotLocked(now);
+                fresh.used = true;
+                fresh.flowHash = flowHash;
+                fresh.nextSeq = seq + static_cast<uint32_t>(len);
+                fresh.length = len;
+                fresh.lastTouched = now;
+                std::memcpy(fresh.data.data(), payload, len);
+            }
+            return status;
+        }
+
+        if (seq != slot->nextSeq) {
+            if (seqBeforeOrEqual(seq + static_cast<uint32_t>(len), slot->nextSeq)) {
+                // Retransmission or the same segment analyzed twice.
+                return ParseStatus::Incomplete;
+            }
+            slot->used = false;
+            return parseClientHello(payload, len, out);
+        }
+
+        if (slot->length + len > REASSEMBLY_CAPACITY) {
+            slot->used = false;
+            return ParseStatus::NotClientHello;
+        }
+
+        std::memcpy(slot->data.data() + slot->length, payload, len);
+        slot->length += len;
+        slot->nextSeq += static_cast<uint32_t>(len);
+        slot->lastTouched = now;
+
+        ParseStatus status = parseClientHello(slot->data.data(), slot->length, out);
+        if (status != ParseStatus::Incomplete) {
+            slot->used = false;
+            out.reassembled = status == ParseStatus::Complete;
+        }
+        return status;
+    }
+
+    int FingerprintSet::load(const std::string& path) {
+        std::ifstream input(path);
+        if (!input.is_open()) {
+            return -1;
+        }
+
+        std::vector<uint64_t> fingerprints;
+        std::string line;
+        while (std::getline(input, line)) {
+            size_t start = line.find_first_not_of(" \t\r");
+            if (start == std::string::npos || line[start] == '#') continue;
+            size_t end = line.find_first_of(" \t\r#", start);
+            if (end == std::string::npos) end = line.size();
+            fingerprints.push_back(fnv1a(line.data() + start, end - start));
+        }
+        std::sort(fingerprints.begin(), fingerprints.end());
+        fingerprints.erase(std::unique(fingerprints.begin(), fingerprints.end()), fingerprints.end());
+
+        int count = static_cast<int>(fingerprints.size());
+        std::lock_guard<std::mutex> lock(mutex);
+        hashes.swap(fingerprints);
+        generation.fetch_add(1, std::memory_order_release);
+        return count;
+    }
+
+    bool FingerprintSet::contains(const ClientHelloInfo& info) const {
+        uint64_t ja3 = fnv1a(info.ja3.data(), std::strlen(info.ja3.data()));
+        uint64_t ja4 = fnv1a(info.ja4.data(), std::strlen(info.ja4.data()));
+        std::lock_guard<std::mutex> lock(mutex);
+        if (hashes.empty()) {
+            return false;
+        }
+        return std::binary_search(hashes.begin(), hashes.end(), ja3) ||
+               std::binary_search(hashes.begin(), hashes.end(), ja4);
+    }
+
+    std::string versionName(uint16_t version) {
+        switch (version) {
+            case 0x0304: return "TLS1.3";
+            case 0x0303: return "TLS1.2";
+            case 0x0302: return "TLS1.1";
+            case 0x0301: return "TLS1.0";
+            case 0x0300: return "SSL3.0";
+            default: return "unknown";
+        }
+    }
+
+} // namespace tls
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tls {
+
+    constexpr size_t MAX_SNI_LENGTH = 255;
+    constexpr size_t MAX_ALPN_LENGTH = 32;
+    constexpr size_t MAX_CIPHERS = 96;
+    constexpr size_t MAX_EXTENSIONS = 48;
+    constexpr size_t MAX_GROUPS = 32;
+    constexpr size_t MAX_POINT_FORMATS = 8;
+    constexpr size_t MAX_SIGNATURE_ALGORITHMS = 48;
+    constexpr size_t REASSEMBLY_SLOTS = 32;
+    constexpr size_t REASSEMBLY_CAPACITY = 4096;
+
+    enum class ParseStatus {
+        NotClientHello,
+        Incomplete,
+        Complete,
+        Malformed
+    };
+
+    // Fixed-size view of a ClientHello. Parsing never allocates; lists longer than
+    // the caps above are truncated (the fingerprints are then computed on the prefix).
+    struct ClientHelloInfo {
+        uint16_t recordVersion = 0;
+        uint16_t helloVersion = 0;
+        uint16_t negotiatedVersion = 0;
+
+        std::array<char, MAX_SNI_LENGTH + 1> sni{};
+        size_t sniLength = 0;
+        std::array<char, MAX_ALPN_LENGTH + 1> alpn{};
+        size_t alpnLength = 0;
+        // JA4 takes the first and last character of the whole first protocol,
+        // which the display copy above loses when it is truncated.
+        char alpnFirst = 0;
+        char alpnLast = 0;
+
+        std::array<uint16_t, MAX_CIPHERS> ciphers{};
+        size_t cipherCount = 0;
+        std::array<uint16_t, MAX_EXTENSIONS> extensions{};
+        size_t extensionCount = 0;
+        std::array<uint16_t, MAX_GROUPS> groups{};
+        size_t groupCount = 0;
+        std::array<uint8_t, MAX_POINT_FORMATS> pointFormats{};
+        size_t pointFormatCount = 0;
+        std::array<uint16_t, MAX_SIGNATURE_ALGORITHMS> signatureAlgorithms{};
+        size_t signatureAlgorithmCount = 0;
+
+        std::array<char, 33> ja3{};   // MD5 hex digest of the JA3 string
+        std::array<char, 37> ja4{};   // JA4 "a_b_c" fingerprint
+        bool reassembled = false;
+    };
+
+    // Parses a TLS record stream that starts at `data`. Returns Incomplete when the
+    // record header announces more bytes than are available.
+    ParseStatus parseClientHello(const uint8_t* data, size_t len, ClientHelloInfo& out);
+
+    // Buffers ClientHellos split across TCP segments in a small fixed pool of
+    // per-flow slots until the handshake message is complete.
+    class Reassembler {
+    public:
+        // Feeds one TCP segment of a flow. Retransmitted or re-analyzed segments
+        // are ignored.
+        ParseStatus inspectSegment(uint64_t flowHash, uint32_t seq,
+                                   const uint8_t* payload, size_t len,
+                                   ClientHelloInfo& out);
+
+    private:
+        struct Slot {
+            bool used = false;
+            uint64_t flowHash = 0;
+            uint32_t nextSeq = 0;
+            size_t length = 0;
+            std::chrono::steady_clock::time_point lastTouched{};
+            std::array<uint8_t, REASSEMBLY_CAPACITY> data{};
+        };
+
+        Slot* findSlotLocked(uint64_t flowHash);
+        Slot& acquireSlotLocked(const std::chrono::steady_clock::time_point& now);
+
+        std::mutex mutex;
+        std::array<Slot, REASSEMBLY_SLOTS> slots;
+    };
+
+    // Sorted set of fingerprint hashes (JA3 MD5 or JA4 strings).
+    class FingerprintSet {
+    public:
+        // Loads one fingerprint per line ('#' comments) and replaces the current set.
+        // Returns the number of fingerprints loaded, or -1 if the file cannot be read.
+        int load(const std::string& path);
+
+        bool contains(const ClientHelloInfo& info) const;
+
+        // Increments every time a new set is loaded.
+        uint64_t version() const { return generation.load(std::memory_order_acquire); }
+
+    private:
+        mutable std::mutex mutex;
+        std::vector<uint64_t> hashes;
+        std::atomic<uint64_t> generation{0};
+    };
+
+    std::string versionName(uint16_t version);
+
+} // namespace tls
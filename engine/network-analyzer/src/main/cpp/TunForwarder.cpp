@@ -0,0 +1,1344 @@
+#include "TunForwarder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace tun {
+
+    namespace {
+
+        constexpr size_t RING_CAPACITY = 64 * 1024;
+        constexpr size_t MAX_POOLED_RINGS = 64;
+        constexpr size_t OUT_BATCH = 64;             // queued replies that trigger an early flush
+        constexpr size_t MAX_OUT_QUEUE = 4096;
+        constexpr size_t TUN_READ_BURST = 64;
+        constexpr size_t UDP_READ_BURST = 32;
+        constexpr int EPOLL_BATCH = 64;
+        constexpr int TICK_MS = 200;
+        constexpr int64_t TCP_RTO_MS = 1000;
+        constexpr int TCP_MAX_RETRANSMITS = 6;
+        constexpr int64_t TCP_HANDSHAKE_MS = 30000;
+        constexpr int64_t TCP_CLOSING_MS = 30000;
+        constexpr int64_t TCP_IDLE_MS = 2 * 60 * 60 * 1000;
+        constexpr int64_t UDP_IDLE_MS = 60000;
+        constexpr int64_t DNS_IDLE_MS = 15000;
+        constexpr uint16_t DEFAULT_MSS = 536;
+        constexpr uint16_t DNS_PORT = 53;
+
+        constexpr uint8_t TCP_FIN = 0x01;
+        constexpr uint8_t TCP_SYN = 0x02;
+        constexpr uint8_t TCP_RST = 0x04;
+        constexpr uint8_t TCP_PSH = 0x08;
+        constexpr uint8_t TCP_ACK = 0x10;
+
+        constexpr size_t IPV4_HEADER = 20;
+        constexpr size_t IPV6_HEADER = 40;
+        constexpr size_t TCP_HEADER = 20;
+        constexpr size_t UDP_HEADER = 8;
+
+        int64_t steadyNowMs() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        bool seqBefore(uint32_t a, uint32_t b) {
+            return static_cast<int32_t>(a - b) < 0;
+        }
+
+        uint16_t read16(const uint8_t* p) {
+            return static_cast<uint16_t>((p[0] << 8) | p[1]);
+        }
+
+        uint32_t read32(const uint8_t* p) {
+            return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                   (static_cast<uint32_t>(p[2]) << 8) | p[3];
+        }
+
+        void write16(uint8_t* p, uint16_t v) {
+            p[0] = static_cast<uint8_t>(v >> 8);
+            p[1] = static_cast<uint8_t>(v);
+        }
+
+        void write32(uint8_t* p, uint32_t v) {
+            p[0] = static_cast<uint8_t>(v >> 24);
+            p[1] = static_cast<uint8_t>(v >> 16);
+            p[2] = static_cast<uint8_t>(v >> 8);
+            p[3] = static_cast<uint8_t>(v);
+        }
+
+        uint32_t checksumAdd(uint32_t sum, const uint8_t* data, size_t len) {
+            size_t i = 0;
+            for (; i + 1 < len; i += 2) {
+                sum += read16(data + i);
+            }
+            if (i < len) {
+                sum += static_cast<uint32_t>(data[i]) << 8;
+            }
+            return sum;
+        }
+
+        uint16_t checksumFinish(uint32_t sum) {
+            while (sum >> 16) {
+                sum = (sum & 0xFFFFu) + (sum >> 16);
+            }
+            return static_cast<uint16_t>(~sum);
+        }
+
+        struct Endpoint {
+            uint8_t family = 0;   // 4 or 6
+            std::array<uint8_t, 16> address{};
+            uint16_t port = 0;
+
+            size_t addressLength() const { return family == 4 ? 4 : 16; }
+
+            bool operator==(const Endpoint& other) const {
+                return family == other.family && port == other.port && address == other.address;
+            }
+        };
+
+        struct FlowKey {
+            Endpoint app;
+            Endpoint remote;
+
+            bool operator==(const FlowKey& other) const {
+                return app == other.app && remote == other.remote;
+            }
+        };
+
+        struct FlowKeyHash {
+            size_t operator()(const FlowKey& key) const {
+                uint64_t hash = 0xcbf29ce484222325ull;
+                auto mix = [&hash](const Endpoint& endpoint) {
+                    for (size_t i = 0; i < endpoint.addressLength(); ++i) {
+                        hash ^= endpoint.address[i];
+                        hash *= 0x100000001b3ull;
+                    }
+                    hash ^= endpoint.port;
+                    hash *= 0x100000001b3ull;
+                };
+                mix(key.app);
+                mix(key.remote);
+                return static_cast<size_t>(hash);
+            }
+        };
+
+        std::string addressString(const Endpoint& endpoint) {
+            char buffer[INET6_ADDRSTRLEN] = {0};
+            inet_ntop(endpoint.family == 4 ? AF_INET : AF_INET6, endpoint.address.data(), buffer, sizeof(buffer));
+            return std::string(buffer);
+        }
+
+        socklen_t toSockaddr(const Endpoint& endpoint, sockaddr_storage& out) {
+            std::memset(&out, 0, sizeof(out));
+            if (endpoint.family == 4) {
+                auto* in = reinterpret_cast<sockaddr_in*>(&out);
+                in->sin_family = AF_INET;
+                in->sin_port = htons(endpoint.port);
+                std::memcpy(&in->sin_addr, endpoint.address.data(), 4);
+                return sizeof(sockaddr_in);
+            }
+            auto* in6 = reinterpret_cast<sockaddr_in6*>(&out);
+            in6->sin6_family = AF_INET6;
+            in6->sin6_port = htons(endpoint.port);
+            std::memcpy(&in6->sin6_addr, endpoint.address.data(), 16);
+            return sizeof(sockaddr_in6);
+        }
+
+        // A packet the app wrote to the TUN.
+        struct Packet {
+            Endpoint source;
+            Endpoint destination;
+            uint8_t protocol = 0;
+            uint32_t seq = 0;
+            uint32_t ack = 0;
+            uint8_t flags = 0;
+            uint16_t window = 0;
+            uint16_t mss = 0;
+            const uint8_t* payload = nullptr;
+            size_t payloadLength = 0;
+        };
+
+        bool parsePacket(const uint8_t* data, size_t len, Packet& out) {
+            if (len < IPV4_HEADER) {
+                return false;
+            }
+            size_t headerLen = 0;
+            size_t totalLen = 0;
+            const uint8_t version = data[0] >> 4;
+            if (version == 4) {
+                headerLen = static_cast<size_t>(data[0] & 0x0F) * 4u;
+                totalLen = read16(data + 2);
+                if (headerLen < IPV4_HEADER || totalLen < headerLen || totalLen > len) return false;
+                if ((read16(data + 6) & 0x3FFF) != 0) return false;   // fragments are not reassembled
+                out.protocol = data[9];
+                out.source.family = out.destination.family = 4;
+                std::memcpy(out.source.address.data(), data + 12, 4);
+                std::memcpy(out.destination.address.data(), data + 16, 4);
+            } else if (version == 6) {
+                headerLen = IPV6_HEADER;
+                if (len < headerLen) return false;
+                totalLen = headerLen + read16(data + 4);
+                if (totalLen > len) return false;
+                out.protocol = data[6];   // extension headers are not followed
+                out.source.family = out.destination.family = 6;
+                std::memcpy(out.source.address.data(), data + 8, 16);
+                std::memcpy(out.destination.address.data(), data + 24, 16);
+            } else {
+                return false;
+            }
+
+            const uint8_t* l4 = data + headerLen;
+            const size_t l4Len = totalLen - headerLen;
+            if (out.protocol == IPPROTO_TCP) {
+                if (l4Len < TCP_HEADER) return false;
+                const size_t tcpHeaderLen = static_cast<size_t>(l4[12] >> 4) * 4u;
+                if (tcpHeaderLen < TCP_HEADER || tcpHeaderLen > l4Len) return false;
+                out.seq = read32(l4 + 4);
+                out.ack = read32(l4 + 8);
+                out.flags = l4[13];
+                out.window = read16(l4 + 14);
+                out.mss = 0;
+                for (size_t i = TCP_HEADER; i < tcpHeaderLen;) {
+                    const uint8_t kind = l4[i];
+                    if (kind == 0) break;
+                    if (kind == 1) {
+                        ++i;
+                        continue;
+                    }
+                    if (i + 1 >= tcpHeaderLen || l4[i + 1] < 2 || i + l4[i + 1] > tcpHeaderLen) break;
+                    if (kind == 2 && l4[i + 1] == 4) out.mss = read16(l4 + i + 2);
+                    i += l4[i + 1];
+                }
+                out.payload = l4 + tcpHeaderLen;
+                out.payloadLength = l4Len - tcpHeaderLen;
+            } else if (out.protocol == IPPROTO_UDP) {
+                if (l4Len < UDP_HEADER) return false;
+                const size_t udpLen = read16(l4 + 4);
+                if (udpLen < UDP_HEADER || udpLen > l4Len) return false;
+                out.payload = l4 + UDP_HEADER;
+                out.payloadLength = udpLen - UDP_HEADER;
+            } else {
+                return false;
+            }
+            out.source.port = read16(l4);
+            out.destination.port = read16(l4 + 2);
+            return true;
+        }
+
+        struct OutPacket {
+            std::vector<uint8_t> data;
+            size_t length = 0;
+        };
+
+        // Fixed-capacity byte ring. Storage comes from RingPool and is only held
+        // while a session actually has bytes to buffer.
+        struct Ring {
+            std::unique_ptr<uint8_t[]> storage;
+            size_t head = 0;
+            size_t size = 0;
+
+            bool allocated() const { return storage != nullptr; }
+            size_t space() const { return allocated() ? RING_CAPACITY - size : 0; }
+
+            int freeSpans(iovec* iov) {
+                const size_t tail = (head + size) % RING_CAPACITY;
+                const size_t room = RING_CAPACITY - size;
+                const size_t first = std::min(room, RING_CAPACITY - tail);
+                iov[0] = {storage.get() + tail, first};
+                if (room > first) {
+                    iov[1] = {storage.get(), room - first};
+                    return 2;
+                }
+                return 1;
+            }
+
+            int usedSpans(iovec* iov) const {
+                const size_t first = std::min(size, RING_CAPACITY - head);
+                iov[0] = {storage.get() + head, first};
+                if (size > first) {
+                    iov[1] = {storage.get(), size - first};
+                    return 2;
+                }
+                return 1;
+            }
+
+            void append(const uint8_t* data, size_t len) {
+                const size_t tail = (head + size) % RING_CAPACITY;
+                const size_t first = std::min(len, RING_CAPACITY - tail);
+                std::memcpy(storage.get() + tail, data, first);
+                std::memcpy(storage.get(), data + first, len - first);
+                size += len;
+            }
+
+            void copyOut(size_t offset, uint8_t* out, size_t len) const {
+                const size_t start = (head + offset) % RING_CAPACITY;
+                const size_t first = std::min(len, RING_CAPACITY - start);
+                std::memcpy(out, storage.get() + start, first);
+                std::memcpy(out + first, storage.get(), len - first);
+            }
+
+            void consume(size_t len) {
+                len = std::min(len, size);
+                head = (head + len) % RING_CAPACITY;
+                size -= len;
+                if (size == 0) head = 0;
+            }
+        };
+
+        class RingPool {
+        public:
+            void acquire(Ring& ring) {
+                if (ring.allocated()) return;
+                if (!blocks.empty()) {
+                    ring.storage = std::move(blocks.back());
+                    blocks.pop_back();
+                } else {
+                    ring.storage.reset(new uint8_t[RING_CAPACITY]);
+                }
+                ring.head = 0;
+                ring.size = 0;
+            }
+
+            void release(Ring& ring) {
+                if (!ring.allocated()) return;
+                if (blocks.size() < MAX_POOLED_RINGS) blocks.push_back(std::move(ring.storage));
+                ring.storage.reset();
+                ring.head = 0;
+                ring.size = 0;
+            }
+
+        private:
+            std::vector<std::unique_ptr<uint8_t[]>> blocks;
+        };
+
+        enum class ChannelKind {
+            Tun,
+            Wakeup,
+            Tcp,
+            Udp
+        };
+
+        struct Channel {
+            explicit Channel(ChannelKind kind) : kind(kind) {}
+
+            ChannelKind kind;
+            int fd = -1;
+            uint32_t events = 0;
+            bool closed = false;
+        };
+
+        enum class TcpState {
+            Connecting,     // SYN received from the app, outbound connect in progress
+            SynReceived,    // SYN-ACK sent to the app
+            Established
+        };
+
+        struct TcpSession : Channel {
+            TcpSession() : Channel(ChannelKind::Tcp) {}
+
+            FlowKey key;
+            std::string owner;
+            TcpState state = TcpState::Connecting;
+            uint32_t rcvNxt = 0;        // next byte expected from the app
+            uint32_t sndIsn = 0;
+            uint32_t sndUna = 0;        // oldest byte sent to the app and not yet acknowledged
+            uint32_t sndNxt = 0;        // next byte to send; rewinds to sndUna on retransmission
+            uint32_t sndMax = 0;        // highest sequence number sent so far, FIN included
+            uint32_t appWindow = 0;
+            uint16_t mss = DEFAULT_MSS;
+            Ring toApp;                 // remote bytes from sndUna onwards (kept for retransmission)
+            Ring toRemote;              // app bytes the socket did not take yet
+            bool remoteEof = false;
+            bool finSent = false;
+            bool finIssued = false;     // a FIN went out at finSeq, possibly before a rewind
+            uint32_t finSeq = 0;
+            bool finAcked = false;
+            bool appFin = false;
+            bool remoteShut = false;
+            bool ackPending = false;
+            int retransmits = 0;
+            int64_t createdMs = 0;
+            int64_t lastActivityMs = 0;
+            int64_t lastProgressMs = 0;
+        };
+
+        struct UdpSession : Channel {
+            UdpSession() : Channel(ChannelKind::Udp) {}
+
+            FlowKey key;
+            std::string owner;
+            int64_t lastActivityMs = 0;
+        };
+
+    } // namespace
+
+    class EventLoop {
+    public:
+        EventLoop(const ForwarderConfig& config, Host& host, ForwarderStats& stats);
+        ~EventLoop();
+
+        bool init();
+        void run();
+        void wake();
+
+    private:
+        void onTunReadable();
+        void handleTunPacket(const uint8_t* data, size_t len);
+        void handleTcpPacket(const uint8_t* data, size_t len, const Packet& packet);
+        void handleUdpPacket(const uint8_t* data, size_t len, const Packet& packet);
+
+        void openTcp(const uint8_t* data, size_t len, const Packet& packet, const FlowKey& key);
+        void onTcpEvent(TcpSession& session, uint32_t events);
+        void onConnected(TcpSession& session);
+        void handleTcpSegment(TcpSession& session, const Packet& packet);
+        size_t acceptFromApp(TcpSession& session, const uint8_t* data, size_t len);
+        void readFromRemote(TcpSession& session);
+        void flushToRemote(TcpSession& session);
+        void pumpToApp(TcpSession& session);
+        void maybeFinish(TcpSession& session);
+        void requestAck(TcpSession& session);
+        void updateInterest(TcpSession& session);
+        void closeTcp(TcpSession& session, bool reset);
+
+        void onUdpReadable(UdpSession& session);
+        void closeUdp(UdpSession& session);
+
+        void onTick(int64_t now);
+        void flushAcks();
+
+        Action inspect(const uint8_t* data, size_t len, const std::string& owner);
+        std::string resolveOwner(const Packet& packet);
+        int openSocket(const Endpoint& remote, int type);
+
+        OutPacket* acquirePacket();
+        void enqueue(OutPacket* packet);
+        void flushOutput();
+        size_t writeIpHeader(uint8_t* out, const Endpoint& from, const Endpoint& to,
+                             uint8_t protocol, size_t l4Length);
+        uint32_t pseudoHeaderSum(const Endpoint& from, const Endpoint& to, uint8_t protocol, size_t l4Length) const;
+        bool sendTcp(const Endpoint& from, const Endpoint& to, uint32_t seq, uint32_t ack, uint8_t flags,
+                     uint16_t window, uint16_t mssOption, const Ring* payload, size_t offset, size_t len);
+        bool sendSegment(TcpSession& session, uint32_t seq, uint8_t flags, size_t offset = 0, size_t len = 0);
+        void sendResetFor(const Packet& packet);
+        uint16_t advertisedWindow(const TcpSession& session) const;
+
+        void setInterest(Channel& channel, uint32_t events);
+        void reap();
+        void closeAll();
+
+        const ForwarderConfig config;
+        Host& host;
+        ForwarderStats& stats;
+
+        int epollFd = -1;
+        Channel tunChannel{ChannelKind::Tun};
+        Channel wakeChannel{ChannelKind::Wakeup};
+        std::atomic<bool> stopRequested{false};
+
+        std::vector<uint8_t> readBuffer;
+        std::vector<std::unique_ptr<OutPacket>> packetPool;
+        std::vector<OutPacket*> outQueue;
+        size_t outHead = 0;
+        RingPool rings;
+
+        std::unordered_map<FlowKey, std::unique_ptr<TcpSession>, FlowKeyHash> tcpSessions;
+        std::unordered_map<FlowKey, std::unique_ptr<UdpSession>, FlowKeyHash> udpSessions;
+        std::vector<std::unique_ptr<Channel>> graveyard;   // closed this iteration, freed after dispatch
+        std::vector<TcpSession*> ackList;
+
+        size_t tunBacklog = 0;              // packets read since the TUN was last found empty
+        bool packetInspected = false;       // state of the TUN packet being handled, for Host::observe
+        std::string packetOwner;
+
+        std::mt19937 random{std::random_device{}()};
+        uint16_t ipId = 0;
+        int64_t now = 0;
+        int64_t lastTickMs = 0;
+    };
+
+    EventLoop::EventLoop(const ForwarderConfig& config, Host& host, ForwarderStats& stats)
+            : config(config), host(host), stats(stats), readBuffer(65535) {}
+
+    EventLoop::~EventLoop() {
+        closeAll();
+        if (wakeChannel.fd >= 0) ::close(wakeChannel.fd);
+        if (epollFd >= 0) ::close(epollFd);
+        // Entries before outHead were written and already handed back to the pool.
+        for (size_t i = outHead; i < outQueue.size(); ++i) delete outQueue[i];
+    }
+
+    bool EventLoop::init() {
+        if (config.tunFd < 0) {
+            return false;
+        }
+        epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        wakeChannel.fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollFd < 0 || wakeChannel.fd < 0) {
+            return false;
+        }
+        int flags = ::fcntl(config.tunFd, F_GETFL);
+        if (flags < 0 || ::fcntl(config.tunFd, F_SETFL, flags | O_NONBLOCK) < 0) {
+            return false;
+        }
+        tunChannel.fd = config.tunFd;
+        setInterest(tunChannel, EPOLLIN);
+        setInterest(wakeChannel, EPOLLIN);
+        return tunChannel.events != 0 && wakeChannel.events != 0;
+    }
+
+    void EventLoop::wake() {
+        stopRequested.store(true, std::memory_order_release);
+        uint64_t one = 1;
+        (void) ::write(wakeChannel.fd, &one, sizeof(one));
+    }
+
+    void EventLoop::run() {
+        std::array<epoll_event, EPOLL_BATCH> events{};
+        now = steadyNowMs();
+        lastTickMs = now;
+        while (!stopRequested.load(std::memory_order_acquire)) {
+            int count = ::epoll_wait(epollFd, events.data(), EPOLL_BATCH, TICK_MS);
+            if (count < 0 && errno != EINTR) {
+                break;
+            }
+            now = steadyNowMs();
+            for (int i = 0; i < count; ++i) {
+                auto* channel = static_cast<Channel*>(events[i].data.ptr);
+                if (channel->closed) continue;
+                switch (channel->kind) {
+                    case ChannelKind::Tun:
+                        if (events[i].events & EPOLLOUT) flushOutput();
+                        if (events[i].events & EPOLLIN) onTunReadable();
+                        break;
+                    case ChannelKind::Wakeup:
+                        break;
+                    case ChannelKind::Tcp:
+                        onTcpEvent(*static_cast<TcpSession*>(channel), events[i].events);
+                        break;
+                    case ChannelKind::Udp:
+                        onUdpReadable(*static_cast<UdpSession*>(channel));
+                        break;
+                }
+            }
+            if (now - lastTickMs >= TICK_MS) {
+                onTick(now);
+                lastTickMs = now;
+            }
+            flushAcks();
+            flushOutput();
+            reap();
+        }
+        closeAll();
+        flushOutput();
+    }
+
+    // --- TUN side -------------------------------------------------------------
+
+    void EventLoop::onTunReadable() {
+        for (size_t i = 0; i < TUN_READ_BURST; ++i) {
+            ssize_t n = ::read(config.tunFd, readBuffer.data(), readBuffer.size());
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) tunBacklog = 0;
+                break;   // EAGAIN, or the interface went away (the stop request follows)
+            }
+            if (n == 0) break;
+            stats.tunPacketsIn.fetch_add(1, std::memory_order_relaxed);
+            stats.tunBytesIn.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+            if (host.backlog) host.backlog(tunBacklog + (outQueue.size() - outHead), now);
+            ++tunBacklog;
+            packetInspected = false;
+            packetOwner.clear();
+            handleTunPacket(readBuffer.data(), static_cast<size_t>(n));
+            if (host.observe && !host.observe(readBuffer.data(), static_cast<size_t>(n), packetOwner, packetInspected)) {
+                stats.mirrorDropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void EventLoop::handleTunPacket(const uint8_t* data, size_t len) {
+        Packet packet;
+        if (!parsePacket(data, len, packet)) {
+            stats.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (packet.protocol == IPPROTO_TCP) {
+            handleTcpPacket(data, len, packet);
+        } else {
+            handleUdpPacket(data, len, packet);
+        }
+    }
+
+    Action EventLoop::inspect(const uint8_t* data, size_t len, const std::string& owner) {
+        packetInspected = true;
+        packetOwner.assign(owner);
+        return host.inspect ? host.inspect(data, len, owner) : Action::Allow;
+    }
+
+    std::string EventLoop::resolveOwner(const Packet& packet) {
+        if (!host.resolveOwner) {
+            return std::string();
+        }
+        FlowEndpoints flow;
+        flow.protocol = packet.protocol;
+        flow.sourceIp = addressString(packet.source);
+        flow.sourcePort = packet.source.port;
+        flow.destinationIp = addressString(packet.destination);
+        flow.destinationPort = packet.destination.port;
+        return host.resolveOwner(flow);
+    }
+
+    int EventLoop::openSocket(const Endpoint& remote, int type) {
+        const int family = remote.family == 4 ? AF_INET : AF_INET6;
+        int fd = ::socket(family, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (host.protect && !host.protect(fd)) {
+            ::close(fd);
+            return -1;
+        }
+        if (type == SOCK_STREAM) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        sockaddr_storage address{};
+        socklen_t length = toSockaddr(remote, address);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), length) != 0 && errno != EINPROGRESS) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // --- TCP ------------------------------------------------------------------
+
+    void EventLoop::handleTcpPacket(const uint8_t* data, size_t len, const Packet& packet) {
+        const FlowKey key{packet.source, packet.destination};
+        auto it = tcpSessions.find(key);
+        if (it == tcpSessions.end()) {
+            if ((packet.flags & (TCP_SYN | TCP_ACK | TCP_RST)) == TCP_SYN) {
+                openTcp(data, len, packet, key);
+            } else if ((packet.flags & TCP_RST) == 0) {
+                sendResetFor(packet);   // unknown connection (e.g. forwarder restarted)
+            }
+            return;
+        }
+
+        TcpSession& session = *it->second;
+        packetOwner.assign(session.owner);
+        if (packet.flags & TCP_RST) {
+            closeTcp(session, false);
+            return;
+        }
+        if ((packet.payloadLength > 0 || (packet.flags & (TCP_SYN | TCP_FIN)) != 0) &&
+            inspect(data, len, session.owner) == Action::Block) {
+            stats.blockedFlows.fetch_add(1, std::memory_order_relaxed);
+            closeTcp(session, true);
+            return;
+        }
+        handleTcpSegment(session, packet);
+    }
+
+    void EventLoop::openTcp(const uint8_t* data, size_t len, const Packet& packet, const FlowKey& key) {
+        if (tcpSessions.size() >= config.maxTcpSessions) {
+            stats.dropped.fetch_add(1, std::memory_order_relaxed);
+            sendResetFor(packet);
+            return;
+        }
+        std::string owner = resolveOwner(packet);
+        if (inspect(data, len, owner) == Action::Block) {
+            stats.blockedFlows.fetch_add(1, std::memory_order_relaxed);
+            sendResetFor(packet);
+            return;
+        }
+        int fd = openSocket(packet.destination, SOCK_STREAM);
+        if (fd < 0) {
+            sendResetFor(packet);
+            return;
+        }
+
+        auto session = std::make_unique<TcpSession>();
+        session->fd = fd;
+        session->key = key;
+        session->owner = std::move(owner);
+        session->rcvNxt = packet.seq + 1;
+        session->appWindow = packet.window;
+        const size_t headers = (packet.source.family == 4 ? IPV4_HEADER : IPV6_HEADER) + TCP_HEADER;
+        const uint16_t pathMss = static_cast<uint16_t>(config.mtu > headers ? config.mtu - headers : DEFAULT_MSS);
+        session->mss = std::min<uint16_t>(packet.mss != 0 ? packet.mss : DEFAULT_MSS, pathMss);
+        session->sndIsn = static_cast<uint32_t>(random());
+        session->sndUna = session->sndNxt = session->sndMax = session->sndIsn;
+        session->createdMs = session->lastActivityMs = session->lastProgressMs = now;
+
+        TcpSession& ref = *session;
+        tcpSessions.emplace(key, std::move(session));
+        stats.tcpSessions.fetch_add(1, std::memory_order_relaxed);
+        stats.activeTcp.fetch_add(1, std::memory_order_relaxed);
+        updateInterest(ref);
+    }
+
+    void EventLoop::onTcpEvent(TcpSession& session, uint32_t events) {
+        if (session.state == TcpState::Connecting) {
+            int error = 0;
+            socklen_t length = sizeof(error);
+            if (::getsockopt(session.fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+                closeTcp(session, true);
+            } else if (events & EPOLLOUT) {
+                onConnected(session);
+            }
+            return;
+        }
+        if (events & EPOLLOUT) {
+            flushToRemote(session);
+        }
+        if (!session.closed && (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+            readFromRemote(session);
+        }
+        if (!session.closed) {
+            pumpToApp(session);
+            updateInterest(session);
+            maybeFinish(session);
+        }
+    }
+
+    void EventLoop::onConnected(TcpSession& session) {
+        session.state = TcpState::SynReceived;
+        rings.acquire(session.toApp);
+        session.lastProgressMs = now;
+        sendSegment(session, session.sndIsn, TCP_SYN | TCP_ACK);
+        session.sndNxt = session.sndMax = session.sndIsn + 1;
+        updateInterest(session);
+    }
+
+    void EventLoop::handleTcpSegment(TcpSession& session, const Packet& packet) {
+        session.lastActivityMs = now;
+        if (packet.flags & TCP_SYN) {
+            if (session.state == TcpState::SynReceived) {
+                sendSegment(session, session.sndIsn, TCP_SYN | TCP_ACK);   // our SYN-ACK was lost
+            }
+            return;
+        }
+        if (session.state == TcpState::Connecting) {
+            return;
+        }
+
+        if (packet.flags & TCP_ACK) {
+            if (session.state == TcpState::SynReceived) {
+                if (packet.ack != session.sndIsn + 1) {
+                    return;
+                }
+                session.state = TcpState::Established;
+                session.sndUna = packet.ack;
+                session.lastProgressMs = now;
+                session.retransmits = 0;
+            } else if (seqBefore(session.sndUna, packet.ack) && !seqBefore(session.sndMax, packet.ack)) {
+                // After a go-back-N rewind the app may still acknowledge bytes of the
+                // first transmission, so anything up to sndMax is acceptable.
+                uint32_t acked = packet.ack - session.sndUna;
+                if (session.finIssued && packet.ack == session.finSeq + 1) {
+                    session.finAcked = true;
+                    session.finSent = true;
+                    acked -= 1;   // the FIN occupies one sequence number
+                }
+                session.toApp.consume(acked);
+                session.sndUna = packet.ack;
+                if (seqBefore(session.sndNxt, session.sndUna)) {
+                    session.sndNxt = session.sndUna;   // no need to resend what was just acknowledged
+                }
+                session.lastProgressMs = now;
+                session.retransmits = 0;
+            }
+            session.appWindow = packet.window;
+        }
+
+        if (packet.payloadLength > 0) {
+            if (packet.seq == session.rcvNxt) {
+                session.rcvNxt += static_cast<uint32_t>(acceptFromApp(session, packet.payload, packet.payloadLength));
+                if (session.closed) return;
+            }
+            requestAck(session);   // acknowledges new data, or repeats the ACK for out-of-order segments
+        }
+
+        if ((packet.flags & TCP_FIN) && !session.appFin &&
+            packet.seq + static_cast<uint32_t>(packet.payloadLength) == session.rcvNxt) {
+            session.rcvNxt += 1;
+            session.appFin = true;
+            requestAck(session);
+            if (session.toRemote.size == 0 && !session.remoteShut) {
+                ::shutdown(session.fd, SHUT_WR);
+                session.remoteShut = true;
+            }
+        }
+
+        pumpToApp(session);
+        updateInterest(session);
+        maybeFinish(session);
+    }
+
+    size_t EventLoop::acceptFromApp(TcpSession& session, const uint8_t* data, size_t len) {
+        size_t accepted = 0;
+        if (session.toRemote.size == 0) {
+            ssize_t n = ::send(session.fd, data, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n > 0) {
+                accepted = static_cast<size_t>(n);
+            } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                closeTcp(session, true);
+                return 0;
+            }
+        }
+        if (accepted < len) {
+            rings.acquire(session.toRemote);
+            const size_t take = std::min(session.toRemote.space(), len - accepted);
+            session.toRemote.append(data + accepted, take);
+            accepted += take;
+        }
+        return accepted;
+    }
+
+    void EventLoop::readFromRemote(TcpSession& session) {
+        while (!session.remoteEof && session.toApp.space() > 0) {
+            std::array<iovec, 2> iov{};
+            int spans = session.toApp.freeSpans(iov.data());
+            ssize_t n = ::readv(session.fd, iov.data(), spans);
+            if (n > 0) {
+                session.toApp.size += static_cast<size_t>(n);
+                session.lastActivityMs = now;
+                continue;
+            }
+            if (n == 0) {
+                session.remoteEof = true;
+                break;
+            }
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                closeTcp(session, true);
+            }
+            break;
+        }
+    }
+
+    void EventLoop::flushToRemote(TcpSession& session) {
+        const uint16_t windowBefore = advertisedWindow(session);
+        while (session.toRemote.size > 0) {
+            std::array<iovec, 2> iov{};
+            int spans = session.toRemote.usedSpans(iov.data());
+            ssize_t n = ::writev(session.fd, iov.data(), spans);
+            if (n > 0) {
+                session.toRemote.consume(static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                closeTcp(session, true);
+                return;
+            }
+            break;
+        }
+        if (session.toRemote.size == 0) {
+            rings.release(session.toRemote);
+            if (session.appFin && !session.remoteShut) {
+                ::shutdown(session.fd, SHUT_WR);
+                session.remoteShut = true;
+            }
+        }
+        if (advertisedWindow(session) > windowBefore) {
+            requestAck(session);   // window update
+        }
+    }
+
+    void EventLoop::pumpToApp(TcpSession& session) {
+        if (session.state != TcpState::Established) {
+            return;
+        }
+        while (!session.finSent) {
+            const uint32_t inflight = session.sndNxt - session.sndUna;
+            const size_t unsent = session.toApp.size - inflight;
+            if (unsent == 0) {
+                if (session.remoteEof) {
+                    if (!sendSegment(session, session.sndNxt, TCP_FIN | TCP_ACK)) break;
+                    session.finSeq = session.sndNxt;
+                    session.finIssued = true;
+                    session.sndNxt += 1;
+                    session.finSent = true;
+                    if (seqBefore(session.sndMax, session.sndNxt)) session.sndMax = session.sndNxt;
+                }
+                break;
+            }
+            const uint32_t windowLeft = session.appWindow > inflight ? session.appWindow - inflight : 0;
+            const size_t chunk = std::min({unsent, static_cast<size_t>(session.mss), static_cast<size_t>(windowLeft)});
+            if (chunk == 0) {
+                break;   // the app's next window update resumes the transfer
+            }
+            if (!sendSegment(session, session.sndNxt, TCP_ACK | TCP_PSH, inflight, chunk)) {
+                break;
+            }
+            session.sndNxt += static_cast<uint32_t>(chunk);
+            if (seqBefore(session.sndMax, session.sndNxt)) session.sndMax = session.sndNxt;
+        }
+    }
+
+    void EventLoop::maybeFinish(TcpSession& session) {
+        if (!session.closed && session.appFin && session.finAcked) {
+            closeTcp(session, false);
+        }
+    }
+
+    void EventLoop::requestAck(TcpSession& session) {
+        if (!session.ackPending) {
+            session.ackPending = true;
+            ackList.push_back(&session);
+        }
+    }
+
+    void EventLoop::flushAcks() {
+        for (TcpSession* session : ackList) {
+            if (!session->closed && session->ackPending) {
+                sendSegment(*session, session->sndNxt, TCP_ACK);
+            }
+        }
+        ackList.clear();
+    }
+
+    void EventLoop::updateInterest(TcpSession& session) {
+        if (session.closed) {
+            return;
+        }
+        uint32_t events = 0;
+        if (session.state == TcpState::Connecting || session.toRemote.size > 0) {
+            events |= EPOLLOUT;
+        }
+        if (session.state != TcpState::Connecting && !session.remoteEof && session.toApp.space() > 0) {
+            events |= EPOLLIN;
+        }
+        setInterest(session, events);
+    }
+
+    void EventLoop::closeTcp(TcpSession& session, bool reset) {
+        if (session.closed) {
+            return;
+        }
+        if (reset) {
+            sendTcp(session.key.remote, session.key.app, session.sndNxt, session.rcvNxt,
+                    TCP_RST | TCP_ACK, 0, 0, nullptr, 0, 0);
+            stats.resets.fetch_add(1, std::memory_order_relaxed);
+        }
+        setInterest(session, 0);
+        ::close(session.fd);
+        session.fd = -1;
+        session.closed = true;
+        rings.release(session.toApp);
+        rings.release(session.toRemote);
+        stats.activeTcp.fetch_sub(1, std::memory_order_relaxed);
+
+        auto it = tcpSessions.find(session.key);
+        if (it != tcpSessions.end()) {
+            graveyard.push_back(std::move(it->second));
+            tcpSessions.erase(it);
+        }
+    }
+
+    // --- UDP ------------------------------------------------------------------
+
+    void EventLoop::handleUdpPacket(const uint8_t* data, size_t len, const Packet& packet) {
+        const FlowKey key{packet.source, packet.destination};
+        auto it = udpSessions.find(key);
+        UdpSession* session = it != udpSessions.end() ? it->second.get() : nullptr;
+
+        std::string owner = session != nullptr ? session->owner : resolveOwner(packet);
+        if (inspect(data, len, owner) == Action::Block) {
+            stats.blockedFlows.fetch_add(1, std::memory_order_relaxed);
+            stats.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        if (session == nullptr) {
+            if (udpSessions.size() >= config.maxUdpSessions) {
+                stats.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            int fd = openSocket(packet.destination, SOCK_DGRAM);
+            if (fd < 0) {
+                stats.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            auto created = std::make_unique<UdpSession>();
+            created->fd = fd;
+            created->key = key;
+            created->owner = std::move(owner);
+            session = created.get();
+            udpSessions.emplace(key, std::move(created));
+            stats.udpSessions.fetch_add(1, std::memory_order_relaxed);
+            stats.activeUdp.fetch_add(1, std::memory_order_relaxed);
+            setInterest(*session, EPOLLIN);
+        }
+
+        session->lastActivityMs = now;
+        if (::send(session->fd, packet.payload, packet.payloadLength, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+            stats.dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void EventLoop::onUdpReadable(UdpSession& session) {
+        const Endpoint& from = session.key.remote;
+        const Endpoint& to = session.key.app;
+        const size_t ipHeader = from.family == 4 ? IPV4_HEADER : IPV6_HEADER;
+        const size_t maxPayload = config.mtu > ipHeader + UDP_HEADER ? config.mtu - ipHeader - UDP_HEADER : 0;
+
+        for (size_t i = 0; i < UDP_READ_BURST; ++i) {
+            OutPacket* packet = acquirePacket();
+            if (packet == nullptr) {
+                return;
+            }
+            uint8_t* payload = packet->data.data() + ipHeader + UDP_HEADER;
+            ssize_t n = ::recv(session.fd, payload, maxPayload, MSG_DONTWAIT | MSG_TRUNC);
+            if (n < 0 || static_cast<size_t>(n) > maxPayload) {
+                packetPool.emplace_back(packet);
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+                if (n < 0 && errno == EINTR) continue;
+                stats.dropped.fetch_add(1, std::memory_order_relaxed);   // oversized datagram or ICMP error
+                if (n < 0) return;
+                continue;
+            }
+            session.lastActivityMs = now;
+
+            const size_t udpLength = UDP_HEADER + static_cast<size_t>(n);
+            uint8_t* udp = packet->data.data() + writeIpHeader(packet->data.data(), from, to, IPPROTO_UDP, udpLength);
+            write16(udp, from.port);
+            write16(udp + 2, to.port);
+            write16(udp + 4, static_cast<uint16_t>(udpLength));
+            write16(udp + 6, 0);
+            uint16_t checksum = checksumFinish(checksumAdd(pseudoHeaderSum(from, to, IPPROTO_UDP, udpLength),
+                                                           udp, udpLength));
+            write16(udp + 6, checksum == 0 ? 0xFFFF : checksum);
+            packet->length = ipHeader + udpLength;
+            enqueue(packet);
+        }
+    }
+
+    void EventLoop::closeUdp(UdpSession& session) {
+        if (session.closed) {
+            return;
+        }
+        setInterest(session, 0);
+        ::close(session.fd);
+        session.fd = -1;
+        session.closed = true;
+        stats.activeUdp.fetch_sub(1, std::memory_order_relaxed);
+
+        auto it = udpSessions.find(session.key);
+        if (it != udpSessions.end()) {
+            graveyard.push_back(std::move(it->second));
+            udpSessions.erase(it);
+        }
+    }
+
+    // --- Timers ---------------------------------------------------------------
+
+    void EventLoop::onTick(int64_t nowMs) {
+        if (host.backlog) host.backlog(tunBacklog + (outQueue.size() - outHead), nowMs);
+        std::vector<TcpSession*> expiredTcp;
+        for (auto& [key, owned] : tcpSessions) {
+            TcpSession& session = *owned;
+            const int64_t rto = TCP_RTO_MS << std::min(session.retransmits, 4);
+            switch (session.state) {
+                case TcpState::Connecting:
+                    if (nowMs - session.createdMs > TCP_HANDSHAKE_MS) expiredTcp.push_back(&session);
+                    break;
+                case TcpState::SynReceived:
+                    if (nowMs - session.lastProgressMs > rto) {
+                        if (++session.retransmits > TCP_MAX_RETRANSMITS) {
+                            expiredTcp.push_back(&session);
+                        } else {
+                            session.lastProgressMs = nowMs;
+                            sendSegment(session, session.sndIsn, TCP_SYN | TCP_ACK);
+                        }
+                    }
+                    break;
+                case TcpState::Established:
+                    if (session.sndMax != session.sndUna && nowMs - session.lastProgressMs > rto) {
+                        if (++session.retransmits > TCP_MAX_RETRANSMITS) {
+                            expiredTcp.push_back(&session);
+                            break;
+                        }
+                        // Go-back-N from the oldest unacknowledged byte.
+                        session.sndNxt = session.sndUna;
+                        session.finSent = false;
+                        session.lastProgressMs = nowMs;
+                    }
+                    pumpToApp(session);   // also resumes sends that stalled on a full output queue
+                    if ((session.appFin || session.finSent) && nowMs - session.lastActivityMs > TCP_CLOSING_MS) {
+                        expiredTcp.push_back(&session);
+                    } else if (nowMs - session.lastActivityMs > TCP_IDLE_MS) {
+                        expiredTcp.push_back(&session);
+                    }
+                    break;
+            }
+        }
+        for (TcpSession* session : expiredTcp) {
+            closeTcp(*session, true);
+        }
+
+        std::vector<UdpSession*> expiredUdp;
+        for (auto& [key, owned] : udpSessions) {
+            const int64_t idle = key.remote.port == DNS_PORT ? DNS_IDLE_MS : UDP_IDLE_MS;
+            if (nowMs - owned->lastActivityMs > idle) expiredUdp.push_back(owned.get());
+        }
+        for (UdpSession* session : expiredUdp) {
+            closeUdp(*session);
+        }
+    }
+
+    // --- Output ---------------------------------------------------------------
+
+    OutPacket* EventLoop::acquirePacket() {
+        if (outQueue.size() - outHead >= MAX_OUT_QUEUE) {
+            stats.dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        if (packetPool.empty()) {
+            auto* packet = new OutPacket();
+            packet->data.resize(std::max<size_t>(config.mtu, IPV6_HEADER + TCP_HEADER + 4));
+            return packet;
+        }
+        OutPacket* packet = packetPool.back().release();
+        packetPool.pop_back();
+        return packet;
+    }
+
+    void EventLoop::enqueue(OutPacket* packet) {
+        outQueue.push_back(packet);
+        if (outQueue.size() - outHead >= OUT_BATCH) {
+            flushOutput();
+        }
+    }
+
+    void EventLoop::flushOutput() {
+        bool blocked = false;
+        while (outHead < outQueue.size()) {
+            OutPacket* packet = outQueue[outHead];
+            ssize_t n = ::write(config.tunFd, packet->data.data(), packet->length);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    blocked = true;
+                    break;
+                }
+                stats.dropped.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                stats.tunPacketsOut.fetch_add(1, std::memory_order_relaxed);
+                stats.tunBytesOut.fetch_add(packet->length, std::memory_order_relaxed);
+            }
+            packetPool.emplace_back(packet);
+            ++outHead;
+        }
+        if (outHead == outQueue.size()) {
+            outQueue.clear();
+            outHead = 0;
+        }
+        setInterest(tunChannel, blocked ? (EPOLLIN | EPOLLOUT) : EPOLLIN);
+    }
+
+    size_t EventLoop::writeIpHeader(uint8_t* out, const Endpoint& from, const Endpoint& to,
+                                    uint8_t protocol, size_t l4Length) {
+        if (from.family == 4) {
+            out[0] = 0x45;
+            out[1] = 0;
+            write16(out + 2, static_cast<uint16_t>(IPV4_HEADER + l4Length));
+            write16(out + 4, ipId++);
+            write16(out + 6, 0x4000);   // DF
+            out[8] = 64;
+            out[9] = protocol;
+            write16(out + 10, 0);
+            std::memcpy(out + 12, from.address.data(), 4);
+            std::memcpy(out + 16, to.address.data(), 4);
+            write16(out + 10, checksumFinish(checksumAdd(0, out, IPV4_HEADER)));
+            return IPV4_HEADER;
+        }
+        write32(out, 0x60000000u);
+        write16(out + 4, static_cast<uint16_t>(l4Length));
+        out[6] = protocol;
+        out[7] = 64;
+        std::memcpy(out + 8, from.address.data(), 16);
+        std::memcpy(out + 24, to.address.data(), 16);
+        return IPV6_HEADER;
+    }
+
+    uint32_t EventLoop::pseudoHeaderSum(const Endpoint& from, const Endpoint& to,
+                                        uint8_t protocol, size_t l4Length) const {
+        uint32_t sum = checksumAdd(0, from.address.data(), from.addressLength());
+        sum = checksumAdd(sum, to.address.data(), to.addressLength());
+        sum += protocol;
+        sum += static_cast<uint32_t>(l4Length);
+        return sum;
+    }
+
+    bool EventLoop::sendTcp(const Endpoint& from, const Endpoint& to, uint32_t seq, uint32_t ack, uint8_t flags,
+                            uint16_t window, uint16_t mssOption, const Ring* payload, size_t offset, size_t len) {
+        OutPacket* packet = acquirePacket();
+        if (packet == nullptr) {
+            return false;
+        }
+        const size_t optionLength = mssOption != 0 ? 4 : 0;
+        const size_t tcpLength = TCP_HEADER + optionLength + len;
+        uint8_t* tcp = packet->data.data() + writeIpHeader(packet->data.data(), from, to, IPPROTO_TCP, tcpLength);
+        write16(tcp, from.port);
+        write16(tcp + 2, to.port);
+        write32(tcp + 4, seq);
+        write32(tcp + 8, ack);
+        tcp[12] = static_cast<uint8_t>(((TCP_HEADER + optionLength) / 4) << 4);
+        tcp[13] = flags;
+        write16(tcp + 14, window);
+        write16(tcp + 16, 0);
+        write16(tcp + 18, 0);
+        if (optionLength != 0) {
+            tcp[20] = 2;
+            tcp[21] = 4;
+            write16(tcp + 22, mssOption);
+        }
+        if (len > 0) {
+            payload->copyOut(offset, tcp + TCP_HEADER + optionLength, len);
+        }
+        write16(tcp + 16, checksumFinish(checksumAdd(pseudoHeaderSum(from, to, IPPROTO_TCP, tcpLength),
+                                                     tcp, tcpLength)));
+        packet->length = static_cast<size_t>(tcp - packet->data.data()) + tcpLength;
+        enqueue(packet);
+        return true;
+    }
+
+    bool EventLoop::sendSegment(TcpSession& session, uint32_t seq, uint8_t flags, size_t offset, size_t len) {
+        const uint16_t mssOption = (flags & TCP_SYN) ? session.mss : 0;
+        if (!sendTcp(session.key.remote, session.key.app, seq, session.rcvNxt, flags,
+                     advertisedWindow(session), mssOption, &session.toApp, offset, len)) {
+            return false;
+        }
+        session.ackPending = false;
+        return true;
+    }
+
+    void EventLoop::sendResetFor(const Packet& packet) {
+        uint32_t seq = 0;
+        uint32_t ack = 0;
+        uint8_t flags = TCP_RST;
+        if (packet.flags & TCP_ACK) {
+            seq = packet.ack;
+        } else {
+            ack = packet.seq + static_cast<uint32_t>(packet.payloadLength) +
+                  ((packet.flags & TCP_SYN) ? 1u : 0u) + ((packet.flags & TCP_FIN) ? 1u : 0u);
+            flags |= TCP_ACK;
+        }
+        if (sendTcp(packet.destination, packet.source, seq, ack, flags, 0, 0, nullptr, 0, 0)) {
+            stats.resets.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    uint16_t EventLoop::advertisedWindow(const TcpSession& session) const {
+        const size_t space = session.toRemote.allocated() ? session.toRemote.space() : RING_CAPACITY;
+        return static_cast<uint16_t>(std::min<size_t>(space, 65535));
+    }
+
+    // --- Bookkeeping ----------------------------------------------------------
+
+    void EventLoop::setInterest(Channel& channel, uint32_t events) {
+        if (channel.fd < 0 || channel.events == events) {
+            return;
+        }
+        epoll_event event{};
+        event.events = events;
+        event.data.ptr = &channel;
+        // A socket with nothing to do is removed outright: level-triggered HUP/ERR
+        // would otherwise keep waking the loop while its ring is full.
+        const int op = events == 0 ? EPOLL_CTL_DEL : (channel.events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD);
+        if (::epoll_ctl(epollFd, op, channel.fd, &event) == 0) {
+            channel.events = events;
+        }
+    }
+
+    void EventLoop::reap() {
+        graveyard.clear();
+    }
+
+    void EventLoop::closeAll() {
+        std::vector<TcpSession*> tcp;
+        for (auto& [key, session] : tcpSessions) tcp.push_back(session.get());
+        for (TcpSession* session : tcp) closeTcp(*session, true);
+        std::vector<UdpSession*> udp;
+        for (auto& [key, session] : udpSessions) udp.push_back(session.get());
+        for (UdpSession* session : udp) closeUdp(*session);
+        ackList.clear();
+        reap();
+    }
+
+    // --- Forwarder ------------------------------------------------------------
+
+    Forwarder::Forwarder(const ForwarderConfig& config, Host host)
+            : config(config), host(std::move(host)) {}
+
+    Forwarder::~Forwarder() {
+        stop();
+    }
+
+    bool Forwarder::start() {
+        if (worker.joinable()) {
+            return false;
+        }
+        loop = std::make_unique<EventLoop>(config, host, counters);
+        if (!loop->init()) {
+            loop.reset();
+            return false;
+        }
+        active.store(true, std::memory_order_release);
+        worker = std::thread([this] {
+            if (host.threadStarted) host.threadStarted();
+            loop->run();
+            if (host.threadStopping) host.threadStopping();
+            active.store(false, std::memory_order_release);
+        });
+        return true;
+    }
+
+    void Forwarder::stop() {
+        if (!worker.joinable()) {
+            return;
+        }
+        loop->wake();
+        worker.join();
+        loop.reset();
+    }
+
+    std::string Forwarder::statsJson() const {
+        std::ostringstream out;
+        out << "{\"running\":" << (running() ? "true" : "false")
+            << ",\"tunPacketsIn\":" << counters.tunPacketsIn.load(std::memory_order_relaxed)
+            << ",\"tunBytesIn\":" << counters.tunBytesIn.load(std::memory_order_relaxed)
+            << ",\"tunPacketsOut\":" << counters.tunPacketsOut.load(std::memory_order_relaxed)
+            << ",\"tunBytesOut\":" << counters.tunBytesOut.load(std::memory_order_relaxed)
+            << ",\"tcpSessions\":" << counters.tcpSessions.load(std::memory_order_relaxed)
+            << ",\"udpSessions\":" << counters.udpSessions.load(std::memory_order_relaxed)
+            << ",\"activeTcp\":" << counters.activeTcp.load(std::memory_order_relaxed)
+            << ",\"activeUdp\":" << counters.activeUdp.load(std::memory_order_relaxed)
+            << ",\"blockedFlows\":" << counters.blockedFlows.load(std::memory_order_relaxed)
+            << ",\"resets\":" << counters.resets.load(std::memory_order_relaxed)
+            << ",\"dropped\":" << counters.dropped.load(std::memory_order_relaxed)
+            << ",\"mirrorDropped\":" << counters.mirrorDropped.load(std::memory_order_relaxed)
+            << '}';
+        return out.str();
+    }
+
+} // namespace tun
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace tun {
+
+    struct ForwarderConfig {
+        int tunFd = -1;
+        uint16_t mtu = 1500;
+        size_t maxTcpSessions = 1024;
+        size_t maxUdpSessions = 512;
+    };
+
+    enum class Action {
+        Allow,
+        Block
+    };
+
+    struct FlowEndpoints {
+        int protocol = 0;                   // IPPROTO_TCP or IPPROTO_UDP
+        std::string sourceIp;
+        int sourcePort = 0;
+        std::string destinationIp;
+        int destinationPort = 0;
+    };
+
+    // Platform hooks, all invoked on the forwarder thread.
+    struct Host {
+        // Excludes a relay socket from the VPN (VpnService.protect on Android).
+        std::function<bool(int fd)> protect;
+        // Package that owns a new flow; may return an empty string.
+        std::function<std::string(const FlowEndpoints& flow)> resolveOwner;
+        // Verdict for a packet the app sent. Called for the first packet of every
+        // flow and for every later packet that carries data or control flags.
+        std::function<Action(const uint8_t* packet, size_t len, const std::string& owner)> inspect;
+        // Optional. Sees every packet read from the TUN once it has been handled;
+        // `inspected` tells whether inspect() ran on it and `owner` is the flow's
+        // package (empty if the packet matched no flow). Returns false if the
+        // packet could not be passed on.
+        std::function<bool(const uint8_t* packet, size_t len, const std::string& owner, bool inspected)> observe;
+        // Optional. Packets queued ahead of the one about to be handled: TUN reads
+        // that found a packet waiting since the interface was last drained, plus
+        // replies not yet written back. Called before each TUN packet and on the
+        // loop's idle tick.
+        std::function<void(size_t pendingPackets, int64_t nowMs)> backlog;
+        std::function<void()> threadStarted;
+        std::function<void()> threadStopping;
+    };
+
+    struct ForwarderStats {
+        std::atomic<uint64_t> tunPacketsIn{0};
+        std::atomic<uint64_t> tunBytesIn{0};
+        std::atomic<uint64_t> tunPacketsOut{0};
+        std::atomic<uint64_t> tunBytesOut{0};
+        std::atomic<uint64_t> tcpSessions{0};
+        std::atomic<uint64_t> udpSessions{0};
+        std::atomic<uint64_t> activeTcp{0};
+        std::atomic<uint64_t> activeUdp{0};
+        std::atomic<uint64_t> blockedFlows{0};
+        std::atomic<uint64_t> resets{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> mirrorDropped{0};
+    };
+
+    class EventLoop;
+
+    // Userspace TUN data plane ("tun2socket"): terminates the app's TCP flows in a
+    // minimal TCP state machine and NATs UDP datagrams onto protected sockets, all
+    // driven by one epoll thread. Replies are built in pooled buffers and written
+    // back to the TUN in batches once per loop iteration.
+    class Forwarder {
+    public:
+        Forwarder(const ForwarderConfig& config, Host host);
+        ~Forwarder();
+
+        Forwarder(const Forwarder&) = delete;
+        Forwarder& operator=(const Forwarder&) = delete;
+
+        // Spawns the forwarding thread. Returns false if the loop cannot be set up.
+        bool start();
+
+        // Wakes the loop, closes every relay socket and joins the thread.
+        void stop();
+
+        bool running() const { return active.load(std::memory_order_acquire); }
+
+        const ForwarderStats& stats() const { return counters; }
+
+        std::string statsJson() const;
+
+    private:
+        ForwarderConfig config;
+        Host host;
+        ForwarderStats counters;
+        std::unique_ptr<EventLoop> loop;
+        std::thread worker;
+        std::atomic<bool> active{false};
+    };
+
+} // namespace tun
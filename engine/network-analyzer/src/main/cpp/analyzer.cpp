@@ -1,88 +1,157 @@
 #include <jni.h>
+#include <memory>
 #include <string>
 #include <vector>
 #include <android/log.h>
-#include "PacketAnalyzer.hpp"
+#include "JniRegistration.hpp"
+#include "NetGuardEngine.hpp"
 
 #define LOG_TAG "NDKNetGuard"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 
-extern "C" {
+namespace {
 
-JNIEXPORT jstring JNICALL
-Java_com_clsoft_netguard_engine_network_analyzer_NativeBridge_getNativeVersion(JNIEnv* env, jobject /* this */) {
-    std::string version = "NDK Engine v1.0.0";
-    return env->NewStringUTF(version.c_str());
-}
+    jclass gStringClass = nullptr;
+    jclass gIllegalStateExceptionClass = nullptr;
 
-JNIEXPORT jobjectArray JNICALL
-Java_com_clsoft_netguard_engine_network_analyzer_NativeBridge_analyzePackets(
-        JNIEnv* env, jclass, jstring packageName, jobjectArray packetArray) {
-
-    std::string package;
-    if (packageName != nullptr) {
-        const char* packageChars = env->GetStringUTFChars(packageName, nullptr);
-        if (packageChars != nullptr) {
-            package.assign(packageChars);
-            env->ReleaseStringUTFChars(packageName, packageChars);
-        }
-    }
-
-    if (packetArray == nullptr) {
-        jclass stringClass = env->FindClass("java/lang/String");
-        if (stringClass == nullptr) {
+    jclass globalClass(JNIEnv* env, const char* name) {
+        jclass local = env->FindClass(name);
+        if (local == nullptr) {
             env->ExceptionClear();
             return nullptr;
         }
-        jobjectArray out = env->NewObjectArray(1, stringClass, nullptr);
-        PacketAnalysisResult result = PacketAnalyzer::analyzePacket(std::vector<uint8_t>{}, package);
-        env->SetObjectArrayElement(out, 0, env->NewStringUTF(result.json.c_str()));
-        env->DeleteLocalRef(stringClass);
-        return out;
+        auto global = static_cast<jclass>(env->NewGlobalRef(local));
+        env->DeleteLocalRef(local);
+        return global;
     }
 
-    jsize count = env->GetArrayLength(packetArray);
-    jclass stringClass = env->FindClass("java/lang/String");
-    if (stringClass == nullptr) {
-        env->ExceptionClear();
-        return nullptr;
+    jstring getNativeVersion(JNIEnv* env, jobject /* this */) {
+        std::string version = "NDK Engine v1.0.0";
+        return env->NewStringUTF(version.c_str());
     }
 
-    jobjectArray out = env->NewObjectArray(count, stringClass, nullptr);
-    if (out == nullptr) {
-        env->DeleteLocalRef(stringClass);
-        return nullptr;
-    }
+    jobjectArray analyzePackets(JNIEnv* env, jclass, jlong handle, jstring packageName, jobjectArray packetArray) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        if (engine == nullptr) {
+            return nullptr;
+        }
+        PacketAnalyzer& analyzer = engine->analyzer();
+
+        std::string package;
+        if (packageName != nullptr) {
+            const char* packageChars = env->GetStringUTFChars(packageName, nullptr);
+            if (packageChars != nullptr) {
+                package.assign(packageChars);
+                env->ReleaseStringUTFChars(packageName, packageChars);
+            }
+        }
 
-    for (jsize i = 0; i < count; ++i) {
-        jbyteArray pkt = static_cast<jbyteArray>(env->GetObjectArrayElement(packetArray, i));
-        if (pkt == nullptr) {
-            PacketAnalysisResult fallback = PacketAnalyzer::analyzePacket(std::vector<uint8_t>{}, package);
-            env->SetObjectArrayElement(out, i, env->NewStringUTF(fallback.json.c_str()));
-            continue;
+        if (packetArray == nullptr) {
+            jobjectArray out = env->NewObjectArray(1, gStringClass, nullptr);
+            if (out == nullptr) {
+                return nullptr;
+            }
+            PacketAnalysisResult result = analyzer.analyzePacket(std::vector<uint8_t>{}, package);
+            env->SetObjectArrayElement(out, 0, env->NewStringUTF(result.json.c_str()));
+            return out;
         }
 
-        jsize len = env->GetArrayLength(pkt);
-        std::vector<uint8_t> buffer(static_cast<size_t>(len));
-        if (len > 0) {
-            env->GetByteArrayRegion(pkt, 0, len, reinterpret_cast<jbyte*>(buffer.data()));
+        jsize count = env->GetArrayLength(packetArray);
+        jobjectArray out = env->NewObjectArray(count, gStringClass, nullptr);
+        if (out == nullptr) {
+            return nullptr;
         }
 
-        PacketAnalysisResult analysis = PacketAnalyzer::analyzePacket(buffer, package);
-        if (!analysis.highRisk) {
-            PacketAnalysisResult verification = PacketAnalyzer::analyzePacket(buffer, package);
-            if (verification.highRisk) {
-                analysis = verification;
+        for (jsize i = 0; i < count; ++i) {
+            jbyteArray pkt = static_cast<jbyteArray>(env->GetObjectArrayElement(packetArray, i));
+            if (pkt == nullptr) {
+                PacketAnalysisResult fallback = analyzer.analyzePacket(std::vector<uint8_t>{}, package);
+                env->SetObjectArrayElement(out, i, env->NewStringUTF(fallback.json.c_str()));
+                continue;
             }
+
+            jsize len = env->GetArrayLength(pkt);
+            std::vector<uint8_t> buffer(static_cast<size_t>(len));
+            if (len > 0) {
+                env->GetByteArrayRegion(pkt, 0, len, reinterpret_cast<jbyte*>(buffer.data()));
+            }
+
+            // Analyzed once: every call updates the flow's session, sketch, cache,
+            // TLS and scanner state, so a second pass would count the packet twice.
+            PacketAnalysisResult analysis = analyzer.analyzePacket(buffer, package);
+
+            // Capture only observes: the firewall is the one thing that blocks here.
+            analyzer.exportFlow(buffer.data(), buffer.size(), package, analysis, analysis.blockedByFirewall);
+
+            env->SetObjectArrayElement(out, i, env->NewStringUTF(analysis.json.c_str()));
+            env->DeleteLocalRef(pkt);
         }
 
-        env->SetObjectArrayElement(out, i, env->NewStringUTF(analysis.json.c_str()));
-        env->DeleteLocalRef(pkt);
+        return out;
+    }
+
+    // The Kotlin capture path owns the queue in front of analyzePackets, so it
+    // reports the depth itself.
+    void reportBacklog(JNIEnv* env, jclass, jlong handle, jint pendingPackets) {
+        std::shared_ptr<NetGuardEngine> engine = jni::engineFromHandle(env, handle);
+        if (engine == nullptr) {
+            return;
+        }
+        engine->overload().reportBacklog(pendingPackets > 0 ? static_cast<size_t>(pendingPackets) : 0);
+    }
+
+    const JNINativeMethod ANALYZER_METHODS[] = {
+            {"getNativeVersion", "()Ljava/lang/String;", reinterpret_cast<void*>(getNativeVersion)},
+            {"analyzePackets", "(JLjava/lang/String;[[B)[Ljava/lang/String;", reinterpret_cast<void*>(analyzePackets)},
+            {"reportBacklog", "(JI)V", reinterpret_cast<void*>(reportBacklog)},
+    };
+
+} // namespace
+
+namespace jni {
+
+    jclass stringClass() {
+        return gStringClass;
     }
 
-    env->DeleteLocalRef(stringClass);
-    return out;
-}
+    jclass illegalStateExceptionClass() {
+        return gIllegalStateExceptionClass;
+    }
+
+    bool registerAnalyzerNatives(JNIEnv* env, jclass bridge) {
+        return env->RegisterNatives(bridge, ANALYZER_METHODS,
+                                    sizeof(ANALYZER_METHODS) / sizeof(ANALYZER_METHODS[0])) == JNI_OK;
+    }
 
+} // namespace jni
+
+extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* /* reserved */) {
+    JNIEnv* env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
+    }
+
+    gStringClass = globalClass(env, "java/lang/String");
+    gIllegalStateExceptionClass = globalClass(env, "java/lang/IllegalStateException");
+    jclass bridge = env->FindClass(jni::NATIVE_BRIDGE_CLASS);
+    if (gStringClass == nullptr || gIllegalStateExceptionClass == nullptr || bridge == nullptr) {
+        LOGE("Unable to resolve JNI classes");
+        return JNI_ERR;
+    }
+
+    bool registered = jni::registerAnalyzerNatives(env, bridge) &&
+                      jni::registerEngineNatives(env, bridge) &&
+                      jni::registerFirewallNatives(env, bridge) &&
+                      jni::registerTlsNatives(env, bridge) &&
+                      jni::registerSignatureNatives(env, bridge) &&
+                      jni::registerSnapshotNatives(env, bridge) &&
+                      jni::registerForwarderNatives(env, bridge) &&
+                      jni::registerExportNatives(env, bridge);
+    env->DeleteLocalRef(bridge);
+    if (!registered) {
+        LOGE("Unable to register NativeBridge natives");
+        return JNI_ERR;
+    }
+    return JNI_VERSION_1_6;
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+package com.clsoft.netguard.engine.network.analyzer
+
+/**
+ * Platform callbacks for the native TUN forwarder. Both are invoked on the
+ * forwarder thread when it opens a new relay socket or sees a new flow.
+ */
+interface ForwarderHost {
+
+    /** Keeps the relay socket [fd] outside the VPN (VpnService.protect). */
+    fun protect(fd: Int): Boolean
+
+    /** Package that owns the flow, or null when it cannot be resolved. */
+    fun resolveOwner(
+        protocol: Int,
+        sourceIp: String,
+        sourcePort: Int,
+        destinationIp: String,
+        destinationPort: Int
+    ): String?
+}
\ No newline at end of file
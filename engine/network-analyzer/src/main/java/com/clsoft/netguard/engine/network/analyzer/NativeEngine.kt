@@ -0,0 +1,90 @@
+package com.clsoft.netguard.engine.network.analyzer
+
+import java.io.Closeable
+
+/**
+ * Owns one native engine instance (flow table, firewall rules, detection data
+ * and metrics). The VPN service and the firewall manager share [shared].
+ */
+class NativeEngine(config: EngineConfig = EngineConfig()) : Closeable {
+
+    @Volatile
+    private var handle: Long = NativeBridge.createEngine(config)
+
+    private fun requireHandle(): Long {
+        val current = handle
+        check(current != 0L) { "NativeEngine cerrado" }
+        return current
+    }
+
+    fun analyzePackets(packageName: String?, packets: Array<ByteArray>): Array<String> =
+        NativeBridge.analyzePackets(requireHandle(), packageName, packets)
+
+    /** Packets captured but not yet passed to [analyzePackets]; drives load shedding. */
+    fun reportBacklog(pendingPackets: Int) =
+        NativeBridge.reportBacklog(requireHandle(), pendingPackets)
+
+    fun applyFirewallRule(packageName: String, allow: Boolean) =
+        NativeBridge.applyFirewallRule(requireHandle(), packageName, allow)
+
+    /** Makes [blockedPackages] the complete set of packages the firewall blocks. */
+    fun replaceFirewallRules(blockedPackages: List<String>) =
+        NativeBridge.replaceFirewallRules(requireHandle(), blockedPackages.toTypedArray())
+
+    fun loadTlsFingerprints(path: String): Int =
+        NativeBridge.loadTlsFingerprints(requireHandle(), path)
+
+    fun loadSignatureDatabase(path: String): Int =
+        NativeBridge.loadSignatureDatabase(requireHandle(), path)
+
+    fun saveSnapshot(path: String): Boolean =
+        NativeBridge.saveEngineSnapshot(requireHandle(), path)
+
+    fun restoreSnapshot(path: String): Boolean =
+        NativeBridge.restoreEngineSnapshot(requireHandle(), path)
+
+    fun metrics(): String = NativeBridge.getEngineMetrics(requireHandle())
+
+    /**
+     * Starts forwarding the TUN [tunFd] natively, stopping any previous forwarder.
+     * Returns a descriptor that receives every packet read from the TUN framed
+     * with the verdict applied to it (see [PacketMirror]; the caller owns it),
+     * or -1 if the forwarder could not start.
+     */
+    fun startForwarder(tunFd: Int, mtu: Int, enforceRiskVerdicts: Boolean, host: ForwarderHost): Int =
+        NativeBridge.startForwarder(requireHandle(), tunFd, mtu, enforceRiskVerdicts, host)
+
+    fun stopForwarder() = NativeBridge.stopForwarder(requireHandle())
+
+    fun forwarderStats(): String = NativeBridge.getForwarderStats(requireHandle())
+
+    /**
+     * Exports expired flows as IPFIX (or NetFlow v9) to [target], either
+     * "udp://host:port" or a file path. Replaces any export already running.
+     */
+    fun startFlowExport(
+        target: String,
+        netflowV9: Boolean = false,
+        activeTimeoutSeconds: Int = 60,
+        idleTimeoutSeconds: Int = 15
+    ): Boolean =
+        NativeBridge.startFlowExport(requireHandle(), target, netflowV9, activeTimeoutSeconds, idleTimeoutSeconds)
+
+    fun stopFlowExport() = NativeBridge.stopFlowExport(requireHandle())
+
+    fun setFlowOwnerUid(packageName: String, uid: Int) =
+        NativeBridge.setFlowOwnerUid(requireHandle(), packageName, uid)
+
+    @Synchronized
+    override fun close() {
+        val current = handle
+        if (current != 0L) {
+            handle = 0L
+            NativeBridge.destroyEngine(current)
+        }
+    }
+
+    companion object {
+        val shared: NativeEngine by lazy { NativeEngine() }
+    }
+}
\ No newline at end of file
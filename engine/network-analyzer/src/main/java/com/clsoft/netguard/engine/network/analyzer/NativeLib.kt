@@ -1,12 +1,57 @@
 package com.clsoft.netguard.engine.network.analyzer
 
+data class EngineConfig(
+    val maxTrackedSessions: Int = 2048,
+    val sessionExpirationMs: Long = 10_000L,
+    val fastPathAfterPackets: Int = 8,
+    val packetBudgetMicros: Long = 250L,
+    val backlogBudget: Int = 512
+)
+
 object NativeBridge {
 
     init {
         System.loadLibrary("netguard_native")
     }
 
+    fun createEngine(config: EngineConfig = EngineConfig()): Long =
+        nativeCreateEngine(
+            config.maxTrackedSessions,
+            config.sessionExpirationMs,
+            config.fastPathAfterPackets,
+            config.packetBudgetMicros,
+            config.backlogBudget
+        )
+
+    private external fun nativeCreateEngine(
+        maxTrackedSessions: Int,
+        sessionExpirationMs: Long,
+        fastPathAfterPackets: Int,
+        packetBudgetMicros: Long,
+        backlogBudget: Int
+    ): Long
+    external fun destroyEngine(handle: Long)
+    external fun getEngineMetrics(handle: Long): String
+
     external fun getNativeVersion(): String
-    @JvmStatic external fun analyzePackets(packageName: String?, packets: Array<ByteArray>): Array<String>
-    external fun applyFirewallRule(packageName: String, allow: Boolean)
+    @JvmStatic external fun analyzePackets(handle: Long, packageName: String?, packets: Array<ByteArray>): Array<String>
+    @JvmStatic external fun reportBacklog(handle: Long, pendingPackets: Int)
+    external fun applyFirewallRule(handle: Long, packageName: String, allow: Boolean)
+    external fun replaceFirewallRules(handle: Long, blockedPackages: Array<String>)
+    external fun loadTlsFingerprints(handle: Long, path: String): Int
+    external fun loadSignatureDatabase(handle: Long, path: String): Int
+    external fun saveEngineSnapshot(handle: Long, path: String): Boolean
+    external fun restoreEngineSnapshot(handle: Long, path: String): Boolean
+    external fun startForwarder(handle: Long, tunFd: Int, mtu: Int, enforceRiskVerdicts: Boolean, host: ForwarderHost): Int
+    external fun stopForwarder(handle: Long)
+    external fun getForwarderStats(handle: Long): String
+    external fun startFlowExport(
+        handle: Long,
+        target: String,
+        netflowV9: Boolean,
+        activeTimeoutSeconds: Int,
+        idleTimeoutSeconds: Int
+    ): Boolean
+    external fun stopFlowExport(handle: Long)
+    external fun setFlowOwnerUid(handle: Long, packageName: String, uid: Int)
 }
\ No newline at end of file
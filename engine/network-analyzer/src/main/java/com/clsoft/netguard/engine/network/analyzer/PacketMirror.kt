@@ -0,0 +1,53 @@
+package com.clsoft.netguard.engine.network.analyzer
+
+import java.nio.ByteBuffer
+
+/**
+ * Frames read from the descriptor returned by [NativeEngine.startForwarder]:
+ * a [HEADER_BYTES] header with the verdict the forwarder applied, then the raw
+ * packet. Monitors report that verdict instead of analyzing the packet again.
+ */
+object PacketMirror {
+
+    const val HEADER_BYTES = 8
+
+    private const val VERSION = 1
+    private const val FLAG_INSPECTED = 0x01
+    private const val FLAG_BLOCKED = 0x02
+    private const val FLAG_FIREWALL_BLOCKED = 0x04
+    private const val FLAG_APPROXIMATE = 0x08
+
+    data class Verdict(
+        val riskLabel: String,
+        val riskScore: Float,
+        val blocked: Boolean,
+        val firewallBlocked: Boolean,
+        val approximate: Boolean
+    )
+
+    /**
+     * Verdict carried by [frame], or null when the packet was relayed without
+     * inspection (bare ACKs) or the frame is not a mirror frame.
+     */
+    fun verdict(frame: ByteArray, length: Int): Verdict? {
+        if (length < HEADER_BYTES || frame[0].toInt() != VERSION) {
+            return null
+        }
+        val flags = frame[1].toInt() and 0xFF
+        if (flags and FLAG_INSPECTED == 0) {
+            return null
+        }
+        val label = when (frame[2].toInt()) {
+            2 -> "High"
+            1 -> "Medium"
+            else -> "Low"
+        }
+        return Verdict(
+            riskLabel = label,
+            riskScore = ByteBuffer.wrap(frame, 4, 4).float.coerceIn(0f, 1f),
+            blocked = flags and FLAG_BLOCKED != 0,
+            firewallBlocked = flags and FLAG_FIREWALL_BLOCKED != 0,
+            approximate = flags and FLAG_APPROXIMATE != 0
+        )
+    }
+}
\ No newline at end of file
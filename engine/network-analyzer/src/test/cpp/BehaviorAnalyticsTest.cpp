@@ -0,0 +1,245 @@
+#include "BehaviorAnalytics.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+    using behavior::Analytics;
+    using behavior::Observation;
+    using behavior::Signals;
+
+    constexpr int64_t START_MS = 1'000'000;     // zero is the sketches' "unset" marker
+    constexpr int64_t EPOCH_MS = 60'000;
+    constexpr const char* SOURCE = "10.0.0.2";
+    constexpr const char* APP = "com.example.app";
+
+    std::string host(int index) {
+        return "198.51." + std::to_string((index >> 8) & 0xff) + "." + std::to_string(index & 0xff);
+    }
+
+    Signals observe(Analytics& analytics, const std::string& destination, int port, int64_t timestampMs,
+                    size_t payloadLength = 512, const char* app = APP) {
+        Observation observation;
+        observation.sourceIp = SOURCE;
+        observation.destinationIp = destination;
+        observation.appPackage = app;
+        observation.destinationPort = port;
+        observation.payloadLength = payloadLength;
+        observation.timestampMs = timestampMs;
+        return analytics.observe(observation);
+    }
+
+    TEST(BehaviorSketches, PacketCountsNeverUnderEstimate) {
+        Analytics analytics;
+        constexpr int DESTINATIONS = 300;
+        for (int round = 0; round < 8; ++round) {
+            for (int i = 0; i < DESTINATIONS; ++i) {
+                if (round < i % 8 + 1) observe(analytics, host(i), 443, START_MS + round);
+            }
+        }
+
+        int exact = 0;
+        for (int i = 0; i < DESTINATIONS; ++i) {
+            const uint32_t expected = static_cast<uint32_t>(i % 8 + 1) + 1;
+            const Signals signals = observe(analytics, host(i), 443, START_MS + 10);
+            EXPECT_GE(signals.packetsToDestination, expected) << host(i);
+            exact += signals.packetsToDestination == expected;
+        }
+        // 300 keys in 1024 columns x 4 rows: collisions on every row are rare.
+        EXPECT_GE(exact, DESTINATIONS * 9 / 10);
+    }
+
+    TEST(BehaviorSketches, FanOutCountsDistinctDestinationsOnce) {
+        Analytics analytics;
+        Signals signals;
+        for (int i = 0; i < 400; ++i) {
+            signals = observe(analytics, host(i), 443, START_MS + i);
+            observe(analytics, host(i), 443, START_MS + i);
+        }
+        EXPECT_GE(signals.destinationFanOut, 395u);
+        EXPECT_LE(signals.destinationFanOut, 410u);
+
+        signals = observe(analytics, host(0), 443, START_MS + 500);
+        EXPECT_GE(signals.destinationFanOut, 395u);
+        EXPECT_LE(signals.destinationFanOut, 410u);
+    }
+
+    TEST(BehaviorSketches, PortAndHostSweepsAreCounted) {
+        Analytics analytics;
+        Signals vertical;
+        for (int port = 1; port <= 500; ++port) {
+            vertical = observe(analytics, "203.0.113.7", port, START_MS + port, 0);
+        }
+        EXPECT_GE(vertical.portsPerHost, 495u);
+        EXPECT_LE(vertical.portsPerHost, 510u);
+
+        Signals horizontal;
+        for (int i = 0; i < 300; ++i) {
+            horizontal = observe(analytics, host(i), 445, START_MS + 1000 + i, 0);
+        }
+        EXPECT_GE(horizontal.hostsPerPort, 295u);
+        EXPECT_LE(horizontal.hostsPerPort, 310u);
+        EXPECT_LE(horizontal.portsPerHost, 5u);
+    }
+
+    TEST(BehaviorSketches, AppDistinctCountsStayWithinHyperLogLogError) {
+        Analytics analytics;
+        Signals signals;
+        for (int i = 0; i < 20; ++i) {
+            signals = observe(analytics, host(i), 443, START_MS + i);
+        }
+        // Small cardinalities go through linear counting and are close to exact.
+        EXPECT_NEAR(signals.appDistinctHosts, 20.0, 2.0);
+        EXPECT_NEAR(signals.appDistinctPorts, 1.0, 0.5);
+
+        for (int i = 20; i < 5000; ++i) {
+            signals = observe(analytics, host(i), 1024 + i % 100, START_MS + i);
+        }
+        // 256 registers: standard error ~6.5%; allow three of them.
+        EXPECT_NEAR(signals.appDistinctHosts, 5000.0, 5000.0 * 0.2);
+        EXPECT_NEAR(signals.appDistinctPorts, 101.0, 101.0 * 0.2);
+
+        const Signals other = observe(analytics, host(0), 443, START_MS + 6000, 512, "com.example.other");
+        EXPECT_NEAR(other.appDistinctHosts, 1.0, 0.5);
+    }
+
+    TEST(BehaviorSketches, SmallPacketFloodIsCountedSeparately) {
+        Analytics analytics;
+        Signals signals;
+        for (int i = 0; i < 1000; ++i) {
+            signals = observe(analytics, "203.0.113.9", 53, START_MS + i, 40);
+        }
+        EXPECT_GE(signals.smallPacketsToDestination, 1000u);
+        EXPECT_GE(signals.packetsToDestination, 1000u);
+
+        for (int i = 0; i < 100; ++i) {
+            signals = observe(analytics, "203.0.113.9", 53, START_MS + 2000 + i, 1200);
+        }
+        EXPECT_GE(signals.packetsToDestination, 1100u);
+        EXPECT_LT(signals.smallPacketsToDestination, 1100u);
+    }
+
+    TEST(BehaviorBeacon, PeriodicCheckInsAreFlagged) {
+        Analytics analytics;
+        constexpr int64_t PERIOD_MS = 30'000;
+        const int64_t jitterMs[] = {0, 150, -200, 100, -50, 250, -150, 50, 0, -100, 200, -250};
+        Signals signals;
+        int64_t at = START_MS;
+        for (int64_t jitter : jitterMs) {
+            // Each check-in is a short burst; packets under a second apart are one check-in.
+            for (int packet = 0; packet < 3; ++packet) {
+                signals = observe(analytics, "203.0.113.50", 8443, at + jitter + packet * 100);
+            }
+            at += PERIOD_MS;
+        }
+        EXPECT_TRUE(signals.beaconing);
+        EXPECT_NEAR(signals.beaconPeriodSeconds, 30.0, 0.5);
+        EXPECT_LT(signals.beaconJitter, 0.05);
+    }
+
+    TEST(BehaviorBeacon, IrregularTrafficIsNotFlagged) {
+        Analytics analytics;
+        const int64_t gapsMs[] = {4'000, 47'000, 9'000, 120'000, 15'000, 70'000, 6'000, 33'000, 90'000, 12'000};
+        Signals signals;
+        int64_t at = START_MS;
+        signals = observe(analytics, "203.0.113.51", 8443, at);
+        for (int64_t gap : gapsMs) {
+            at += gap;
+            signals = observe(analytics, "203.0.113.51", 8443, at);
+        }
+        EXPECT_FALSE(signals.beaconing);
+        EXPECT_GT(signals.beaconJitter, 0.15);
+    }
+
+    TEST(BehaviorBeacon, TooFewCheckInsAreNotJudged) {
+        Analytics analytics;
+        Signals signals;
+        for (int i = 0; i < 6; ++i) {
+            signals = observe(analytics, "203.0.113.52", 8443, START_MS + i * 10'000);
+        }
+        EXPECT_FALSE(signals.beaconing);
+        EXPECT_EQ(signals.beaconPeriodSeconds, 0.0);
+    }
+
+    TEST(BehaviorWindow, PreviousEpochStaysVisibleThenRotatesOut) {
+        Analytics analytics;
+        for (int i = 0; i < 50; ++i) {
+            observe(analytics, host(i), 443, START_MS + i);
+        }
+
+        // One epoch later the old traffic is the previous epoch and still counts.
+        Signals signals = observe(analytics, host(1000), 443, START_MS + EPOCH_MS);
+        EXPECT_GE(signals.destinationFanOut, 50u);
+        signals = observe(analytics, host(0), 443, START_MS + EPOCH_MS + 1);
+        EXPECT_GE(signals.packetsToDestination, 1u);
+
+        // Another epoch on, it has rotated out of the window. The window reports
+        // the larger of the two epochs' estimates, not their sum.
+        signals = observe(analytics, host(0), 443, START_MS + 2 * EPOCH_MS + 1);
+        EXPECT_EQ(signals.packetsToDestination, 1u);
+        EXPECT_LE(signals.destinationFanOut, 2u);
+        signals = observe(analytics, host(2000), 443, START_MS + 3 * EPOCH_MS + 2);
+        EXPECT_EQ(signals.packetsToDestination, 1u);
+        EXPECT_LE(signals.destinationFanOut, 2u);
+    }
+
+    TEST(BehaviorWindow, IdleGapClearsBothEpochs) {
+        Analytics analytics;
+        for (int i = 0; i < 50; ++i) {
+            observe(analytics, host(i), 443, START_MS + i);
+        }
+        const Signals signals = observe(analytics, host(0), 443, START_MS + 5 * EPOCH_MS);
+        EXPECT_EQ(signals.destinationFanOut, 1u);
+        EXPECT_EQ(signals.packetsToDestination, 1u);
+    }
+
+    TEST(BehaviorState, SaveAndRestoreCarriesTheSketches) {
+        Analytics source;
+        for (int i = 0; i < 9; ++i) {
+            observe(source, "203.0.113.50", 8443, START_MS + i * 30'000);
+        }
+        const int64_t lastCheckIn = START_MS + 8 * 30'000;
+        for (int i = 0; i < 100; ++i) {
+            observe(source, host(i), 443, lastCheckIn + i);
+        }
+        const int64_t savedAt = lastCheckIn + 100;
+        std::vector<uint8_t> state(source.stateSize());
+        source.saveState(state.data(), savedAt);
+
+        // Restored on a different clock after five seconds of downtime.
+        constexpr int64_t RESTORED_AT = 9'000'000;
+        Analytics restored;
+        ASSERT_TRUE(restored.restoreState(state.data(), state.size(), RESTORED_AT, 5'000));
+
+        Signals signals = observe(restored, host(0), 443, RESTORED_AT + 1);
+        EXPECT_EQ(signals.packetsToDestination, 2u);
+        signals = observe(restored, "203.0.113.50", 8443, RESTORED_AT + 25'000);
+        EXPECT_TRUE(signals.beaconing);
+        EXPECT_NEAR(signals.beaconPeriodSeconds, 30.0, 0.5);
+    }
+
+    TEST(BehaviorState, StateFromAnotherLayoutIsRejected) {
+        Analytics source;
+        observe(source, host(0), 443, START_MS);
+        std::vector<uint8_t> state(source.stateSize());
+        source.saveState(state.data(), START_MS);
+
+        Analytics restored;
+        std::vector<uint8_t> otherVersion = state;
+        uint32_t version = 0;
+        std::memcpy(&version, otherVersion.data(), sizeof(version));
+        version++;
+        std::memcpy(otherVersion.data(), &version, sizeof(version));
+        EXPECT_FALSE(restored.restoreState(otherVersion.data(), otherVersion.size(), START_MS, 0));
+        EXPECT_FALSE(restored.restoreState(state.data(), state.size() - 8, START_MS, 0));
+
+        const Signals signals = observe(restored, host(0), 443, START_MS + 1);
+        EXPECT_EQ(signals.packetsToDestination, 1u);
+    }
+
+} // namespace
\ No newline at end of file
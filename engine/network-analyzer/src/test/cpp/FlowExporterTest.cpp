@@ -0,0 +1,289 @@
+#include "FlowCollector.hpp"
+#include "NetGuardEngine.hpp"
+#include "TestPackets.hpp"
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <fstream>
+#include <iterator>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    using collector::FieldKey;
+    using testpackets::Endpoints;
+
+    constexpr const char* PACKAGE = "com.example.app";
+    constexpr int32_t PACKAGE_UID = 10123;
+
+    // IANA information elements used by templates 256 (IPv4) and 257 (IPv6).
+    const FieldKey SOURCE_IPV4{0, 8};
+    const FieldKey DESTINATION_IPV4{0, 12};
+    const FieldKey SOURCE_IPV6{0, 27};
+    const FieldKey DESTINATION_IPV6{0, 28};
+    const FieldKey SOURCE_PORT{0, 7};
+    const FieldKey DESTINATION_PORT{0, 11};
+    const FieldKey PROTOCOL{0, 4};
+    const FieldKey PACKETS{0, 2};
+    const FieldKey OCTETS{0, 1};
+    const FieldKey END_REASON{0, 136};
+
+    FieldKey netguardField(flowexport::Format format, uint16_t id) {
+        return format == flowexport::Format::Ipfix ? FieldKey{flowexport::ENTERPRISE_NUMBER, id}
+                                                   : FieldKey{0, static_cast<uint16_t>(0x8000 | id)};
+    }
+
+    // Loopback UDP socket standing in for the collector's listener.
+    class UdpListener {
+    public:
+        UdpListener() {
+            fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+            socklen_t length = sizeof(address);
+            ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+            port = ntohs(address.sin_port);
+        }
+
+        ~UdpListener() { ::close(fd); }
+
+        std::string target() const { return "udp://127.0.0.1:" + std::to_string(port); }
+
+        // Feeds every datagram already queued to `sink`; returns how many there were.
+        size_t drain(collector::Collector& sink) {
+            size_t datagrams = 0;
+            std::vector<uint8_t> buffer(65536);
+            pollfd ready{fd, POLLIN, 0};
+            while (::poll(&ready, 1, 200) > 0) {
+                ssize_t n = ::recv(fd, buffer.data(), buffer.size(), 0);
+                if (n <= 0) break;
+                EXPECT_TRUE(sink.decodeStream(buffer.data(), static_cast<size_t>(n))) << sink.error;
+                datagrams++;
+            }
+            return datagrams;
+        }
+
+        int fd = -1;
+        uint16_t port = 0;
+    };
+
+    // What the capture loop does for each packet it owns; the forwarder passes
+    // its own block decision instead.
+    void relay(NetGuardEngine& engine, const std::vector<uint8_t>& packet) {
+        PacketAnalysisResult result = engine.analyzer().analyzePacket(packet, PACKAGE);
+        engine.analyzer().exportFlow(packet.data(), packet.size(), PACKAGE, result, result.blockedByFirewall);
+    }
+
+    struct SentFlows {
+        Endpoints v4;
+        Endpoints v6;
+        size_t v4Packets = 5;
+        size_t v6Packets = 3;
+        uint64_t v4Bytes = 0;
+        uint64_t v6Bytes = 0;
+    };
+
+    SentFlows sendFlows(NetGuardEngine& engine) {
+        SentFlows sent;
+        sent.v6.srcIp = "fd00::2";
+        sent.v6.dstIp = "2001:db8::10";
+        sent.v6.srcPort = 50000;
+        for (size_t i = 0; i < sent.v4Packets; ++i) {
+            auto packet = testpackets::tcp(sent.v4, testpackets::TCP_ACK | testpackets::TCP_PSH,
+                                           std::vector<uint8_t>(300, 'x'), static_cast<uint32_t>(1000 + i * 300));
+            sent.v4Bytes += packet.size();
+            relay(engine, packet);
+        }
+        for (size_t i = 0; i < sent.v6Packets; ++i) {
+            auto packet = testpackets::udp(sent.v6, std::vector<uint8_t>(200, 'q'));
+            sent.v6Bytes += packet.size();
+            relay(engine, packet);
+        }
+        return sent;
+    }
+
+    const collector::Record* findRecord(const collector::Collector& sink, uint16_t templateId) {
+        for (const auto& record : sink.records) {
+            if (record.templateId == templateId) return &record;
+        }
+        return nullptr;
+    }
+
+    void expectTemplates(const collector::Collector& sink, flowexport::Format format) {
+        ASSERT_EQ(sink.templates.count(256), 1u);
+        ASSERT_EQ(sink.templates.count(257), 1u);
+        const auto& v4 = sink.templates.at(256);
+        const auto& v6 = sink.templates.at(257);
+        ASSERT_EQ(v4.size(), 16u);
+        ASSERT_EQ(v6.size(), 16u);
+        EXPECT_EQ(v4[0].key, SOURCE_IPV4);
+        EXPECT_EQ(v4[0].length, 4);
+        EXPECT_EQ(v6[0].key, SOURCE_IPV6);
+        EXPECT_EQ(v6[0].length, 16);
+        EXPECT_EQ(v4[11].key, netguardField(format, 1));   // app package
+        EXPECT_EQ(v4[11].length, flowexport::PACKAGE_FIELD_BYTES);
+    }
+
+    void expectRecords(const collector::Collector& sink, const SentFlows& sent, flowexport::Format format) {
+        ASSERT_EQ(sink.records.size(), 2u);
+
+        const collector::Record* v4 = findRecord(sink, 256);
+        ASSERT_NE(v4, nullptr);
+        uint8_t address[16] = {};
+        inet_pton(AF_INET, sent.v4.dstIp.c_str(), address);
+        EXPECT_EQ(v4->bytes(DESTINATION_IPV4), std::vector<uint8_t>(address, address + 4));
+        EXPECT_EQ(v4->number(SOURCE_PORT), sent.v4.srcPort);
+        EXPECT_EQ(v4->number(DESTINATION_PORT), sent.v4.dstPort);
+        EXPECT_EQ(v4->number(PROTOCOL), static_cast<uint64_t>(IPPROTO_TCP));
+        EXPECT_EQ(v4->number(PACKETS), sent.v4Packets);
+        EXPECT_EQ(v4->number(OCTETS), sent.v4Bytes);
+        EXPECT_EQ(v4->number(END_REASON), static_cast<uint64_t>(flowexport::EndReason::ForcedEnd));
+        EXPECT_EQ(v4->text(netguardField(format, 1)), PACKAGE);
+        EXPECT_EQ(static_cast<int32_t>(v4->number(netguardField(format, 2))), PACKAGE_UID);
+        EXPECT_EQ(v4->number(netguardField(format, 3)), 50u);   // HTTPS port: Medium, 0.5
+        EXPECT_EQ(v4->number(netguardField(format, 4)), static_cast<uint64_t>(conntrack::RiskLabel::Medium));
+        EXPECT_EQ(v4->number(netguardField(format, 5)), static_cast<uint64_t>(flowexport::BlockReason::None));
+
+        const collector::Record* v6 = findRecord(sink, 257);
+        ASSERT_NE(v6, nullptr);
+        inet_pton(AF_INET6, sent.v6.srcIp.c_str(), address);
+        EXPECT_EQ(v6->bytes(SOURCE_IPV6), std::vector<uint8_t>(address, address + 16));
+        inet_pton(AF_INET6, sent.v6.dstIp.c_str(), address);
+        EXPECT_EQ(v6->bytes(DESTINATION_IPV6), std::vector<uint8_t>(address, address + 16));
+        EXPECT_EQ(v6->number(PROTOCOL), static_cast<uint64_t>(IPPROTO_UDP));
+        EXPECT_EQ(v6->number(PACKETS), sent.v6Packets);
+        EXPECT_EQ(v6->number(OCTETS), sent.v6Bytes);
+    }
+
+    TEST(FlowExporter, IpfixOverUdpDecodesWithItsOwnTemplates) {
+        UdpListener listener;
+        NetGuardEngine engine{EngineConfig{}};
+        flowexport::ExportConfig config;
+        config.target = listener.target();
+        config.observationDomain = 7;
+        ASSERT_TRUE(engine.flowExporter().start(config));
+        engine.flowExporter().setOwnerUid(PACKAGE, PACKAGE_UID);
+
+        const SentFlows sent = sendFlows(engine);
+        engine.flowExporter().stop();
+
+        collector::Collector sink;
+        ASSERT_GT(listener.drain(sink), 0u);
+        ASSERT_FALSE(sink.messages.empty());
+        EXPECT_EQ(sink.messages[0].version, 10);
+        EXPECT_EQ(sink.messages[0].domain, 7u);
+        EXPECT_EQ(sink.messages[0].sequence, 0u);
+        expectTemplates(sink, flowexport::Format::Ipfix);
+        expectRecords(sink, sent, flowexport::Format::Ipfix);
+    }
+
+    TEST(FlowExporter, NetflowV9FileDecodesWithItsOwnTemplates) {
+        const std::string path = ::testing::TempDir() + "flows_" + std::to_string(::getpid()) + ".nf9";
+        NetGuardEngine engine{EngineConfig{}};
+        flowexport::ExportConfig config;
+        config.format = flowexport::Format::NetflowV9;
+        config.target = path;
+        ASSERT_TRUE(engine.flowExporter().start(config));
+        engine.flowExporter().setOwnerUid(PACKAGE, PACKAGE_UID);
+
+        const SentFlows sent = sendFlows(engine);
+        engine.flowExporter().stop();
+
+        std::ifstream file(path, std::ios::binary);
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        ::unlink(path.c_str());
+
+        collector::Collector sink;
+        ASSERT_TRUE(sink.decodeStream(bytes)) << sink.error;
+        ASSERT_FALSE(sink.messages.empty());
+        EXPECT_EQ(sink.messages[0].version, 9);
+        expectTemplates(sink, flowexport::Format::NetflowV9);
+        expectRecords(sink, sent, flowexport::Format::NetflowV9);
+    }
+
+    TEST(FlowExporter, PacketIsCountedOnceHoweverOftenItIsAnalyzed) {
+        UdpListener listener;
+        NetGuardEngine engine{EngineConfig{}};
+        flowexport::ExportConfig config;
+        config.target = listener.target();
+        ASSERT_TRUE(engine.flowExporter().start(config));
+
+        const Endpoints ends;
+        constexpr size_t SENT = 4;
+        for (size_t i = 0; i < SENT; ++i) {
+            auto packet = testpackets::tcp(ends, testpackets::TCP_ACK, std::vector<uint8_t>(300, 'x'));
+            // An extra analysis of the packet must not add to its flow.
+            engine.analyzer().analyzePacket(packet, PACKAGE);
+            relay(engine, packet);
+        }
+        // Analysis alone never reaches the export.
+        Endpoints other = ends;
+        other.srcPort = 41000;
+        engine.analyzer().analyzePacket(testpackets::tcp(other, testpackets::TCP_ACK, {}), PACKAGE);
+        engine.flowExporter().stop();
+
+        collector::Collector sink;
+        listener.drain(sink);
+        ASSERT_EQ(sink.records.size(), 1u);
+        EXPECT_EQ(sink.records[0].number(PACKETS), SENT);
+        EXPECT_EQ(sink.records[0].number(SOURCE_PORT), ends.srcPort);
+    }
+
+    TEST(FlowExporter, FirewallBlockIsReportedAsTheBlockReason) {
+        UdpListener listener;
+        NetGuardEngine engine{EngineConfig{}};
+        flowexport::ExportConfig config;
+        config.target = listener.target();
+        ASSERT_TRUE(engine.flowExporter().start(config));
+        engine.rules().setRule(PACKAGE, false);
+
+        relay(engine, testpackets::tcp(Endpoints{}, testpackets::TCP_SYN, {}));
+        engine.flowExporter().stop();
+
+        collector::Collector sink;
+        listener.drain(sink);
+        ASSERT_EQ(sink.records.size(), 1u);
+        EXPECT_EQ(sink.records[0].number(netguardField(flowexport::Format::Ipfix, 5)),
+                  static_cast<uint64_t>(flowexport::BlockReason::Firewall));
+    }
+
+    TEST(FlowExporter, RiskBlockReasonOnlyForPacketsThatWereBlocked) {
+        UdpListener listener;
+        NetGuardEngine engine{EngineConfig{}};
+        flowexport::ExportConfig config;
+        config.target = listener.target();
+        ASSERT_TRUE(engine.flowExporter().start(config));
+
+        // SMB: a High verdict, once forwarded anyway and once blocked.
+        Endpoints forwarded;
+        forwarded.dstPort = 445;
+        Endpoints blocked = forwarded;
+        blocked.srcPort = 41000;
+        for (const Endpoints* ends : {&forwarded, &blocked}) {
+            const auto packet = testpackets::tcp(*ends, testpackets::TCP_SYN, {});
+            const PacketAnalysisResult result = engine.analyzer().analyzePacket(packet, PACKAGE);
+            ASSERT_TRUE(result.highRisk);
+            engine.analyzer().exportFlow(packet.data(), packet.size(), PACKAGE, result, ends == &blocked);
+        }
+        engine.flowExporter().stop();
+
+        collector::Collector sink;
+        listener.drain(sink);
+        ASSERT_EQ(sink.records.size(), 2u);
+        const FieldKey reasonField = netguardField(flowexport::Format::Ipfix, 5);
+        for (const auto& record : sink.records) {
+            const auto expected = record.number(SOURCE_PORT) == blocked.srcPort ? flowexport::BlockReason::Risk
+                                                                                : flowexport::BlockReason::None;
+            EXPECT_EQ(record.number(reasonField), static_cast<uint64_t>(expected));
+        }
+    }
+
+} // namespace
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "NetGuardEngine.hpp"
+#include "OverloadController.hpp"
+#include "TestPackets.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    using overload::Mode;
+
+    overload::Budget backlogBudget(size_t packets) {
+        overload::Budget budget;
+        budget.backlogPackets = packets;
+        return budget;
+    }
+
+    int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    TEST(OverloadController, BacklogEscalatesOneStepPerHoldOnTick) {
+        overload::Controller controller{backlogBudget(10)};
+        controller.reportBacklog(100);
+
+        controller.tick(1000);
+        EXPECT_EQ(controller.mode(), Mode::SkipChecksums);
+        controller.tick(1050);   // still settling after the last step
+        EXPECT_EQ(controller.mode(), Mode::SkipChecksums);
+        controller.tick(1100);
+        EXPECT_EQ(controller.mode(), Mode::SamplePayload);
+    }
+
+    TEST(OverloadController, TicksAloneStepBackDownWhenTheBacklogDrains) {
+        overload::Controller controller{backlogBudget(10)};
+        controller.reportBacklog(100);
+        controller.tick(1000);
+        ASSERT_EQ(controller.mode(), Mode::SkipChecksums);
+
+        controller.reportBacklog(0);
+        controller.tick(1200);
+        EXPECT_EQ(controller.mode(), Mode::SkipChecksums);   // calm period starts
+        controller.tick(3200);
+        EXPECT_EQ(controller.mode(), Mode::Full);
+    }
+
+    TEST(OverloadController, StaleCostStopsCountingWhenNothingIsAnalyzed) {
+        overload::Budget budget;
+        budget.packetCostNs = 1000;
+        overload::Controller controller{budget};
+        controller.recordCost(100000, 1000);
+        ASSERT_EQ(controller.mode(), Mode::SkipChecksums);
+
+        // No further samples, e.g. the device went idle or every packet hit the
+        // fast path: the expensive average must not pin the degraded mode.
+        controller.tick(2100);
+        controller.tick(4100);
+        EXPECT_EQ(controller.mode(), Mode::Full);
+    }
+
+    class SampledPayloadTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            path = ::testing::TempDir() + "overload_signatures_" + std::to_string(::getpid()) + ".txt";
+            std::ofstream out(path);
+            out << "1\t0.9\tTest.Evil\tEVILPATTERN\n";
+            out.close();
+            ASSERT_EQ(engine.signatureScanner().loadDatabase(path), 1);
+        }
+
+        void TearDown() override { std::remove(path.c_str()); }
+
+        static EngineConfig config() {
+            EngineConfig config;
+            config.fastPathAfterPackets = 0;   // every packet takes the analyzed path
+            config.overloadBudget.backlogPackets = 1;
+            return config;
+        }
+
+        PacketAnalysisResult send(const std::string& payload) {
+            PacketAnalysisResult result = engine.analyzer().analyzePacket(
+                    testpackets::tcp(ends, testpackets::TCP_ACK | testpackets::TCP_PSH,
+                                     std::vector<uint8_t>(payload.begin(), payload.end()), seq),
+                    "com.example");
+            seq += static_cast<uint32_t>(payload.size());
+            return result;
+        }
+
+        static bool matched(const PacketAnalysisResult& result) {
+            return result.json.find("\"signatures\":[1]") != std::string::npos;
+        }
+
+        std::string path;
+        NetGuardEngine engine{config()};
+        testpackets::Endpoints ends;
+        uint32_t seq = 1000;
+    };
+
+    TEST_F(SampledPayloadTest, SkippedPacketsBreakSignatureMatchesAcrossThem) {
+        overload::Controller& controller = engine.overload();
+        controller.reportBacklog(1000);
+        const int64_t future = nowMs() + 60000;   // keeps the analyzer's own ticks from re-evaluating
+        controller.tick(future);
+        controller.tick(future + 200);
+        ASSERT_EQ(controller.mode(), Mode::SamplePayload);
+
+        // One packet in eight is inspected: the 8th, 16th and 24th of the flow.
+        for (int i = 1; i <= 7; ++i) send("filler");
+        EXPECT_FALSE(matched(send("xxxxEVIL")));
+        for (int i = 9; i <= 15; ++i) send("filler");
+        EXPECT_FALSE(matched(send("PATTERNxx")));
+        for (int i = 17; i <= 23; ++i) send("filler");
+        EXPECT_TRUE(matched(send("EVILPATTERN")));
+        EXPECT_GT(controller.shedCounts().payloads, 0u);
+    }
+
+} // namespace
\ No newline at end of file
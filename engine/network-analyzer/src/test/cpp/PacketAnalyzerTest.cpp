@@ -0,0 +1,154 @@
+#include "NetGuardEngine.hpp"
+#include "TestPackets.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    using testpackets::Endpoints;
+
+    // Mid-size payloads keep the small-packet stream heuristic quiet, so the flow
+    // settles on a Medium verdict (HTTPS port) and moves to the fast path.
+    std::vector<uint8_t> streamPacket(const Endpoints& ends, uint32_t seq) {
+        return testpackets::tcp(ends, testpackets::TCP_ACK | testpackets::TCP_PSH,
+                                std::vector<uint8_t>(400, 'a'), seq);
+    }
+
+    bool isFastPath(const PacketAnalysisResult& result) {
+        return result.json.find("\"fastPath\":true") != std::string::npos;
+    }
+
+    bool hasSignature(const PacketAnalysisResult& result, uint32_t id) {
+        return result.json.find("\"signatures\":[" + std::to_string(id) + "]") != std::string::npos;
+    }
+
+    // Installs a one-signature database ("EVILPATTERN", id 7) in the engine.
+    void loadSignatures(NetGuardEngine& engine) {
+        const std::string path = ::testing::TempDir() + "fastpath_signatures_" + std::to_string(::getpid()) + ".txt";
+        {
+            std::ofstream out(path);
+            out << "7\t0.9\tTest.Evil\tEVILPATTERN\n";
+        }
+        ASSERT_EQ(engine.signatureScanner().loadDatabase(path), 1);
+        std::remove(path.c_str());
+    }
+
+    int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    TEST(PacketAnalyzerFastPath, CachedPacketsStillCountTowardsTheSession) {
+        NetGuardEngine engine{EngineConfig{}};
+        const Endpoints ends;
+        constexpr int PACKETS = 40;
+        int fast = 0;
+        for (int i = 0; i < PACKETS; ++i) {
+            fast += isFastPath(engine.analyzer().analyzePacket(streamPacket(ends, 1000 + i * 400), "com.example"));
+        }
+        ASSERT_GT(fast, 0);
+
+        const std::vector<SessionRecord> sessions = engine.analyzer().exportSessions();
+        ASSERT_EQ(sessions.size(), 1u);
+        EXPECT_EQ(sessions[0].key, ends.srcIp + "->" + ends.dstIp + ":443");
+        EXPECT_EQ(sessions[0].count, static_cast<uint64_t>(PACKETS));
+    }
+
+    TEST(PacketAnalyzerFastPath, CachedPacketsFeedTheBehaviorSketches) {
+        NetGuardEngine engine{EngineConfig{}};
+        const Endpoints ends;
+        constexpr int PACKETS = 40;
+        for (int i = 0; i < PACKETS; ++i) {
+            engine.analyzer().analyzePacket(streamPacket(ends, 1000 + i * 400), "com.example");
+        }
+        ASSERT_GT(engine.metrics().fastPath.load(), 0u);
+
+        behavior::Observation probe;
+        probe.sourceIp = ends.srcIp;
+        probe.destinationIp = ends.dstIp;
+        probe.appPackage = "com.example";
+        probe.destinationPort = ends.dstPort;
+        probe.payloadLength = 400;
+        probe.timestampMs = nowMs();
+        const behavior::Signals signals = engine.behaviorAnalytics().observe(probe);
+        // Count-min never under-estimates: every packet, fast path or not, plus the probe.
+        EXPECT_GE(signals.packetsToDestination, static_cast<uint32_t>(PACKETS + 1));
+    }
+
+    TEST(PacketAnalyzerFastPath, BehaviorAboveTheCachedVerdictForcesFullAnalysis) {
+        NetGuardEngine engine{EngineConfig{}};
+        const Endpoints ends;
+        uint32_t seq = 1000;
+        PacketAnalysisResult last;
+        for (int i = 0; i < 16; ++i, seq += 400) {
+            last = engine.analyzer().analyzePacket(streamPacket(ends, seq), "com.example");
+        }
+        ASSERT_TRUE(isFastPath(last));
+        ASSERT_LT(last.riskScore, 0.88);
+
+        // Another socket of the same app probes many ports on the same host.
+        Endpoints probe = ends;
+        probe.srcPort = 41000;
+        for (uint16_t port = 2000; port < 2040; ++port) {
+            probe.dstPort = port;
+            engine.analyzer().analyzePacket(testpackets::tcp(probe, testpackets::TCP_SYN, {}), "com.example");
+        }
+
+        const PacketAnalysisResult next = engine.analyzer().analyzePacket(streamPacket(ends, seq), "com.example");
+        EXPECT_FALSE(isFastPath(next));
+        EXPECT_GE(next.riskScore, 0.88);
+        EXPECT_NE(next.json.find("port scan"), std::string::npos);
+    }
+
+    TEST(PacketAnalyzerFastPath, SignatureInAnEstablishedFlowIsDetected) {
+        NetGuardEngine engine{EngineConfig{}};
+        loadSignatures(engine);
+        const Endpoints ends;
+        uint32_t seq = 1000;
+        PacketAnalysisResult last;
+        for (int i = 0; i < 16; ++i, seq += 400) {
+            last = engine.analyzer().analyzePacket(streamPacket(ends, seq), "com.example");
+        }
+        ASSERT_TRUE(isFastPath(last));
+
+        std::vector<uint8_t> payload(400, 'a');
+        std::copy_n("EVILPATTERN", 11, payload.begin() + 100);
+        const PacketAnalysisResult hit = engine.analyzer().analyzePacket(
+                testpackets::tcp(ends, testpackets::TCP_ACK | testpackets::TCP_PSH, payload, seq), "com.example");
+        EXPECT_FALSE(isFastPath(hit));
+        EXPECT_TRUE(hasSignature(hit, 7));
+    }
+
+    TEST(PacketAnalyzerFastPath, SignatureSplitAcrossCachedPacketsIsDetected) {
+        NetGuardEngine engine{EngineConfig{}};
+        loadSignatures(engine);
+        const Endpoints ends;
+        uint32_t seq = 1000;
+        for (int i = 0; i < 16; ++i, seq += 400) {
+            engine.analyzer().analyzePacket(streamPacket(ends, seq), "com.example");
+        }
+
+        std::vector<uint8_t> head(400, 'a');
+        std::copy_n("EVIL", 4, head.end() - 4);
+        const PacketAnalysisResult first = engine.analyzer().analyzePacket(
+                testpackets::tcp(ends, testpackets::TCP_ACK | testpackets::TCP_PSH, head, seq), "com.example");
+        EXPECT_TRUE(isFastPath(first));
+        EXPECT_FALSE(hasSignature(first, 7));
+
+        std::vector<uint8_t> tail(400, 'a');
+        std::copy_n("PATTERN", 7, tail.begin());
+        const PacketAnalysisResult second = engine.analyzer().analyzePacket(
+                testpackets::tcp(ends, testpackets::TCP_ACK | testpackets::TCP_PSH, tail, seq + 400), "com.example");
+        EXPECT_FALSE(isFastPath(second));
+        EXPECT_TRUE(hasSignature(second, 7));
+    }
+
+} // namespace
\ No newline at end of file
@@ -0,0 +1,170 @@
+// Scanner results against a brute-force reference. This file is built twice: into
+// netguard_native_tests with the SIMD prefilter of the target (SSSE3 or NEON) and
+// into signature_scalar_tests with NETGUARD_SCALAR_PREFILTER, so both prefilter
+// paths are held to the same answers.
+
+#include "SignatureScanner.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <set>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    // Small alphabet with both nibbles varying, so random payloads hit the
+    // patterns often and the prefilter's nibble tables are fully exercised.
+    const std::string ALPHABET = {'a', 'b', 'c', 'd', 'K', 'Q', '0', '7', '\x00', '\x0f', '\x80', '\x9c',
+                                  '\xe1', '\xff', ' ', '/'};
+
+    std::string escape(const std::string& pattern) {
+        static const char HEX[] = "0123456789abcdef";
+        std::string out;
+        for (unsigned char c : pattern) {
+            if (c == '\\') {
+                out += "\\\\";
+            } else if (c < 0x21 || c > 0x7e) {
+                out += "\\x";
+                out += HEX[c >> 4];
+                out += HEX[c & 0xF];
+            } else {
+                out += static_cast<char>(c);
+            }
+        }
+        return out;
+    }
+
+    class SignatureMatchTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            std::mt19937 random(7);
+            std::set<std::string> unique;
+            unique.insert("EVILPATTERN");
+            unique.insert(std::string(1, '\x9c'));   // single-byte pattern
+            while (unique.size() < 48) {
+                std::uniform_int_distribution<size_t> length(3, 9);
+                std::string pattern;
+                for (size_t n = length(random); n > 0; --n) pattern += ALPHABET[random() % ALPHABET.size()];
+                unique.insert(pattern);
+            }
+            patterns.assign(unique.begin(), unique.end());
+
+            path = ::testing::TempDir() + "match_signatures_" + std::to_string(::getpid()) + ".txt";
+            std::ofstream out(path);
+            for (size_t i = 0; i < patterns.size(); ++i) {
+                out << (i + 1) << "\t0.5\tTest." << i << '\t' << escape(patterns[i]) << '\n';
+            }
+            out.close();
+            ASSERT_EQ(scanner.loadDatabase(path), static_cast<int>(patterns.size()));
+        }
+
+        void TearDown() override { std::remove(path.c_str()); }
+
+        // Ids of the patterns with an occurrence ending inside [from, to) of `stream`.
+        std::set<uint32_t> expected(const std::string& stream, size_t from, size_t to) const {
+            std::set<uint32_t> ids;
+            for (size_t i = 0; i < patterns.size(); ++i) {
+                const std::string& pattern = patterns[i];
+                for (size_t at = stream.find(pattern); at != std::string::npos; at = stream.find(pattern, at + 1)) {
+                    const size_t end = at + pattern.size();
+                    if (end > from && end <= to) {
+                        ids.insert(static_cast<uint32_t>(i + 1));
+                        break;
+                    }
+                }
+            }
+            return ids;
+        }
+
+        std::set<uint32_t> scan(uint64_t flow, const std::string& payload) {
+            signatures::ScanResult result;
+            scanner.scanFlow(flow, reinterpret_cast<const uint8_t*>(payload.data()), payload.size(), result);
+            std::set<uint32_t> ids;
+            for (size_t i = 0; i < result.count; ++i) ids.insert(result.matches[i]->id);
+            return ids;
+        }
+
+        std::string randomPayload(std::mt19937& random, size_t length) const {
+            std::string payload;
+            for (size_t n = 0; n < length; ++n) payload += ALPHABET[random() % ALPHABET.size()];
+            return payload;
+        }
+
+        std::vector<std::string> patterns;
+        std::string path;
+        signatures::Scanner scanner;
+    };
+
+    TEST_F(SignatureMatchTest, SinglePayloadsAgreeWithTheReference) {
+        std::mt19937 random(11);
+        size_t compared = 0;
+        for (uint64_t flow = 1; flow <= 3000; ++flow) {
+            // Lengths around the 16-byte SIMD block and its 17-byte lookahead.
+            std::string payload = randomPayload(random, random() % 70);
+            if (flow % 3 == 0 && !payload.empty()) {
+                const std::string& planted = patterns[random() % patterns.size()];
+                payload.insert(random() % (payload.size() + 1), planted);
+            }
+            const std::set<uint32_t> want = expected(payload, 0, payload.size());
+            if (want.size() > signatures::MAX_MATCHES_PER_SCAN) continue;
+            ASSERT_EQ(scan(flow, payload), want) << "payload of " << payload.size() << " bytes, flow " << flow;
+            ++compared;
+        }
+        EXPECT_GT(compared, 2500u);
+    }
+
+    TEST_F(SignatureMatchTest, PlantedMatchIsFoundAtEveryOffset) {
+        std::mt19937 random(13);
+        const std::string filler = std::string(80, '-');   // '-' is not in any pattern
+        for (size_t offset = 0; offset + 11 <= filler.size(); ++offset) {
+            std::string payload = filler;
+            payload.replace(offset, 11, "EVILPATTERN");
+            const std::set<uint32_t> ids = scan(1000 + offset, payload);
+            ASSERT_EQ(ids, expected(payload, 0, payload.size())) << "offset " << offset;
+            ASSERT_FALSE(ids.empty());
+        }
+    }
+
+    TEST_F(SignatureMatchTest, MatchesSpanningPacketsAreReportedOnTheLastOne) {
+        const std::string stream = "GET /EVILPATTERN HTTP/1.1";
+        const size_t start = stream.find("EVILPATTERN");
+        for (size_t cut = start + 1; cut < start + 11; ++cut) {
+            const uint64_t flow = 5000 + cut;
+            EXPECT_TRUE(scan(flow, stream.substr(0, cut)).empty()) << "cut " << cut;
+            EXPECT_EQ(scan(flow, stream.substr(cut)), expected(stream, cut, stream.size())) << "cut " << cut;
+        }
+        // One byte per packet; "TT" repeats a payload back to back without being
+        // a retransmission.
+        std::set<uint32_t> seen;
+        for (size_t i = 0; i < stream.size(); ++i) {
+            const std::set<uint32_t> ids = scan(9000, stream.substr(i, 1));
+            EXPECT_EQ(ids, expected(stream, i, i + 1)) << "byte " << i;
+            seen.insert(ids.begin(), ids.end());
+        }
+        EXPECT_FALSE(seen.empty());
+    }
+
+    TEST_F(SignatureMatchTest, RandomStreamsAgreeWithTheReferencePacketByPacket) {
+        std::mt19937 random(17);
+        for (uint64_t flow = 1; flow <= 20; ++flow) {
+            const std::string stream = randomPayload(random, 3000);
+            size_t from = 0;
+            while (from < stream.size()) {
+                const size_t to = std::min(stream.size(), from + 1 + random() % 48);
+                const std::set<uint32_t> want = expected(stream, from, to);
+                const std::set<uint32_t> got = scan(flow, stream.substr(from, to - from));
+                if (want.size() <= signatures::MAX_MATCHES_PER_SCAN) {
+                    ASSERT_EQ(got, want) << "flow " << flow << " bytes [" << from << ", " << to << ")";
+                }
+                from = to;
+            }
+        }
+    }
+
+} // namespace
\ No newline at end of file
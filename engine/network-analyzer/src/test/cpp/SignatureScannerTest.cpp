@@ -0,0 +1,73 @@
+#include "SignatureScanner.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+    constexpr uint64_t FLOW = 0x1234;
+
+    class SignatureScannerTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            path = ::testing::TempDir() + "signatures_" + std::to_string(::getpid()) + ".txt";
+            std::ofstream out(path);
+            out << "# id\tseverity\tname\tpattern\n";
+            out << "1\t0.9\tTest.Evil\tEVILPATTERN\n";
+            out.close();
+            ASSERT_EQ(scanner.loadDatabase(path), 1);
+        }
+
+        void TearDown() override { std::remove(path.c_str()); }
+
+        size_t scan(uint64_t flow, const std::string& payload, int64_t sequence = signatures::NO_SEQUENCE) {
+            signatures::ScanResult result;
+            scanner.scanFlow(flow, reinterpret_cast<const uint8_t*>(payload.data()), payload.size(), result,
+                             sequence);
+            return result.count;
+        }
+
+        std::string path;
+        signatures::Scanner scanner;
+    };
+
+    TEST_F(SignatureScannerTest, SkippedPayloadBreaksTheCarriedState) {
+        EXPECT_EQ(scan(FLOW, "xxxxEVIL"), 0u);
+        scanner.skipFlow(FLOW);
+        // The bytes in between were never scanned; "PATTERN" must not complete "EVIL".
+        EXPECT_EQ(scan(FLOW, "PATTERNxx"), 0u);
+        EXPECT_EQ(scan(FLOW, "EVILPATTERN"), 1u);
+    }
+
+    TEST_F(SignatureScannerTest, SkipLeavesOtherFlowsAlone) {
+        const uint64_t other = FLOW + signatures::FLOW_SLOTS + 1;
+        EXPECT_EQ(scan(other, "xxEVIL"), 0u);
+        scanner.skipFlow(FLOW);
+        EXPECT_EQ(scan(other, "PATTERN"), 1u);
+    }
+
+    TEST_F(SignatureScannerTest, RetransmittedSegmentIsRescannedFromItsStart) {
+        // Carried across itself, the segment's "EVIL" tail would complete its own
+        // "PATTERN" head.
+        const std::string segment = "PATTERN" + std::string(60, '-') + "EVIL";
+        EXPECT_EQ(scan(FLOW, segment, 1000), 0u);
+        EXPECT_EQ(scan(FLOW, segment, 1000), 0u);
+        EXPECT_EQ(scan(FLOW, "PATTERN", 1000 + static_cast<int64_t>(segment.size())), 1u);
+    }
+
+    TEST_F(SignatureScannerTest, NewSegmentWithTheSamePrefixKeepsTheCarriedState) {
+        // Same length and same first 64 bytes as the previous segment, but new data.
+        const std::string first = "PATTERN" + std::string(60, '-') + "EVIL";
+        const std::string second = "PATTERN" + std::string(60, '-') + "xxxx";
+        EXPECT_EQ(scan(FLOW, first, 1000), 0u);
+        EXPECT_EQ(scan(FLOW, second, 1000 + static_cast<int64_t>(first.size())), 1u);
+        // A differing payload under a reused sequence number is not a retransmission either.
+        EXPECT_EQ(scan(FLOW + 1, first, 5000), 0u);
+        EXPECT_EQ(scan(FLOW + 1, second, 5000), 1u);
+    }
+
+} // namespace
\ No newline at end of file
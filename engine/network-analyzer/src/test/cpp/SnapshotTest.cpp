@@ -0,0 +1,203 @@
+#include "EngineSnapshot.hpp"
+#include "NetGuardEngine.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    constexpr const char* BLOCKED_PACKAGE = "com.example.blocked";
+
+    std::string snapshotPath() {
+        return ::testing::TempDir() + "engine_" + std::to_string(::getpid()) + ".snapshot";
+    }
+
+    SessionRecord session(const std::string& key) {
+        SessionRecord record;
+        record.key = key;
+        record.count = 3;
+        record.smallPayloadCount = 1;
+        return record;
+    }
+
+    uint32_t referenceCrc32(const uint8_t* data, size_t length) {
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < length; ++i) {
+            crc ^= data[i];
+            for (int k = 0; k < 8; ++k) {
+                crc = (crc & 1u) ? (0xEDB88320u ^ (crc >> 1)) : (crc >> 1);
+            }
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    template <typename T>
+    void append(std::vector<uint8_t>& out, const T& value) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    // Appends the RULES section older builds wrote (type 2: count, then each
+    // name as a length and 8-byte padded bytes) and fixes up the file header.
+    void appendLegacyRules(const std::string& path, const std::vector<std::string>& names) {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+
+        std::vector<uint8_t> body;
+        append(body, static_cast<uint64_t>(names.size()));
+        for (const auto& name : names) {
+            append(body, static_cast<uint64_t>(name.size()));
+            body.insert(body.end(), name.begin(), name.end());
+            body.resize((body.size() + 7u) & ~static_cast<size_t>(7u), 0);
+        }
+        append(file, static_cast<uint32_t>(2));
+        append(file, static_cast<uint32_t>(0));
+        append(file, static_cast<uint64_t>(body.size()));
+        file.insert(file.end(), body.begin(), body.end());
+
+        // Header: magic u32, version u16, headerSize u16, sectionCount u32, crc32 u32, payloadLength u64.
+        uint32_t sections = 0;
+        std::memcpy(&sections, file.data() + 8, sizeof(sections));
+        sections++;
+        std::memcpy(file.data() + 8, &sections, sizeof(sections));
+        const uint64_t payloadLength = file.size() - 32;
+        std::memcpy(file.data() + 16, &payloadLength, sizeof(payloadLength));
+        const uint32_t crc = referenceCrc32(file.data() + 32, static_cast<size_t>(payloadLength));
+        std::memcpy(file.data() + 12, &crc, sizeof(crc));
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+    }
+
+    // Bumps the layout version at the start of the BEHAVIOR section (type 3) as a
+    // build with a different sketch layout would have written it, keeping the
+    // checksum valid.
+    void bumpBehaviorLayout(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+
+        // Sections: type u32, reserved u32, length u64, then the body padded to 8 bytes.
+        size_t offset = 32;
+        while (offset + 16 <= file.size()) {
+            uint32_t type = 0;
+            uint64_t length = 0;
+            std::memcpy(&type, file.data() + offset, sizeof(type));
+            std::memcpy(&length, file.data() + offset + 8, sizeof(length));
+            if (type == 3) {
+                uint32_t layout = 0;
+                std::memcpy(&layout, file.data() + offset + 16, sizeof(layout));
+                layout++;
+                std::memcpy(file.data() + offset + 16, &layout, sizeof(layout));
+                break;
+            }
+            offset += 16 + ((static_cast<size_t>(length) + 7u) & ~static_cast<size_t>(7u));
+        }
+        const uint32_t crc = referenceCrc32(file.data() + 32, file.size() - 32);
+        std::memcpy(file.data() + 12, &crc, sizeof(crc));
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+    }
+
+    TEST(EngineSnapshot, FirewallRulesAreNotCarriedAcrossRestarts) {
+        const std::string path = snapshotPath();
+        {
+            NetGuardEngine source{EngineConfig{}};
+            source.rules().setRule(BLOCKED_PACKAGE, false);
+            source.analyzer().restoreSessions({session("10.0.0.2->1.1.1.1:443")}, 0);
+            ASSERT_TRUE(snapshot::save(source, path));
+        }
+
+        // The rule was lifted in the app's store while the engine was down.
+        NetGuardEngine restored{EngineConfig{}};
+        snapshot::RestoreStats stats;
+        ASSERT_EQ(snapshot::restore(restored, path, stats), snapshot::RestoreStatus::Restored);
+        ::unlink(path.c_str());
+
+        EXPECT_TRUE(restored.rules().isAllowed(BLOCKED_PACKAGE));
+        EXPECT_TRUE(restored.rules().blockedPackages().empty());
+        EXPECT_EQ(stats.sessions, 1u);
+        EXPECT_TRUE(stats.behavior);
+    }
+
+    TEST(EngineSnapshot, RulesSectionFromOlderBuildsIsIgnored) {
+        const std::string path = snapshotPath();
+        {
+            NetGuardEngine source{EngineConfig{}};
+            source.analyzer().restoreSessions({session("10.0.0.2->1.1.1.1:443"), session("10.0.0.2->8.8.8.8:53")}, 0);
+            ASSERT_TRUE(snapshot::save(source, path));
+        }
+        appendLegacyRules(path, {BLOCKED_PACKAGE, "com.example.other"});
+
+        NetGuardEngine restored{EngineConfig{}};
+        snapshot::RestoreStats stats;
+        ASSERT_EQ(snapshot::restore(restored, path, stats), snapshot::RestoreStatus::Restored);
+        ::unlink(path.c_str());
+
+        EXPECT_EQ(stats.sessions, 2u);
+        EXPECT_TRUE(restored.rules().isAllowed(BLOCKED_PACKAGE));
+        EXPECT_TRUE(restored.rules().isAllowed("com.example.other"));
+    }
+
+    TEST(EngineSnapshot, BehaviorStateFromAnotherLayoutIsSkipped) {
+        const std::string path = snapshotPath();
+        {
+            NetGuardEngine source{EngineConfig{}};
+            source.analyzer().restoreSessions({session("10.0.0.2->1.1.1.1:443")}, 0);
+            ASSERT_TRUE(snapshot::save(source, path));
+        }
+        bumpBehaviorLayout(path);
+
+        NetGuardEngine restored{EngineConfig{}};
+        snapshot::RestoreStats stats;
+        ASSERT_EQ(snapshot::restore(restored, path, stats), snapshot::RestoreStatus::Restored);
+        ::unlink(path.c_str());
+
+        EXPECT_EQ(stats.sessions, 1u);
+        EXPECT_FALSE(stats.behavior);
+    }
+
+    TEST(EngineSnapshot, CorruptionIsDetectedByTheChecksum) {
+        const std::string path = snapshotPath();
+        {
+            NetGuardEngine source{EngineConfig{}};
+            source.analyzer().restoreSessions({session("10.0.0.2->1.1.1.1:443")}, 0);
+            ASSERT_TRUE(snapshot::save(source, path));
+        }
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(40);
+            file.put('\x7f');
+        }
+
+        NetGuardEngine restored{EngineConfig{}};
+        snapshot::RestoreStats stats;
+        EXPECT_EQ(snapshot::restore(restored, path, stats), snapshot::RestoreStatus::Corrupt);
+        ::unlink(path.c_str());
+        EXPECT_TRUE(restored.analyzer().exportSessions().empty());
+    }
+
+    TEST(FirewallRules, ReplaceBlockedDropsRulesMissingFromTheNewSet) {
+        firewall::RuleSet rules;
+        rules.setRule("com.example.a", false);
+        rules.setRule("com.example.b", false);
+        const uint64_t generation = rules.generation();
+
+        rules.replaceBlocked({"com.example.b", "com.example.c"});
+
+        EXPECT_TRUE(rules.isAllowed("com.example.a"));
+        EXPECT_FALSE(rules.isAllowed("com.example.b"));
+        EXPECT_FALSE(rules.isAllowed("com.example.c"));
+        EXPECT_GT(rules.generation(), generation);
+    }
+
+} // namespace
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "TlsInspector.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+    // ClientHello for the JA3 README example (TLS 1.0, SNI, groups, point formats):
+    //     769,47-53-5-10-49161-49162-49171-49172-50-56-19-4,0-10-11,23-24-25,0
+    const std::vector<uint8_t> JA3_README_HELLO = {
+            0x16, 0x03, 0x01, 0x00, 0x6b, 0x01, 0x00, 0x00, 0x67, 0x03, 0x01, 0x00, 0x01, 0x02, 0x03, 0x04,
+            0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14,
+            0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x00, 0x00, 0x18, 0x00, 0x2f,
+            0x00, 0x35, 0x00, 0x05, 0x00, 0x0a, 0xc0, 0x09, 0xc0, 0x0a, 0xc0, 0x13, 0xc0, 0x14, 0x00, 0x32,
+            0x00, 0x38, 0x00, 0x13, 0x00, 0x04, 0x01, 0x00, 0x00, 0x26, 0x00, 0x00, 0x00, 0x10, 0x00, 0x0e,
+            0x00, 0x00, 0x0b, 0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x2e, 0x63, 0x6f, 0x6d, 0x00, 0x0a,
+            0x00, 0x08, 0x00, 0x06, 0x00, 0x17, 0x00, 0x18, 0x00, 0x19, 0x00, 0x0b, 0x00, 0x02, 0x01, 0x00,
+    };
+
+    // Chrome-style TLS 1.3 ClientHello with GREASE in the ciphers, extensions,
+    // groups, supported_versions and key_share. Cipher suites, extensions and
+    // signature algorithms are those of the JA4 README example, whose raw form is
+    //     t13d1516h2_002f,0035,009c,009d,1301,1302,1303,c013,c014,c02b,c02c,c02f,c030,cca8,cca9_
+    //     0005,000a,000b,000d,0012,0015,0017,001b,0023,002b,002d,0033,4469,ff01_
+    //     0403,0804,0401,0503,0805,0501,0806,0601
+    const std::vector<uint8_t> CHROME_HELLO = {
+            0x16, 0x03, 0x01, 0x01, 0x28, 0x01, 0x00, 0x01, 0x24, 0x03, 0x03, 0x00, 0x01, 0x02, 0x03, 0x04,
+            0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14,
+            0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x00, 0x00, 0x20, 0x0a, 0x0a,
+            0x13, 0x01, 0x13, 0x02, 0x13, 0x03, 0xc0, 0x2b, 0xc0, 0x2f, 0xc0, 0x2c, 0xc0, 0x30, 0xcc, 0xa9,
+            0xcc, 0xa8, 0xc0, 0x13, 0xc0, 0x14, 0x00, 0x9c, 0x00, 0x9d, 0x00, 0x2f, 0x00, 0x35, 0x01, 0x00,
+            0x00, 0xdb, 0x1a, 0x1a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x14, 0x00, 0x12, 0x00, 0x00, 0x0f, 0x77,
+            0x77, 0x77, 0x2e, 0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x2e, 0x63, 0x6f, 0x6d, 0x00, 0x17,
+            0x00, 0x00, 0xff, 0x01, 0x00, 0x01, 0x00, 0x00, 0x0a, 0x00, 0x0a, 0x00, 0x08, 0x3a, 0x3a, 0x00,
+            0x1d, 0x00, 0x17, 0x00, 0x18, 0x00, 0x0b, 0x00, 0x02, 0x01, 0x00, 0x00, 0x23, 0x00, 0x00, 0x00,
+            0x10, 0x00, 0x0e, 0x00, 0x0c, 0x02, 0x68, 0x32, 0x08, 0x68, 0x74, 0x74, 0x70, 0x2f, 0x31, 0x2e,
+            0x31, 0x00, 0x05, 0x00, 0x05, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0d, 0x00, 0x12, 0x00, 0x10,
+            0x04, 0x03, 0x08, 0x04, 0x04, 0x01, 0x05, 0x03, 0x08, 0x05, 0x05, 0x01, 0x08, 0x06, 0x06, 0x01,
+            0x00, 0x12, 0x00, 0x00, 0x00, 0x33, 0x00, 0x2b, 0x00, 0x29, 0x3a, 0x3a, 0x00, 0x01, 0x00, 0x00,
+            0x1d, 0x00, 0x20, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c,
+            0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c,
+            0x1d, 0x1e, 0x1f, 0x00, 0x2d, 0x00, 0x02, 0x01, 0x01, 0x00, 0x2b, 0x00, 0x07, 0x06, 0x4a, 0x4a,
+            0x03, 0x04, 0x03, 0x03, 0x00, 0x1b, 0x00, 0x03, 0x02, 0x00, 0x02, 0x44, 0x69, 0x00, 0x05, 0x00,
+            0x03, 0x02, 0x68, 0x32, 0x2a, 0x2a, 0x00, 0x01, 0x00, 0x00, 0x15, 0x00, 0x10, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+
+    // CHROME_HELLO with every GREASE value removed.
+    const std::vector<uint8_t> CHROME_HELLO_NO_GREASE = {
+            0x16, 0x03, 0x01, 0x01, 0x14, 0x01, 0x00, 0x01, 0x10, 0x03, 0x03, 0x00, 0x01, 0x02, 0x03, 0x04,
+            0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14,
+            0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x00, 0x00, 0x1e, 0x13, 0x01,
+            0x13, 0x02, 0x13, 0x03, 0xc0, 0x2b, 0xc0, 0x2f, 0xc0, 0x2c, 0xc0, 0x30, 0xcc, 0xa9, 0xcc, 0xa8,
+            0xc0, 0x13, 0xc0, 0x14, 0x00, 0x9c, 0x00, 0x9d, 0x00, 0x2f, 0x00, 0x35, 0x01, 0x00, 0x00, 0xc9,
+            0x00, 0x00, 0x00, 0x14, 0x00, 0x12, 0x00, 0x00, 0x0f, 0x77, 0x77, 0x77, 0x2e, 0x65, 0x78, 0x61,
+            0x6d, 0x70, 0x6c, 0x65, 0x2e, 0x63, 0x6f, 0x6d, 0x00, 0x17, 0x00, 0x00, 0xff, 0x01, 0x00, 0x01,
+            0x00, 0x00, 0x0a, 0x00, 0x08, 0x00, 0x06, 0x00, 0x1d, 0x00, 0x17, 0x00, 0x18, 0x00, 0x0b, 0x00,
+            0x02, 0x01, 0x00, 0x00, 0x23, 0x00, 0x00, 0x00, 0x10, 0x00, 0x0e, 0x00, 0x0c, 0x02, 0x68, 0x32,
+            0x08, 0x68, 0x74, 0x74, 0x70, 0x2f, 0x31, 0x2e, 0x31, 0x00, 0x05, 0x00, 0x05, 0x01, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x0d, 0x00, 0x12, 0x00, 0x10, 0x04, 0x03, 0x08, 0x04, 0x04, 0x01, 0x05, 0x03,
+            0x08, 0x05, 0x05, 0x01, 0x08, 0x06, 0x06, 0x01, 0x00, 0x12, 0x00, 0x00, 0x00, 0x33, 0x00, 0x26,
+            0x00, 0x24, 0x00, 0x1d, 0x00, 0x20, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+            0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
+            0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x00, 0x2d, 0x00, 0x02, 0x01, 0x01, 0x00, 0x2b, 0x00, 0x05,
+            0x04, 0x03, 0x04, 0x03, 0x03, 0x00, 0x1b, 0x00, 0x03, 0x02, 0x00, 0x02, 0x44, 0x69, 0x00, 0x05,
+            0x00, 0x03, 0x02, 0x68, 0x32, 0x00, 0x15, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+
+    constexpr const char* JA3_README_HASH = "ada70206e40642a3e4461f35503241d5";
+    constexpr const char* JA4_README = "t13d1516h2_8daaf6152771_e5627efa2ab1";
+    // MD5 of 771,4865-4866-4867-49195-49199-49196-49200-52393-52392-49171-49172-156-157-47-53,
+    //        0-23-65281-10-11-35-16-5-13-18-51-45-43-27-17513-21,29-23-24,0
+    constexpr const char* CHROME_JA3 = "cd08e31494f9531f560d64c695473da9";
+
+    constexpr uint64_t FLOW = 0xfeed;
+    constexpr uint32_t SEQ = 100000;
+
+    std::string text(const char* value) { return std::string(value); }
+
+    void addToLength(std::vector<uint8_t>& bytes, size_t offset, size_t width, size_t delta) {
+        size_t value = 0;
+        for (size_t i = 0; i < width; ++i) value = value << 8 | bytes[offset + i];
+        value += delta;
+        for (size_t i = width; i-- > 0; value >>= 8) bytes[offset + i] = static_cast<uint8_t>(value);
+    }
+
+    // CHROME_HELLO_NO_GREASE with its ALPN list ("h2", "http/1.1") replaced by one
+    // protocol; the record, handshake and extensions lengths are adjusted to match.
+    std::vector<uint8_t> helloWithAlpn(const std::string& protocol) {
+        std::vector<uint8_t> hello = CHROME_HELLO_NO_GREASE;
+        const uint8_t alpnHeader[] = {0x00, 0x10, 0x00, 0x0e, 0x00, 0x0c};
+        const auto at = std::search(hello.begin(), hello.end(), std::begin(alpnHeader), std::end(alpnHeader));
+        const size_t oldSize = sizeof(alpnHeader) + 0x0c;
+
+        std::vector<uint8_t> alpn = {0x00, 0x10, 0x00, static_cast<uint8_t>(protocol.size() + 3),
+                                     0x00, static_cast<uint8_t>(protocol.size() + 1),
+                                     static_cast<uint8_t>(protocol.size())};
+        alpn.insert(alpn.end(), protocol.begin(), protocol.end());
+        hello.insert(hello.erase(at, at + oldSize), alpn.begin(), alpn.end());
+
+        const size_t delta = alpn.size() - oldSize;
+        size_t extensionsLength = 43;                              // session id length
+        extensionsLength += 1 + hello[extensionsLength];
+        extensionsLength += 2 + (hello[extensionsLength] << 8 | hello[extensionsLength + 1]);
+        extensionsLength += 1 + hello[extensionsLength];          // compression methods
+        addToLength(hello, 3, 2, delta);
+        addToLength(hello, 6, 3, delta);
+        addToLength(hello, extensionsLength, 2, delta);
+        return hello;
+    }
+
+    TEST(TlsFingerprint, Ja3MatchesThePublishedExample) {
+        tls::ClientHelloInfo info;
+        ASSERT_EQ(tls::parseClientHello(JA3_README_HELLO.data(), JA3_README_HELLO.size(), info),
+                  tls::ParseStatus::Complete);
+        EXPECT_EQ(info.helloVersion, 0x0301);
+        EXPECT_EQ(text(info.sni.data()), "example.com");
+        EXPECT_EQ(text(info.ja3.data()), JA3_README_HASH);
+    }
+
+    TEST(TlsFingerprint, Ja4MatchesThePublishedExample) {
+        tls::ClientHelloInfo info;
+        ASSERT_EQ(tls::parseClientHello(CHROME_HELLO.data(), CHROME_HELLO.size(), info),
+                  tls::ParseStatus::Complete);
+        EXPECT_EQ(info.negotiatedVersion, 0x0304);
+        EXPECT_EQ(text(info.sni.data()), "www.example.com");
+        EXPECT_EQ(text(info.alpn.data()), "h2");
+        EXPECT_EQ(text(info.ja4.data()), JA4_README);
+        EXPECT_EQ(text(info.ja3.data()), CHROME_JA3);
+    }
+
+    TEST(TlsFingerprint, GreaseValuesDoNotChangeTheFingerprints) {
+        tls::ClientHelloInfo withGrease;
+        tls::ClientHelloInfo withoutGrease;
+        ASSERT_EQ(tls::parseClientHello(CHROME_HELLO.data(), CHROME_HELLO.size(), withGrease),
+                  tls::ParseStatus::Complete);
+        ASSERT_EQ(tls::parseClientHello(CHROME_HELLO_NO_GREASE.data(), CHROME_HELLO_NO_GREASE.size(), withoutGrease),
+                  tls::ParseStatus::Complete);
+
+        // The GREASE entries are still parsed, only left out of the fingerprints.
+        EXPECT_EQ(withGrease.cipherCount, withoutGrease.cipherCount + 1);
+        EXPECT_EQ(withGrease.extensionCount, withoutGrease.extensionCount + 2);
+        EXPECT_EQ(withGrease.negotiatedVersion, 0x0304);
+        EXPECT_EQ(text(withGrease.ja3.data()), text(withoutGrease.ja3.data()));
+        EXPECT_EQ(text(withGrease.ja4.data()), text(withoutGrease.ja4.data()));
+    }
+
+    TEST(TlsFingerprint, Ja4UsesTheLastCharacterOfALongAlpn) {
+        const std::string protocol = "a-protocol-name-longer-than-the-display-copy-Z";
+        ASSERT_GT(protocol.size(), tls::MAX_ALPN_LENGTH);
+        const std::vector<uint8_t> hello = helloWithAlpn(protocol);
+        tls::ClientHelloInfo info;
+        ASSERT_EQ(tls::parseClientHello(hello.data(), hello.size(), info), tls::ParseStatus::Complete);
+
+        EXPECT_EQ(text(info.alpn.data()), protocol.substr(0, tls::MAX_ALPN_LENGTH));
+        const std::string ja4 = text(info.ja4.data());
+        EXPECT_EQ(ja4.substr(0, 10), "t13d1516aZ");
+        EXPECT_EQ(ja4.substr(10), std::string(JA4_README).substr(10));
+    }
+
+    TEST(TlsFingerprint, TruncatedRecordIsIncompleteNotMalformed) {
+        tls::ClientHelloInfo info;
+        EXPECT_EQ(tls::parseClientHello(CHROME_HELLO.data(), CHROME_HELLO.size() - 1, info),
+                  tls::ParseStatus::Incomplete);
+        const uint8_t http[] = {'G', 'E', 'T', ' ', '/', ' ', 'H', 'T', 'T', 'P'};
+        EXPECT_EQ(tls::parseClientHello(http, sizeof(http), info), tls::ParseStatus::NotClientHello);
+    }
+
+    TEST(TlsReassembly, ClientHelloSplitAcrossSegments) {
+        // Record header alone, then the handshake cut mid-extension.
+        const std::vector<size_t> cuts = {5, 120, CHROME_HELLO.size()};
+        tls::Reassembler reassembler;
+        tls::ClientHelloInfo info;
+        size_t offset = 0;
+        for (size_t i = 0; i < cuts.size(); ++i) {
+            const tls::ParseStatus status = reassembler.inspectSegment(
+                    FLOW, SEQ + static_cast<uint32_t>(offset), CHROME_HELLO.data() + offset, cuts[i] - offset, info);
+            if (i + 1 < cuts.size()) {
+                ASSERT_EQ(status, tls::ParseStatus::Incomplete) << "segment " << i;
+                // A retransmission of the segment just fed changes nothing.
+                ASSERT_EQ(reassembler.inspectSegment(FLOW, SEQ + static_cast<uint32_t>(offset),
+                                                     CHROME_HELLO.data() + offset, cuts[i] - offset, info),
+                          tls::ParseStatus::Incomplete);
+            } else {
+                ASSERT_EQ(status, tls::ParseStatus::Complete);
+            }
+            offset = cuts[i];
+        }
+        EXPECT_TRUE(info.reassembled);
+        EXPECT_EQ(text(info.sni.data()), "www.example.com");
+        EXPECT_EQ(text(info.ja4.data()), JA4_README);
+    }
+
+    TEST(TlsReassembly, InterleavedFlowsKeepSeparateBuffers) {
+        tls::Reassembler reassembler;
+        tls::ClientHelloInfo first;
+        tls::ClientHelloInfo second;
+        const size_t cut = 64;
+        ASSERT_EQ(reassembler.inspectSegment(FLOW, SEQ, CHROME_HELLO.data(), cut, first),
+                  tls::ParseStatus::Incomplete);
+        ASSERT_EQ(reassembler.inspectSegment(FLOW + 1, SEQ, JA3_README_HELLO.data(), cut, second),
+                  tls::ParseStatus::Incomplete);
+        ASSERT_EQ(reassembler.inspectSegment(FLOW + 1, SEQ + cut, JA3_README_HELLO.data() + cut,
+                                             JA3_README_HELLO.size() - cut, second),
+                  tls::ParseStatus::Complete);
+        ASSERT_EQ(reassembler.inspectSegment(FLOW, SEQ + cut, CHROME_HELLO.data() + cut,
+                                             CHROME_HELLO.size() - cut, first),
+                  tls::ParseStatus::Complete);
+        EXPECT_EQ(text(first.ja4.data()), JA4_README);
+        EXPECT_EQ(text(second.ja3.data()), JA3_README_HASH);
+    }
+
+} // namespace
\ No newline at end of file
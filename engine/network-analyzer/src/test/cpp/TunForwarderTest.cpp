@@ -0,0 +1,151 @@
+#include "TestPackets.hpp"
+#include "TunHarness.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using testpackets::TCP_ACK;
+    using testpackets::TCP_FIN;
+    using testpackets::TCP_PSH;
+    using tunharness::Segment;
+
+    constexpr uint32_t APP_ISN = 5000;
+
+    testpackets::Endpoints towards(const tunharness::Server& server) {
+        testpackets::Endpoints ends;
+        ends.dstIp = "127.0.0.1";
+        ends.dstPort = server.port();
+        return ends;
+    }
+
+    bool waitFor(const std::atomic<uint64_t>& counter, uint64_t value, int timeoutMs) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (counter.load() != value) {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return true;
+    }
+
+    TEST(TunForwarder, RelaysTcpBothWays) {
+        tunharness::Server server;
+        tunharness::Harness harness;
+        ASSERT_TRUE(harness.start());
+        const testpackets::Endpoints ends = towards(server);
+
+        uint32_t appNext = 0;
+        uint32_t remoteNext = 0;
+        ASSERT_TRUE(harness.connect(ends, APP_ISN, appNext, remoteNext));
+        const int peer = server.accept();
+        ASSERT_GE(peer, 0);
+
+        ASSERT_TRUE(harness.send(testpackets::tcp(ends, TCP_ACK | TCP_PSH, testpackets::bytes("ping"),
+                                                  appNext, remoteNext)));
+        appNext += 4;
+        char request[4] = {};
+        ASSERT_EQ(::recv(peer, request, sizeof(request), MSG_WAITALL), 4);
+        EXPECT_EQ(std::string(request, 4), "ping");
+
+        ASSERT_EQ(::send(peer, "pong", 4, 0), 4);
+        Segment segment;
+        do {
+            ASSERT_TRUE(harness.receive(segment));
+        } while (segment.payload.empty());
+        EXPECT_EQ(segment.seq, remoteNext);
+        EXPECT_EQ(segment.ack, appNext);
+        EXPECT_EQ(std::string(segment.payload.begin(), segment.payload.end()), "pong");
+    }
+
+    // The app received everything, but its ACK was lost and its window closed, so
+    // the go-back-N rewind resends nothing. Its late ACK covers bytes above the
+    // rewound sndNxt and must still be accepted.
+    TEST(TunForwarder, AckForBytesSentBeforeARewindIsAccepted) {
+        tunharness::Server server;
+        tunharness::Harness harness;
+        ASSERT_TRUE(harness.start());
+        const testpackets::Endpoints ends = towards(server);
+
+        uint32_t appNext = 0;
+        uint32_t remoteNext = 0;
+        ASSERT_TRUE(harness.connect(ends, APP_ISN, appNext, remoteNext));
+        const int peer = server.accept();
+        ASSERT_GE(peer, 0);
+
+        const std::vector<uint8_t> data(1000, 'r');
+        ASSERT_EQ(::send(peer, data.data(), data.size(), 0), static_cast<ssize_t>(data.size()));
+        ASSERT_EQ(::shutdown(peer, SHUT_WR), 0);
+
+        size_t received = 0;
+        uint32_t finSeq = 0;
+        bool fin = false;
+        while (!fin) {
+            Segment segment;
+            ASSERT_TRUE(harness.receive(segment));
+            received += segment.payload.size();
+            if (segment.flags & TCP_FIN) {
+                finSeq = segment.seq + static_cast<uint32_t>(segment.payload.size());
+                fin = true;
+            }
+        }
+        ASSERT_EQ(received, data.size());
+        ASSERT_EQ(finSeq, remoteNext + data.size());
+
+        // Duplicate ACK closing the window, then wait out the 1 s retransmission timeout.
+        ASSERT_TRUE(harness.send(testpackets::tcp(ends, TCP_ACK, {}, appNext, remoteNext, 0)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+
+        // The late ACK for all data and the FIN, then the window reopens.
+        ASSERT_TRUE(harness.send(testpackets::tcp(ends, TCP_ACK, {}, appNext, finSeq + 1, 0)));
+        ASSERT_TRUE(harness.send(testpackets::tcp(ends, TCP_ACK, {}, appNext, finSeq + 1)));
+
+        Segment resent;
+        while (harness.receive(resent, 300)) {
+            EXPECT_TRUE(resent.payload.empty()) << "acknowledged bytes were sent again";
+            EXPECT_EQ(resent.flags & TCP_FIN, 0) << "acknowledged FIN was sent again";
+        }
+
+        // With our FIN acknowledged, the app's FIN completes a clean close.
+        ASSERT_TRUE(harness.send(testpackets::tcp(ends, TCP_ACK | TCP_FIN, {}, appNext, finSeq + 1)));
+        EXPECT_TRUE(waitFor(harness.stats().activeTcp, 0, 1000));
+        EXPECT_EQ(harness.stats().resets.load(), 0u);
+    }
+
+    // Replies the app never reads fill the interface; the forwarder is stopped
+    // with a write queue that was partly flushed before EAGAIN.
+    TEST(TunForwarder, StopsCleanlyWithABlockedWriteQueue) {
+        tunharness::Server server;
+        auto harness = std::make_unique<tunharness::Harness>();
+        ASSERT_TRUE(harness->start());
+        const testpackets::Endpoints ends = towards(server);
+
+        uint32_t appNext = 0;
+        uint32_t remoteNext = 0;
+        ASSERT_TRUE(harness->connect(ends, APP_ISN, appNext, remoteNext));
+        const int peer = server.accept();
+        ASSERT_GE(peer, 0);
+        ASSERT_TRUE(harness->limitTunBuffer(4096));
+
+        const std::vector<uint8_t> data(60000, 'd');
+        ASSERT_EQ(::send(peer, data.data(), data.size(), 0), static_cast<ssize_t>(data.size()));
+        uint64_t written = 0;
+        do {
+            written = harness->stats().tunPacketsOut.load();
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        } while (harness->stats().tunPacketsOut.load() != written);
+        EXPECT_LT(written, 2u + data.size() / 1000) << "the interface never filled up";
+
+        harness.reset();
+    }
+
+} // namespace
\ No newline at end of file
@@ -0,0 +1,65 @@
+// Per-packet latency of full analysis against the established-flow fast path.
+//
+//     fast_path_benchmark [packets]
+//
+// Replays `packets` packets spread over a fixed set of HTTPS-like flows and
+// reports latency percentiles for packets that took each path.
+
+#include "NetGuardEngine.hpp"
+#include "TestPackets.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+    constexpr int FLOWS = 16;
+
+    void report(const char* name, std::vector<double>& samples) {
+        if (samples.empty()) {
+            std::printf("%-10s no samples\n", name);
+            return;
+        }
+        std::sort(samples.begin(), samples.end());
+        double total = 0.0;
+        for (double sample : samples) total += sample;
+        auto percentile = [&samples](double p) {
+            return samples[std::min(samples.size() - 1, static_cast<size_t>(p * static_cast<double>(samples.size())))];
+        };
+        std::printf("%-10s packets=%zu mean=%.0fns p50=%.0fns p99=%.0fns\n", name, samples.size(),
+                    total / static_cast<double>(samples.size()), percentile(0.50), percentile(0.99));
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const long packets = argc > 1 ? std::max(1L, std::strtol(argv[1], nullptr, 10)) : 200000;
+
+    NetGuardEngine engine{EngineConfig{}};
+    std::vector<std::vector<uint8_t>> flows;
+    for (int i = 0; i < FLOWS; ++i) {
+        testpackets::Endpoints ends;
+        ends.srcPort = static_cast<uint16_t>(40000 + i);
+        ends.dstIp = "93.184.216." + std::to_string(10 + i);
+        flows.push_back(testpackets::tcp(ends, testpackets::TCP_ACK | testpackets::TCP_PSH,
+                                         std::vector<uint8_t>(600, 'a')));
+    }
+
+    std::vector<double> full;
+    std::vector<double> fast;
+    for (long i = 0; i < packets; ++i) {
+        const std::vector<uint8_t>& packet = flows[static_cast<size_t>(i % FLOWS)];
+        const auto started = std::chrono::steady_clock::now();
+        PacketAnalysisResult result = engine.analyzer().analyzePacket(packet.data(), packet.size(), "com.example");
+        const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+        (result.json.find("\"fastPath\":true") != std::string::npos ? fast : full).push_back(elapsed);
+    }
+
+    report("full", full);
+    report("fast path", fast);
+    return fast.empty() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
\ No newline at end of file
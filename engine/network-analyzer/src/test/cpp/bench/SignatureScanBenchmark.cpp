@@ -0,0 +1,92 @@
+// Signature scanning throughput against database size.
+//
+//     signature_scan_benchmark [megabytes] [pattern-count ...]
+//
+// Scans `megabytes` of printable, HTTP-like payload in 1400-byte packets spread
+// over 64 flows, once per database size (default 1, 10, 100, 1000 and 5000
+// random patterns), and reports MB/s. Built twice: with the target's SIMD
+// prefilter and as signature_scan_benchmark_scalar.
+
+#include "SignatureScanner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    constexpr size_t PACKET = 1400;
+    constexpr uint64_t FLOWS = 64;
+
+    const char* prefilterName() {
+#if defined(NETGUARD_SCALAR_PREFILTER)
+        return "scalar";
+#elif defined(__SSSE3__)
+        return "ssse3";
+#elif defined(__aarch64__)
+        return "neon";
+#else
+        return "scalar";
+#endif
+    }
+
+    std::string printable(std::mt19937& random, size_t length) {
+        static const std::string CHARS =
+                "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 /:=&?.-_";
+        std::string out;
+        out.reserve(length);
+        for (size_t i = 0; i < length; ++i) out += CHARS[random() % CHARS.size()];
+        return out;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const long megabytes = argc > 1 ? std::max(1L, std::strtol(argv[1], nullptr, 10)) : 64;
+    std::vector<long> counts;
+    for (int i = 2; i < argc; ++i) counts.push_back(std::max(1L, std::strtol(argv[i], nullptr, 10)));
+    if (counts.empty()) counts = {1, 10, 100, 1000, 5000};
+
+    std::mt19937 random(3);
+    std::vector<std::string> packets;
+    for (int i = 0; i < 256; ++i) packets.push_back(printable(random, PACKET));
+    const size_t total = static_cast<size_t>(megabytes) * 1024 * 1024;
+
+    const std::string path = "/tmp/signature_scan_benchmark_" + std::to_string(::getpid()) + ".txt";
+    for (long count : counts) {
+        {
+            std::ofstream out(path);
+            for (long i = 0; i < count; ++i) {
+                out << (i + 1) << "\t0.5\tBench." << i << '\t' << printable(random, 6 + random() % 11) << '\n';
+            }
+        }
+        signatures::Scanner scanner;
+        if (scanner.loadDatabase(path) != count) {
+            std::fprintf(stderr, "cannot compile %ld patterns\n", count);
+            std::remove(path.c_str());
+            return EXIT_FAILURE;
+        }
+
+        size_t scanned = 0;
+        size_t matches = 0;
+        const auto started = std::chrono::steady_clock::now();
+        for (size_t i = 0; scanned < total; ++i) {
+            const std::string& packet = packets[i % packets.size()];
+            signatures::ScanResult result;
+            scanner.scanFlow(i % FLOWS, reinterpret_cast<const uint8_t*>(packet.data()), packet.size(), result);
+            scanned += result.scannedBytes;
+            matches += result.count;
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        std::printf("%-6s patterns=%-5ld %8.1f MB/s matches=%zu\n", prefilterName(), count,
+                    static_cast<double>(scanned) / elapsed / (1024.0 * 1024.0), matches);
+    }
+    std::remove(path.c_str());
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+// Warm-start cost: time to restore an engine snapshot holding N flow sessions,
+// and the per-packet cost of analyzing traffic on the restored table.
+//
+//     snapshot_restore_benchmark [sessions] [budget-ms] [max-tracked-sessions]
+//
+// Saves a snapshot with `sessions` sessions plus the behavior sketches, then
+// restores it into fresh engines and reports the restore time. Engines use the
+// production EngineConfig (2048 tracked sessions, 10 s expiry) unless a session
+// cap is given; a restore keeps at most that many. With a budget, exits non-zero
+// when the median restore exceeds it.
+
+#include "EngineSnapshot.hpp"
+#include "NetGuardEngine.hpp"
+#include "TestPackets.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    constexpr int RUNS = 5;
+    constexpr int PROBE_PACKETS = 2000;
+
+    EngineConfig configFor(long maxTracked) {
+        EngineConfig config;
+        if (maxTracked > 0) config.maxTrackedSessions = static_cast<size_t>(maxTracked);
+        return config;
+    }
+
+    // Mean analysis time of packets on new flows, each of which touches the
+    // restored session table.
+    double probeNsPerPacket(NetGuardEngine& engine) {
+        testpackets::Endpoints ends;
+        const std::vector<uint8_t> payload(200, 'p');
+        const auto started = std::chrono::steady_clock::now();
+        for (int i = 0; i < PROBE_PACKETS; ++i) {
+            ends.srcPort = static_cast<uint16_t>(20000 + i);
+            engine.analyzer().analyzePacket(testpackets::tcp(ends, testpackets::TCP_ACK, payload), "com.example");
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count() /
+               PROBE_PACKETS;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const long sessions = argc > 1 ? std::max(1L, std::strtol(argv[1], nullptr, 10)) : 100000;
+    const double budgetMs = argc > 2 ? std::strtod(argv[2], nullptr) : 0.0;
+    const long maxTracked = argc > 3 ? std::strtol(argv[3], nullptr, 10) : 0;
+    const size_t expected = std::min(static_cast<size_t>(sessions), configFor(maxTracked).maxTrackedSessions);
+    const std::string path = "/tmp/netguard_restore_" + std::to_string(::getpid()) + ".snapshot";
+
+    {
+        // The source keeps every record so the file holds all of them.
+        NetGuardEngine source{configFor(sessions)};
+        std::vector<SessionRecord> records(static_cast<size_t>(sessions));
+        for (long i = 0; i < sessions; ++i) {
+            SessionRecord& record = records[static_cast<size_t>(i)];
+            record.key = "10.0." + std::to_string((i >> 8) & 0xFF) + '.' + std::to_string(i & 0xFF) +
+                         "->93.184." + std::to_string((i >> 16) & 0xFF) + ".34:" + std::to_string(1024 + i % 50000);
+            record.ageMs = i % 5000;
+            record.count = 1 + static_cast<uint64_t>(i % 40);
+            record.smallPayloadCount = static_cast<uint64_t>(i % 7);
+        }
+        source.analyzer().restoreSessions(std::move(records), 0);
+        if (!snapshot::save(source, path)) {
+            std::fprintf(stderr, "cannot write %s\n", path.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<double> timings;
+    size_t restored = 0;
+    double probeNs = 0.0;
+    for (int run = 0; run < RUNS; ++run) {
+        NetGuardEngine target{configFor(maxTracked)};
+        snapshot::RestoreStats stats;
+        const auto started = std::chrono::steady_clock::now();
+        const snapshot::RestoreStatus status = snapshot::restore(target, path, stats);
+        timings.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count());
+        if (status != snapshot::RestoreStatus::Restored) {
+            std::fprintf(stderr, "restore failed\n");
+            ::unlink(path.c_str());
+            return EXIT_FAILURE;
+        }
+        restored = stats.sessions;
+        probeNs = probeNsPerPacket(target);
+    }
+    ::unlink(path.c_str());
+
+    std::sort(timings.begin(), timings.end());
+    const double median = timings[timings.size() / 2];
+    std::printf("sessions=%ld restored=%zu restore min=%.2fms median=%.2fms max=%.2fms\n",
+                sessions, restored, timings.front(), median, timings.back());
+    std::printf("analysis on the restored table %.0fns/packet\n", probeNs);
+    if (restored != expected) {
+        return EXIT_FAILURE;
+    }
+    return budgetMs > 0.0 && median > budgetMs ? EXIT_FAILURE : EXIT_SUCCESS;
+}
\ No newline at end of file
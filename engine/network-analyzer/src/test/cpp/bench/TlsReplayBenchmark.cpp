@@ -0,0 +1,233 @@
+// HTTPS replay: ClientHello parsing and full per-packet analysis of TLS flows.
+//
+//     tls_replay_benchmark [flows] [capture.pcap]
+//
+// Without a capture, builds `flows` HTTPS connections: a Chrome-style ClientHello
+// (GREASE, ALPN, a distinct SNI per flow; every fourth carries a post-quantum
+// key share that splits the hello over two segments) followed by application
+// data records. A capture (Ethernet or raw IP link type) is replayed as is.
+// Flows are interleaved in groups, the way a busy device sends them.
+
+#include "NetGuardEngine.hpp"
+#include "TestPackets.hpp"
+#include "TlsInspector.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+    constexpr size_t DATA_PACKETS = 12;
+    constexpr size_t DATA_RECORD = 1200;
+    constexpr size_t SEGMENT = 1400;
+    constexpr size_t INTERLEAVE = 16;
+    constexpr size_t HYBRID_KEY_SHARE = 1216;   // X25519Kyber768 client share
+
+    using Bytes = std::vector<uint8_t>;
+
+    void put16(Bytes& out, uint16_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void putVector16(Bytes& out, const Bytes& body) {
+        put16(out, static_cast<uint16_t>(body.size()));
+        out.insert(out.end(), body.begin(), body.end());
+    }
+
+    void putExtension(Bytes& out, uint16_t type, const Bytes& body) {
+        put16(out, type);
+        putVector16(out, body);
+    }
+
+    Bytes clientHello(const std::string& sni, bool hybridKeyShare) {
+        Bytes extensions;
+        putExtension(extensions, 0x1a1a, {});
+        Bytes serverName = {0x00};
+        put16(serverName, static_cast<uint16_t>(sni.size()));
+        serverName.insert(serverName.end(), sni.begin(), sni.end());
+        Bytes serverNameList;
+        putVector16(serverNameList, serverName);
+        putExtension(extensions, 0x0000, serverNameList);
+        putExtension(extensions, 0x0017, {});
+        putExtension(extensions, 0xff01, {0x00});
+        putExtension(extensions, 0x000a, {0x00, 0x08, 0x3a, 0x3a, 0x00, 0x1d, 0x00, 0x17, 0x00, 0x18});
+        putExtension(extensions, 0x000b, {0x01, 0x00});
+        putExtension(extensions, 0x0023, {});
+        putExtension(extensions, 0x0010, {0x00, 0x0c, 0x02, 'h', '2', 0x08, 'h', 't', 't', 'p', '/', '1', '.', '1'});
+        putExtension(extensions, 0x000d, {0x00, 0x10, 0x04, 0x03, 0x08, 0x04, 0x04, 0x01, 0x05, 0x03,
+                                          0x08, 0x05, 0x05, 0x01, 0x08, 0x06, 0x06, 0x01});
+        Bytes shares;
+        if (hybridKeyShare) {
+            put16(shares, 0x6399);
+            putVector16(shares, Bytes(HYBRID_KEY_SHARE, 0x42));
+        }
+        put16(shares, 0x001d);
+        putVector16(shares, Bytes(32, 0x24));
+        Bytes keyShare;
+        putVector16(keyShare, shares);
+        putExtension(extensions, 0x0033, keyShare);
+        putExtension(extensions, 0x002d, {0x01, 0x01});
+        putExtension(extensions, 0x002b, {0x06, 0x4a, 0x4a, 0x03, 0x04, 0x03, 0x03});
+        putExtension(extensions, 0x2a2a, {0x00});
+
+        Bytes hello = {0x03, 0x03};
+        hello.insert(hello.end(), 32, 0x11);   // random
+        hello.push_back(0);                    // session id
+        putVector16(hello, {0x0a, 0x0a, 0x13, 0x01, 0x13, 0x02, 0x13, 0x03, 0xc0, 0x2b, 0xc0, 0x2f,
+                            0xc0, 0x2c, 0xc0, 0x30, 0xcc, 0xa9, 0xcc, 0xa8, 0x00, 0x2f, 0x00, 0x35});
+        hello.push_back(1);
+        hello.push_back(0);                    // null compression
+        putVector16(hello, extensions);
+
+        Bytes record = {0x16, 0x03, 0x01};
+        put16(record, static_cast<uint16_t>(hello.size() + 4));
+        record.push_back(0x01);
+        record.push_back(0x00);
+        put16(record, static_cast<uint16_t>(hello.size()));
+        record.insert(record.end(), hello.begin(), hello.end());
+        return record;
+    }
+
+    std::vector<Bytes> syntheticCorpus(long flows, std::vector<Bytes>& hellos) {
+        std::vector<std::vector<Bytes>> perFlow;
+        for (long i = 0; i < flows; ++i) {
+            testpackets::Endpoints ends;
+            ends.srcPort = static_cast<uint16_t>(20000 + i % 40000);
+            ends.dstIp = "203.0." + std::to_string((i / 250) % 250) + "." + std::to_string(1 + i % 250);
+            const Bytes hello = clientHello("host" + std::to_string(i) + ".example.net", i % 4 == 0);
+            hellos.push_back(hello);
+
+            std::vector<Bytes> packets;
+            uint32_t seq = 1000;
+            for (size_t offset = 0; offset < hello.size(); offset += SEGMENT) {
+                const size_t length = std::min(SEGMENT, hello.size() - offset);
+                packets.push_back(testpackets::tcp(ends, testpackets::TCP_ACK | testpackets::TCP_PSH,
+                                                   Bytes(hello.begin() + static_cast<std::ptrdiff_t>(offset),
+                                                         hello.begin() + static_cast<std::ptrdiff_t>(offset + length)),
+                                                   seq));
+                seq += static_cast<uint32_t>(length);
+            }
+            Bytes record = {0x17, 0x03, 0x03};
+            put16(record, static_cast<uint16_t>(DATA_RECORD));
+            record.resize(5 + DATA_RECORD, 0x5a);
+            for (size_t k = 0; k < DATA_PACKETS; ++k) {
+                packets.push_back(testpackets::tcp(ends, testpackets::TCP_ACK | testpackets::TCP_PSH, record, seq));
+                seq += static_cast<uint32_t>(record.size());
+            }
+            perFlow.push_back(std::move(packets));
+        }
+
+        std::vector<Bytes> corpus;
+        for (size_t group = 0; group < perFlow.size(); group += INTERLEAVE) {
+            const size_t end = std::min(perFlow.size(), group + INTERLEAVE);
+            for (size_t k = 0;; ++k) {
+                bool any = false;
+                for (size_t f = group; f < end; ++f) {
+                    if (k < perFlow[f].size()) {
+                        corpus.push_back(std::move(perFlow[f][k]));
+                        any = true;
+                    }
+                }
+                if (!any) break;
+            }
+        }
+        return corpus;
+    }
+
+    uint32_t read32(const uint8_t* p, bool swapped) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return swapped ? __builtin_bswap32(value) : value;
+    }
+
+    // Classic libpcap files only; Ethernet frames lose their (optionally VLAN
+    // tagged) header, anything that is not IP is skipped.
+    bool loadPcap(const char* path, std::vector<Bytes>& out) {
+        std::ifstream input(path, std::ios::binary);
+        const Bytes file((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        if (file.size() < 24) return false;
+        uint32_t magic;
+        std::memcpy(&magic, file.data(), sizeof(magic));
+        const bool swapped = magic == 0xd4c3b2a1u || magic == 0x4d3cb2a1u;
+        if (!swapped && magic != 0xa1b2c3d4u && magic != 0xa1b23c4du) return false;
+        const uint32_t linkType = read32(file.data() + 20, swapped);
+        for (size_t offset = 24; offset + 16 <= file.size();) {
+            const uint32_t captured = read32(file.data() + offset + 8, swapped);
+            offset += 16;
+            if (offset + captured > file.size()) break;
+            const uint8_t* frame = file.data() + offset;
+            size_t length = captured;
+            offset += captured;
+            if (linkType == 1) {
+                size_t header = 14;
+                if (length >= 18 && frame[12] == 0x81 && frame[13] == 0x00) header = 18;
+                if (length <= header) continue;
+                frame += header;
+                length -= header;
+            } else if (linkType != 101 && linkType != 228 && linkType != 229) {
+                return false;
+            }
+            if (length > 0 && ((frame[0] >> 4) == 4 || (frame[0] >> 4) == 6)) {
+                out.emplace_back(frame, frame + length);
+            }
+        }
+        return true;
+    }
+
+    double secondsSince(const std::chrono::steady_clock::time_point& started) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const long flows = argc > 1 ? std::max(1L, std::strtol(argv[1], nullptr, 10)) : 20000;
+
+    std::vector<Bytes> hellos;
+    std::vector<Bytes> corpus;
+    if (argc > 2) {
+        if (!loadPcap(argv[2], corpus)) {
+            std::fprintf(stderr, "cannot read %s as a pcap capture\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+    } else {
+        corpus = syntheticCorpus(flows, hellos);
+    }
+
+    if (!hellos.empty()) {
+        size_t complete = 0;
+        const auto started = std::chrono::steady_clock::now();
+        for (const Bytes& hello : hellos) {
+            tls::ClientHelloInfo info;
+            complete += tls::parseClientHello(hello.data(), hello.size(), info) == tls::ParseStatus::Complete;
+        }
+        const double elapsed = secondsSince(started);
+        std::printf("parse      hellos=%zu %.0f hellos/s\n", complete, static_cast<double>(complete) / elapsed);
+        if (complete != hellos.size()) return EXIT_FAILURE;
+    }
+
+    NetGuardEngine engine{EngineConfig{}};
+    size_t bytes = 0;
+    size_t fingerprinted = 0;
+    const auto started = std::chrono::steady_clock::now();
+    for (const Bytes& packet : corpus) {
+        const PacketAnalysisResult result = engine.analyzer().analyzePacket(packet.data(), packet.size(), "com.example");
+        bytes += packet.size();
+        fingerprinted += result.json.find("\"ja4\":") != std::string::npos;
+    }
+    const double elapsed = secondsSince(started);
+    std::printf("replay     packets=%zu %.0f packets/s %.1f MB/s handshakes fingerprinted=%zu\n",
+                corpus.size(), static_cast<double>(corpus.size()) / elapsed,
+                static_cast<double>(bytes) / elapsed / 1e6, fingerprinted);
+
+    // Every synthetic hello, split or not, must come out fingerprinted.
+    return hellos.empty() || fingerprinted == hellos.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#include <android/log.h>
+
+#include <cstdarg>
+#include <cstdio>
+
+// Errors go to stderr so a failing test shows why; everything else is dropped
+// to keep test and benchmark output readable.
+extern "C" int __android_log_print(int priority, const char* tag, const char* format, ...) {
+    if (priority < ANDROID_LOG_ERROR) {
+        return 0;
+    }
+    std::fprintf(stderr, "%s: ", tag);
+    va_list args;
+    va_start(args, format);
+    int written = std::vfprintf(stderr, format, args);
+    va_end(args);
+    std::fputc('\n', stderr);
+    return written;
+}
\ No newline at end of file
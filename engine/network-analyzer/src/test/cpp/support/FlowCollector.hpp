@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal IPFIX (RFC 7011) / NetFlow v9 (RFC 3954) collector used to check what
+// the flow exporter puts on the wire. It learns templates from template sets and
+// decodes data records with them, the way a real collector would.
+namespace collector {
+
+    // IPFIX keys enterprise fields by (enterprise number, id without the E bit).
+    // NetFlow v9 has no enterprise numbers: fields are keyed by the id as sent.
+    using FieldKey = std::pair<uint32_t, uint16_t>;
+
+    struct Field {
+        FieldKey key;
+        uint16_t length = 0;
+    };
+
+    struct Record {
+        uint16_t templateId = 0;
+        std::map<FieldKey, std::vector<uint8_t>> values;
+
+        bool has(FieldKey key) const { return values.count(key) != 0; }
+
+        uint64_t number(FieldKey key) const {
+            uint64_t value = 0;
+            auto it = values.find(key);
+            if (it != values.end()) {
+                for (uint8_t byte : it->second) value = (value << 8) | byte;
+            }
+            return value;
+        }
+
+        // Zero-padded string fields (the app package).
+        std::string text(FieldKey key) const {
+            auto it = values.find(key);
+            if (it == values.end()) return {};
+            std::string value(it->second.begin(), it->second.end());
+            return value.substr(0, value.find('\0'));
+        }
+
+        std::vector<uint8_t> bytes(FieldKey key) const {
+            auto it = values.find(key);
+            return it == values.end() ? std::vector<uint8_t>{} : it->second;
+        }
+    };
+
+    struct MessageHeader {
+        uint16_t version = 0;
+        uint32_t sequence = 0;
+        uint32_t domain = 0;
+        uint16_t count = 0;      // v9 only: templates + data records in the packet
+    };
+
+    class Collector {
+    public:
+        std::map<uint16_t, std::vector<Field>> templates;
+        std::vector<Record> records;
+        std::vector<MessageHeader> messages;
+        std::string error;
+
+        // Decodes back-to-back messages (a file, or one datagram). Returns false
+        // and sets `error` at the first malformed byte.
+        bool decodeStream(const uint8_t* data, size_t len) {
+            size_t offset = 0;
+            while (offset < len) {
+                const size_t used = decode(data + offset, len - offset);
+                if (used == 0) return false;
+                offset += used;
+            }
+            return true;
+        }
+
+        bool decodeStream(const std::vector<uint8_t>& data) { return decodeStream(data.data(), data.size()); }
+
+    private:
+        static uint16_t read16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+
+        static uint32_t read32(const uint8_t* p) {
+            return (static_cast<uint32_t>(read16(p)) << 16) | read16(p + 2);
+        }
+
+        size_t fail(const std::string& reason) {
+            error = reason;
+            return 0;
+        }
+
+        size_t decode(const uint8_t* data, size_t len) {
+            if (len < 4) return fail("truncated header");
+            const uint16_t version = read16(data);
+            if (version == 10) return decodeIpfix(data, len);
+            if (version == 9) return decodeV9(data, len);
+            return fail("unknown version " + std::to_string(version));
+        }
+
+        size_t decodeIpfix(const uint8_t* data, size_t len) {
+            if (len < 16) return fail("truncated IPFIX header");
+            const size_t length = read16(data + 2);
+            if (length < 16 || length > len) return fail("bad IPFIX message length");
+            MessageHeader header;
+            header.version = 10;
+            header.sequence = read32(data + 8);
+            header.domain = read32(data + 12);
+            messages.push_back(header);
+
+            size_t offset = 16;
+            while (offset < length) {
+                if (length - offset < 4) return fail("truncated set header");
+                const uint16_t setId = read16(data + offset);
+                const size_t setLength = read16(data + offset + 2);
+                if (setLength < 4 || offset + setLength > length) return fail("bad set length");
+                const uint8_t* p = data + offset + 4;
+                const uint8_t* end = data + offset + setLength;
+                if (setId == 2) {
+                    while (end - p >= 4) {
+                        const uint16_t templateId = read16(p);
+                        const uint16_t fieldCount = read16(p + 2);
+                        p += 4;
+                        std::vector<Field> fields;
+                        for (uint16_t i = 0; i < fieldCount; ++i) {
+                            if (end - p < 4) return fail("truncated template");
+                            Field field;
+                            const uint16_t id = read16(p);
+                            field.length = read16(p + 2);
+                            p += 4;
+                            field.key = {0, id};
+                            if (id & 0x8000) {
+                                if (end - p < 4) return fail("truncated enterprise number");
+                                field.key = {read32(p), static_cast<uint16_t>(id & 0x7FFF)};
+                                p += 4;
+                            }
+                            fields.push_back(field);
+                        }
+                        templates[templateId] = fields;
+                    }
+                } else if (setId >= 256) {
+                    if (!decodeData(setId, p, end)) return 0;
+                }
+                offset += setLength;
+            }
+            return length;
+        }
+
+        size_t decodeV9(const uint8_t* data, size_t len) {
+            if (len < 20) return fail("truncated v9 header");
+            MessageHeader header;
+            header.version = 9;
+            header.count = read16(data + 2);
+            header.sequence = read32(data + 12);
+            header.domain = read32(data + 16);
+            messages.push_back(header);
+
+            // v9 headers carry no length: the packet ends once `count` records
+            // (templates and data) have been read.
+            size_t remaining = header.count;
+            size_t offset = 20;
+            while (remaining > 0) {
+                if (len - offset < 4) return fail("truncated flowset header");
+                const uint16_t flowsetId = read16(data + offset);
+                const size_t flowsetLength = read16(data + offset + 2);
+                if (flowsetLength < 4 || flowsetLength % 4 != 0 || offset + flowsetLength > len) {
+                    return fail("bad flowset length");
+                }
+                const uint8_t* p = data + offset + 4;
+                const uint8_t* end = data + offset + flowsetLength;
+                if (flowsetId == 0) {
+                    while (end - p >= 4 && remaining > 0) {
+                        const uint16_t templateId = read16(p);
+                        const uint16_t fieldCount = read16(p + 2);
+                        p += 4;
+                        std::vector<Field> fields;
+                        for (uint16_t i = 0; i < fieldCount; ++i) {
+                            if (end - p < 4) return fail("truncated template");
+                            fields.push_back(Field{{0, read16(p)}, read16(p + 2)});
+                            p += 4;
+                        }
+                        templates[templateId] = fields;
+                        remaining--;
+                    }
+                } else if (flowsetId >= 256) {
+                    const size_t before = records.size();
+                    if (!decodeData(flowsetId, p, end)) return 0;
+                    const size_t decoded = records.size() - before;
+                    if (decoded > remaining) return fail("more records than the header count");
+                    remaining -= decoded;
+                }
+                offset += flowsetLength;
+            }
+            return offset;
+        }
+
+        bool decodeData(uint16_t templateId, const uint8_t* p, const uint8_t* end) {
+            auto known = templates.find(templateId);
+            if (known == templates.end()) {
+                fail("data before template " + std::to_string(templateId));
+                return false;
+            }
+            size_t recordLength = 0;
+            for (const Field& field : known->second) recordLength += field.length;
+            while (recordLength > 0 && static_cast<size_t>(end - p) >= recordLength) {
+                Record record;
+                record.templateId = templateId;
+                for (const Field& field : known->second) {
+                    record.values[field.key] = std::vector<uint8_t>(p, p + field.length);
+                    p += field.length;
+                }
+                records.push_back(std::move(record));
+            }
+            return true;   // anything left is set padding
+        }
+    };
+
+} // namespace collector
\ No newline at end of file
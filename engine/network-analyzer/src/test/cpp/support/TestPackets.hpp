@@ -0,0 +1,125 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Builders for the raw IPv4 / IPv6 packets the tests feed to the engine. Checksums are
+// filled in so the packets are also valid on a real TUN device.
+namespace testpackets {
+
+    constexpr uint8_t TCP_FIN = 0x01;
+    constexpr uint8_t TCP_SYN = 0x02;
+    constexpr uint8_t TCP_RST = 0x04;
+    constexpr uint8_t TCP_PSH = 0x08;
+    constexpr uint8_t TCP_ACK = 0x10;
+
+    struct Endpoints {
+        std::string srcIp = "10.0.0.2";
+        std::string dstIp = "93.184.216.34";
+        uint16_t srcPort = 40000;
+        uint16_t dstPort = 443;
+    };
+
+    inline uint16_t checksum(const uint8_t* data, size_t len, uint32_t sum = 0) {
+        for (size_t i = 0; i + 1 < len; i += 2) {
+            sum += static_cast<uint32_t>((data[i] << 8) | data[i + 1]);
+        }
+        if (len & 1u) {
+            sum += static_cast<uint32_t>(data[len - 1] << 8);
+        }
+        while (sum >> 16) {
+            sum = (sum & 0xFFFFu) + (sum >> 16);
+        }
+        return static_cast<uint16_t>(~sum);
+    }
+
+    inline void put16(uint8_t* out, uint16_t value) {
+        out[0] = static_cast<uint8_t>(value >> 8);
+        out[1] = static_cast<uint8_t>(value);
+    }
+
+    inline void put32(uint8_t* out, uint32_t value) {
+        put16(out, static_cast<uint16_t>(value >> 16));
+        put16(out + 2, static_cast<uint16_t>(value));
+    }
+
+    inline void finishTransport(std::vector<uint8_t>& packet, size_t l4Offset, uint8_t protocol, uint32_t pseudo) {
+        const size_t l4Length = packet.size() - l4Offset;
+        pseudo += protocol + static_cast<uint32_t>(l4Length);
+        const size_t checksumOffset = l4Offset + (protocol == IPPROTO_TCP ? 16 : 6);
+        put16(&packet[checksumOffset], checksum(packet.data() + l4Offset, l4Length, pseudo));
+    }
+
+    inline uint32_t sumAddresses(const uint8_t* addresses, size_t len) {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < len; i += 2) {
+            sum += static_cast<uint32_t>((addresses[i] << 8) | addresses[i + 1]);
+        }
+        return sum;
+    }
+
+    inline std::vector<uint8_t> ipv6(const Endpoints& ends, uint8_t protocol, const std::vector<uint8_t>& l4) {
+        std::vector<uint8_t> packet(40 + l4.size());
+        packet[0] = 0x60;
+        put16(&packet[4], static_cast<uint16_t>(l4.size()));
+        packet[6] = protocol;
+        packet[7] = 64;
+        inet_pton(AF_INET6, ends.srcIp.c_str(), &packet[8]);
+        inet_pton(AF_INET6, ends.dstIp.c_str(), &packet[24]);
+        std::memcpy(packet.data() + 40, l4.data(), l4.size());
+        finishTransport(packet, 40, protocol, sumAddresses(&packet[8], 32));
+        return packet;
+    }
+
+    inline std::vector<uint8_t> ipv4(const Endpoints& ends, uint8_t protocol, const std::vector<uint8_t>& l4) {
+        std::vector<uint8_t> packet(20 + l4.size());
+        packet[0] = 0x45;
+        put16(&packet[2], static_cast<uint16_t>(packet.size()));
+        packet[8] = 64;
+        packet[9] = protocol;
+        inet_pton(AF_INET, ends.srcIp.c_str(), &packet[12]);
+        inet_pton(AF_INET, ends.dstIp.c_str(), &packet[16]);
+        put16(&packet[10], checksum(packet.data(), 20));
+        std::memcpy(packet.data() + 20, l4.data(), l4.size());
+        finishTransport(packet, 20, protocol, sumAddresses(&packet[12], 8));
+        return packet;
+    }
+
+    // IPv6 when the endpoints are IPv6 literals.
+    inline std::vector<uint8_t> ip(const Endpoints& ends, uint8_t protocol, const std::vector<uint8_t>& l4) {
+        return ends.srcIp.find(':') != std::string::npos ? ipv6(ends, protocol, l4) : ipv4(ends, protocol, l4);
+    }
+
+    inline std::vector<uint8_t> tcp(const Endpoints& ends, uint8_t flags, const std::vector<uint8_t>& payload,
+                                    uint32_t seq = 1000, uint32_t ack = 0, uint16_t window = 65535) {
+        std::vector<uint8_t> segment(20 + payload.size());
+        put16(&segment[0], ends.srcPort);
+        put16(&segment[2], ends.dstPort);
+        put32(&segment[4], seq);
+        put32(&segment[8], ack);
+        segment[12] = 5u << 4;
+        segment[13] = flags;
+        put16(&segment[14], window);
+        std::memcpy(segment.data() + 20, payload.data(), payload.size());
+        return ip(ends, IPPROTO_TCP, segment);
+    }
+
+    inline std::vector<uint8_t> udp(const Endpoints& ends, const std::vector<uint8_t>& payload) {
+        std::vector<uint8_t> datagram(8 + payload.size());
+        put16(&datagram[0], ends.srcPort);
+        put16(&datagram[2], ends.dstPort);
+        put16(&datagram[4], static_cast<uint16_t>(datagram.size()));
+        std::memcpy(datagram.data() + 8, payload.data(), payload.size());
+        return ip(ends, IPPROTO_UDP, datagram);
+    }
+
+    inline std::vector<uint8_t> bytes(const std::string& text) {
+        return std::vector<uint8_t>(text.begin(), text.end());
+    }
+
+} // namespace testpackets
\ No newline at end of file
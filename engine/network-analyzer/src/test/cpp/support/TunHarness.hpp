@@ -0,0 +1,161 @@
+#pragma once
+
+#include "TestPackets.hpp"
+#include "TunForwarder.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Drives a tun::Forwarder without a TUN device: one end of a SOCK_SEQPACKET
+// socketpair stands in for the interface (it keeps packet boundaries like a TUN
+// fd does) and the test plays the app on the other end. Flows are pointed at a
+// loopback listener, which plays the remote server.
+namespace tunharness {
+
+    struct Segment {
+        uint8_t flags = 0;
+        uint32_t seq = 0;
+        uint32_t ack = 0;
+        uint16_t window = 0;
+        std::vector<uint8_t> payload;
+    };
+
+    // Decodes an IPv4 TCP packet written by the forwarder.
+    inline bool parseSegment(const uint8_t* data, size_t len, Segment& out) {
+        if (len < 20 || (data[0] >> 4) != 4 || data[9] != IPPROTO_TCP) return false;
+        const size_t ipHeader = static_cast<size_t>(data[0] & 0x0F) * 4;
+        if (len < ipHeader + 20) return false;
+        const uint8_t* tcp = data + ipHeader;
+        const size_t tcpHeader = static_cast<size_t>(tcp[12] >> 4) * 4;
+        if (len < ipHeader + tcpHeader) return false;
+        out.seq = (static_cast<uint32_t>(tcp[4]) << 24) | (static_cast<uint32_t>(tcp[5]) << 16) |
+                  (static_cast<uint32_t>(tcp[6]) << 8) | tcp[7];
+        out.ack = (static_cast<uint32_t>(tcp[8]) << 24) | (static_cast<uint32_t>(tcp[9]) << 16) |
+                  (static_cast<uint32_t>(tcp[10]) << 8) | tcp[11];
+        out.flags = tcp[13];
+        out.window = static_cast<uint16_t>((tcp[14] << 8) | tcp[15]);
+        out.payload.assign(tcp + tcpHeader, data + len);
+        return true;
+    }
+
+    // Loopback TCP listener on an ephemeral port.
+    class Server {
+    public:
+        Server() {
+            listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t length = sizeof(address);
+            if (listenFd < 0 || ::bind(listenFd, reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+                ::listen(listenFd, 4) != 0 ||
+                ::getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+                return;
+            }
+            listenPort = ntohs(address.sin_port);
+        }
+
+        ~Server() {
+            if (peerFd >= 0) ::close(peerFd);
+            if (listenFd >= 0) ::close(listenFd);
+        }
+
+        Server(const Server&) = delete;
+        Server& operator=(const Server&) = delete;
+
+        uint16_t port() const { return listenPort; }
+
+        // Accepts the forwarder's relay connection; the returned fd stays owned here.
+        int accept(int timeoutMs = 2000) {
+            pollfd waiting{listenFd, POLLIN, 0};
+            if (::poll(&waiting, 1, timeoutMs) != 1) return -1;
+            peerFd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            return peerFd;
+        }
+
+    private:
+        int listenFd = -1;
+        int peerFd = -1;
+        uint16_t listenPort = 0;
+    };
+
+    class Harness {
+    public:
+        Harness() {
+            if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0) {
+                fds[0] = fds[1] = -1;
+                return;
+            }
+            tun::ForwarderConfig config;
+            config.tunFd = fds[0];
+            forwarder = std::make_unique<tun::Forwarder>(config, tun::Host{});
+        }
+
+        ~Harness() {
+            if (forwarder) forwarder->stop();
+            if (fds[0] >= 0) ::close(fds[0]);
+            if (fds[1] >= 0) ::close(fds[1]);
+        }
+
+        Harness(const Harness&) = delete;
+        Harness& operator=(const Harness&) = delete;
+
+        bool start() { return forwarder && forwarder->start(); }
+
+        // Shrinks the interface's send buffer so the forwarder's TUN writes hit
+        // EAGAIN after a few packets the app has not read.
+        bool limitTunBuffer(int bytes) {
+            return ::setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes)) == 0;
+        }
+
+        const tun::ForwarderStats& stats() const { return forwarder->stats(); }
+
+        // Writes a packet the app sent into the "interface".
+        bool send(const std::vector<uint8_t>& packet) {
+            return ::write(fds[1], packet.data(), packet.size()) == static_cast<ssize_t>(packet.size());
+        }
+
+        // Next TCP segment the forwarder wrote back to the app, or false on timeout.
+        bool receive(Segment& out, int timeoutMs = 2000) {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+            std::vector<uint8_t> buffer(65535);
+            while (true) {
+                const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now()).count();
+                pollfd waiting{fds[1], POLLIN, 0};
+                if (left <= 0 || ::poll(&waiting, 1, static_cast<int>(left)) != 1) return false;
+                const ssize_t n = ::read(fds[1], buffer.data(), buffer.size());
+                if (n <= 0) return false;
+                if (parseSegment(buffer.data(), static_cast<size_t>(n), out)) return true;
+            }
+        }
+
+        // Runs the app side of the three-way handshake. On success `appNext` and
+        // `remoteNext` hold the next sequence numbers of each direction.
+        bool connect(const testpackets::Endpoints& ends, uint32_t appIsn, uint32_t& appNext, uint32_t& remoteNext) {
+            if (!send(testpackets::tcp(ends, testpackets::TCP_SYN, {}, appIsn))) return false;
+            Segment synAck;
+            if (!receive(synAck) ||
+                synAck.flags != (testpackets::TCP_SYN | testpackets::TCP_ACK) || synAck.ack != appIsn + 1) {
+                return false;
+            }
+            appNext = appIsn + 1;
+            remoteNext = synAck.seq + 1;
+            return send(testpackets::tcp(ends, testpackets::TCP_ACK, {}, appNext, remoteNext));
+        }
+
+    private:
+        int fds[2] = {-1, -1};
+        std::unique_ptr<tun::Forwarder> forwarder;
+    };
+
+} // namespace tunharness
\ No newline at end of file
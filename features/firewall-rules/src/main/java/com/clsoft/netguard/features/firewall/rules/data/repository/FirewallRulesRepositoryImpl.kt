@@ -9,11 +9,13 @@ import androidx.datastore.preferences.core.stringPreferencesKey
 import com.clsoft.netguard.features.firewall.rules.domain.error.DuplicateFirewallRuleException
 import com.clsoft.netguard.features.firewall.rules.domain.model.FirewallRule
 import com.clsoft.netguard.features.firewall.rules.domain.repository.FirewallRulesRepository
+import com.clsoft.netguard.framework.vpn.domain.manager.FirewallRulesSync
 import com.clsoft.netguard.framework.vpn.domain.manager.NativeFirewallManager
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.flow.Flow
 import kotlinx.coroutines.flow.catch
 import kotlinx.coroutines.flow.distinctUntilChanged
+import kotlinx.coroutines.flow.first
 import kotlinx.coroutines.flow.map
 import kotlinx.coroutines.withContext
 import org.json.JSONArray
@@ -27,7 +29,7 @@ import javax.inject.Singleton
 class FirewallRulesRepositoryImpl @Inject constructor(
     private val dataStore: DataStore<Preferences>,
     private val nativeFirewallManager: NativeFirewallManager
-) : FirewallRulesRepository {
+) : FirewallRulesRepository, FirewallRulesSync {
 
     private object Keys {
         val RULES = stringPreferencesKey("firewall_rules")
@@ -121,6 +123,13 @@ class FirewallRulesRepositoryImpl @Inject constructor(
         }
     }
 
+    override suspend fun syncNativeRules() {
+        val blocked = withContext(Dispatchers.IO) {
+            getRules().first().filterNot { it.isAllowed }.map { it.appPackage }
+        }
+        nativeFirewallManager.replaceRules(blocked)
+    }
+
     private fun String?.toRules(): List<FirewallRule> {
         if (this.isNullOrBlank()) return emptyList()
         return runCatching {
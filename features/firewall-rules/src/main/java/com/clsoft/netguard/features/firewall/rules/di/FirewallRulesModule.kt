@@ -4,6 +4,7 @@ import com.clsoft.netguard.features.firewall.rules.data.repository.FirewallAppsR
 import com.clsoft.netguard.features.firewall.rules.data.repository.FirewallRulesRepositoryImpl
 import com.clsoft.netguard.features.firewall.rules.domain.repository.FirewallAppsRepository
 import com.clsoft.netguard.features.firewall.rules.domain.repository.FirewallRulesRepository
+import com.clsoft.netguard.framework.vpn.domain.manager.FirewallRulesSync
 import dagger.Binds
 import dagger.Module
 import dagger.hilt.InstallIn
@@ -20,6 +21,12 @@ abstract class FirewallRulesModule {
         impl: FirewallRulesRepositoryImpl
     ): FirewallRulesRepository
 
+    @Binds
+    @Singleton
+    abstract fun bindFirewallRulesSync(
+        impl: FirewallRulesRepositoryImpl
+    ): FirewallRulesSync
+
     @Binds
     @Singleton
     abstract fun bindFirewallAppsRepository(
@@ -13,7 +13,8 @@ data class TrafficSession(
     val timestamp: Long,
     val blocked: Boolean = false,
     val riskScore: Float = 0f,
-    val riskLabel: String
+    val riskLabel: String,
+    val approximateRisk: Boolean = false
 )
 
 fun TrafficSession.toTraffic(): Traffic = Traffic(
@@ -1,7 +1,8 @@
 package com.clsoft.netguard.features.traffic.monitor.service
 
 import com.clsoft.netguard.core.utils.Logger
-import com.clsoft.netguard.engine.network.analyzer.NativeBridge
+import com.clsoft.netguard.engine.network.analyzer.NativeEngine
+import com.clsoft.netguard.engine.network.analyzer.PacketMirror
 import org.json.JSONObject
 
 internal object NativeRiskEvaluator {
@@ -11,7 +12,8 @@ internal object NativeRiskEvaluator {
     data class RiskSummary(
         val label: String?,
         val score: Float,
-        val blocked: Boolean
+        val blocked: Boolean,
+        val approximate: Boolean = false
     ) {
         companion object {
             val Default = RiskSummary(label = "Low", score = 0f, blocked = false)
@@ -24,13 +26,20 @@ internal object NativeRiskEvaluator {
         "HIGH" to 2
     )
 
-    fun evaluate(appPackage: String?, packets: List<ByteArray>): RiskSummary {
+    /**
+     * Analyzes [packets] natively. [queuedPackets] is every captured packet still
+     * waiting for analysis, this batch included; the engine sheds work on it.
+     */
+    fun evaluate(appPackage: String?, packets: List<ByteArray>, queuedPackets: Int = packets.size): RiskSummary {
         if (packets.isEmpty()) {
             return RiskSummary.Default
         }
 
         return try {
-            val responses = NativeBridge.analyzePackets(appPackage, packets.toTypedArray())
+            val engine = NativeEngine.shared
+            engine.reportBacklog(queuedPackets)
+            val responses = engine.analyzePackets(appPackage, packets.toTypedArray())
+            engine.reportBacklog(queuedPackets - packets.size)
             mergeResponses(responses)
         } catch (t: Throwable) {
             Logger.e(TAG, "Native analysis failed", t)
@@ -38,10 +47,34 @@ internal object NativeRiskEvaluator {
         }
     }
 
+    /** Summary of a verdict the native forwarder already applied to a packet. */
+    fun fromMirror(verdict: PacketMirror.Verdict): RiskSummary = RiskSummary(
+        label = verdict.riskLabel,
+        score = verdict.riskScore,
+        blocked = verdict.blocked || verdict.firewallBlocked,
+        approximate = verdict.approximate
+    )
+
+    /** Folds [next] into [current] the same way per-packet responses are merged. */
+    fun merge(current: RiskSummary?, next: RiskSummary): RiskSummary {
+        if (current == null) {
+            return next
+        }
+        val currentLabel = current.label ?: "Low"
+        val nextLabel = next.label ?: "Low"
+        return RiskSummary(
+            label = if (isHigherPriority(nextLabel, currentLabel)) nextLabel else currentLabel,
+            score = maxOf(current.score, next.score),
+            blocked = current.blocked || next.blocked,
+            approximate = current.approximate || next.approximate
+        )
+    }
+
     private fun mergeResponses(responses: Array<String>): RiskSummary {
         var bestScore = 0f
         var bestLabel = "Low"
         var blocked = false
+        var approximate = false
 
         responses.forEach { raw ->
             val json = runCatching { JSONObject(raw) }.getOrNull() ?: return@forEach
@@ -61,12 +94,17 @@ internal object NativeRiskEvaluator {
             if (json.optBoolean("blocked", false) || json.optBoolean("firewallBlocked", false)) {
                 blocked = true
             }
+
+            if (json.optBoolean("approximate", false)) {
+                approximate = true
+            }
         }
 
         return RiskSummary(
             label = bestLabel,
             score = bestScore,
-            blocked = blocked
+            blocked = blocked,
+            approximate = approximate
         )
     }
 
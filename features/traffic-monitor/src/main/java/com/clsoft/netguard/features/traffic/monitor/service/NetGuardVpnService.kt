@@ -9,15 +9,19 @@ import android.os.Build
 import android.os.ParcelFileDescriptor
 import androidx.core.content.ContextCompat
 import com.clsoft.netguard.core.utils.Logger
-import com.clsoft.netguard.engine.network.analyzer.NativeBridge
+import com.clsoft.netguard.engine.network.analyzer.ForwarderHost
+import com.clsoft.netguard.engine.network.analyzer.NativeEngine
+import com.clsoft.netguard.engine.network.analyzer.PacketMirror
 import com.clsoft.netguard.features.traffic.monitor.domain.model.TrafficSession
 import com.clsoft.netguard.features.traffic.monitor.domain.model.toTraffic
 import com.clsoft.netguard.features.traffic.monitor.domain.repository.TrafficRepository
 import com.clsoft.netguard.framework.notification.ChannelConfig
 import com.clsoft.netguard.framework.notification.NotificationHelper
+import com.clsoft.netguard.framework.vpn.domain.manager.FirewallRulesSync
 import dagger.hilt.android.AndroidEntryPoint
 import kotlinx.coroutines.*
 import org.json.JSONObject
+import java.io.File
 import java.io.FileInputStream
 import java.io.IOException
 import java.net.InetAddress
@@ -30,10 +34,13 @@ class NetGuardVpnService : VpnService() {
 
     @Inject lateinit var notificationHelper: NotificationHelper
     @Inject lateinit var trafficRepository: TrafficRepository
+    @Inject lateinit var firewallRulesSync: FirewallRulesSync
 
     private val vpnScopeRef = AtomicReference(createScope())
-    private var vpnInterface: ParcelFileDescriptor? = null
+    @Volatile private var vpnInterface: ParcelFileDescriptor? = null
+    @Volatile private var packetMirror: ParcelFileDescriptor? = null
     private var monitorJob: Job? = null
+    @Volatile private var checkpointJob: Job? = null
     @Volatile private var isRunning = false
 
     private val localVpnAddressV4: String by lazy { InetAddress.getByName(VPN_ADDRESS).hostAddress }
@@ -51,6 +58,30 @@ class NetGuardVpnService : VpnService() {
     }
 
 
+    private val forwarderHost = object : ForwarderHost {
+        override fun protect(fd: Int): Boolean = this@NetGuardVpnService.protect(fd)
+
+        override fun resolveOwner(
+            protocol: Int,
+            sourceIp: String,
+            sourcePort: Int,
+            destinationIp: String,
+            destinationPort: Int
+        ): String? {
+            val packet = ParsedPacket(
+                sourceIp = sourceIp,
+                destinationIp = destinationIp,
+                protocol = if (protocol == TCP_PROTOCOL_NUMBER) "TCP" else "UDP",
+                protocolNumber = protocol,
+                direction = PacketDirection.OUTGOING,
+                totalBytes = 0L,
+                sourcePort = sourcePort,
+                destinationPort = destinationPort
+            )
+            return connectionOwnerResolver?.resolve(packet)
+        }
+    }
+
     override fun onCreate() {
         super.onCreate()
         ChannelConfig.createChannels(this)
@@ -84,40 +115,75 @@ class NetGuardVpnService : VpnService() {
 
                 Logger.d("NetGuardVpnService", "Iniciando captura de tráfico real desde el túnel")
                 isRunning = true
-                vpnInterface = establishVPN()
-
-                val scope = ensureScope()
-                monitorJob = scope.launch {
-                    captureVpnTraffic()
-//                    captureTrafficLoop()
+                monitorJob = ensureScope().launch {
+                    startEngineAndTunnel()
                 }
             }
         }
         return START_NOT_STICKY
     }
 
+    /**
+     * Prepares the native engine and then brings the tunnel up, on [Dispatchers.IO].
+     * Loading detection data, restoring the snapshot, reading the firewall rules
+     * and the export config all touch storage, so none of it runs on the main
+     * thread; the forwarder only starts once the engine is ready.
+     */
+    private suspend fun startEngineAndTunnel() {
+        loadDetectionData()
+        restoreEngineSnapshot()
+        syncFirewallRules()
+        startFlowExport()
+        if (!coroutineContext.isActive || !isRunning) {
+            return
+        }
+
+        vpnInterface = establishVPN()
+        packetMirror = vpnInterface?.let(::startForwarder)
+        checkpointJob = ensureScope().launch {
+            checkpointEngineLoop()
+        }
+        captureVpnTraffic()
+//        captureTrafficLoop()
+    }
+
     private fun stopVpnService() {
         Logger.d("NetGuardVpnService", "Deteniendo servicio VPN")
 
         isRunning = false
-        try {
-            vpnInterface?.close()
-            vpnInterface = null
-            Logger.d("NetGuardVpnService", "Interfaz VPN liberada")
-        } catch (e: Exception) {
-            Logger.e("NetGuardVpnService", "Error al cerrar interfaz VPN", e)
-        }
-
+        // Closing the tunnel unblocks the capture read; the start sequence may
+        // still bring one up while it winds down, so release again after joining.
+        releaseTunnel()
         runBlocking {
             monitorJob?.cancelAndJoin()
+            checkpointJob?.cancelAndJoin()
             vpnScopeRef.getAndSet(createScope()).cancel()
             monitorJob = null
+            checkpointJob = null
         }
+        releaseTunnel()
+        runCatching { NativeEngine.shared.stopFlowExport() }
+            .onFailure { error -> Logger.e("NetGuardVpnService", "Error deteniendo la exportación de flujos", error) }
+        saveEngineSnapshot()
 
         stopForeground(STOP_FOREGROUND_REMOVE)
         stopSelf()
     }
 
+    private fun releaseTunnel() {
+        runCatching { NativeEngine.shared.stopForwarder() }
+            .onFailure { error -> Logger.e("NetGuardVpnService", "Error deteniendo el reenvío nativo", error) }
+        try {
+            packetMirror?.close()
+            packetMirror = null
+            vpnInterface?.close()
+            vpnInterface = null
+            Logger.d("NetGuardVpnService", "Interfaz VPN liberada")
+        } catch (e: Exception) {
+            Logger.e("NetGuardVpnService", "Error al cerrar interfaz VPN", e)
+        }
+    }
+
     override fun onDestroy() {
         super.onDestroy()
         Logger.d("NetGuardVpnService", "onDestroy() ejecutado (cleanup final)")
@@ -127,6 +193,7 @@ class NetGuardVpnService : VpnService() {
         Logger.d("NetGuardVpnService", "Configurando túnel VPN...")
         val builder = Builder()
             .setSession("NDK NetGuard VPN")
+            .setMtu(VPN_MTU)
             .addAddress(VPN_ADDRESS, 32)
             .addRoute("0.0.0.0", 0)
             .addAddress("fd00:1:fd00::2", 128)
@@ -140,14 +207,119 @@ class NetGuardVpnService : VpnService() {
         }
     }
 
+    /**
+     * Hands the tunnel to the native forwarder, which relays every flow over
+     * protected sockets and applies firewall verdicts inline. Returns the packet
+     * mirror the monitor reads from, or null to keep reading the tunnel directly.
+     */
+    private fun startForwarder(tunnel: ParcelFileDescriptor): ParcelFileDescriptor? {
+        val mirrorFd = runCatching {
+            NativeEngine.shared.startForwarder(tunnel.fd, VPN_MTU, ENFORCE_RISK_VERDICTS, forwarderHost)
+        }.onFailure { error ->
+            Logger.e("NetGuardVpnService", "Error iniciando el reenvío nativo", error)
+        }.getOrDefault(-1)
+
+        if (mirrorFd < 0) {
+            Logger.e("NetGuardVpnService", "Reenvío nativo no disponible, solo captura")
+            return null
+        }
+        Logger.d("NetGuardVpnService", "Reenvío nativo iniciado")
+        return ParcelFileDescriptor.adoptFd(mirrorFd)
+    }
+
+    private fun loadDetectionData() {
+        loadNativeFile(TLS_FINGERPRINTS_FILE, "Huellas TLS", NativeEngine.shared::loadTlsFingerprints)
+        loadNativeFile(PAYLOAD_SIGNATURES_FILE, "Firmas de payload", NativeEngine.shared::loadSignatureDatabase)
+    }
+
+    private fun loadNativeFile(name: String, label: String, loader: (String) -> Int) {
+        val file = File(filesDir, name)
+        if (!file.exists()) {
+            return
+        }
+        runCatching { loader(file.absolutePath) }
+            .onSuccess { count -> Logger.d("NetGuardVpnService", "$label cargadas: $count") }
+            .onFailure { error -> Logger.e("NetGuardVpnService", "Error cargando $label", error) }
+    }
+
+    /**
+     * Starts the native IPFIX / NetFlow v9 flow export when [FLOW_EXPORT_CONFIG_FILE]
+     * exists. One `key=value` per line:
+     *   target=udp://127.0.0.1:4739   (or an absolute file path)
+     *   format=ipfix | netflow9
+     *   active_timeout=60             (seconds)
+     *   idle_timeout=15               (seconds)
+     */
+    private fun startFlowExport() {
+        val file = File(filesDir, FLOW_EXPORT_CONFIG_FILE)
+        if (!file.exists()) {
+            return
+        }
+        runCatching {
+            val settings = file.readLines()
+                .map { it.trim() }
+                .filter { it.isNotEmpty() && !it.startsWith("#") }
+                .mapNotNull { line ->
+                    val separator = line.indexOf('=')
+                    if (separator <= 0) null
+                    else line.substring(0, separator).trim() to line.substring(separator + 1).trim()
+                }
+                .toMap()
+            val target = settings["target"] ?: error("Falta 'target' en $FLOW_EXPORT_CONFIG_FILE")
+            val started = NativeEngine.shared.startFlowExport(
+                target = target,
+                netflowV9 = settings["format"].equals("netflow9", ignoreCase = true),
+                activeTimeoutSeconds = settings["active_timeout"]?.toIntOrNull() ?: 60,
+                idleTimeoutSeconds = settings["idle_timeout"]?.toIntOrNull() ?: 15
+            )
+            target to started
+        }.onSuccess { (target, started) ->
+            if (started) Logger.d("NetGuardVpnService", "Exportación de flujos iniciada hacia $target")
+            else Logger.e("NetGuardVpnService", "No se pudo abrir el destino de exportación $target")
+        }.onFailure { error ->
+            Logger.e("NetGuardVpnService", "Error iniciando exportación de flujos", error)
+        }
+    }
+
+    private fun engineSnapshotFile(): File = File(filesDir, ENGINE_SNAPSHOT_FILE)
+
+    private fun restoreEngineSnapshot() {
+        runCatching { NativeEngine.shared.restoreSnapshot(engineSnapshotFile().absolutePath) }
+            .onSuccess { restored ->
+                if (restored) Logger.d("NetGuardVpnService", "Estado nativo restaurado desde snapshot")
+            }
+            .onFailure { error -> Logger.e("NetGuardVpnService", "Error restaurando snapshot nativo", error) }
+    }
+
+    // The snapshot carries no firewall rules; the persisted ones are pushed before
+    // any traffic flows so a restored engine never enforces stale blocks.
+    private suspend fun syncFirewallRules() {
+        runCatching { firewallRulesSync.syncNativeRules() }
+            .onSuccess { Logger.d("NetGuardVpnService", "Reglas de firewall sincronizadas con el motor nativo") }
+            .onFailure { error -> Logger.e("NetGuardVpnService", "Error sincronizando reglas de firewall", error) }
+    }
+
+    private fun saveEngineSnapshot() {
+        runCatching { NativeEngine.shared.saveSnapshot(engineSnapshotFile().absolutePath) }
+            .onFailure { error -> Logger.e("NetGuardVpnService", "Error guardando snapshot nativo", error) }
+    }
+
+    private suspend fun checkpointEngineLoop() {
+        while (coroutineContext.isActive && isRunning) {
+            delay(CHECKPOINT_INTERVAL_MS)
+            saveEngineSnapshot()
+        }
+    }
+
     private suspend fun captureVpnTraffic() {
-        val interfaceFd = vpnInterface ?: run {
+        val interfaceFd = packetMirror ?: vpnInterface ?: run {
             Logger.e("NetGuardVpnService", "Interfaz VPN no disponible para captura")
             isRunning = false
             return
         }
 
-        val aggregator = TrafficSessionAggregator()
+        val mirrored = interfaceFd === packetMirror
+        val aggregator = TrafficSessionAggregator(nativeVerdicts = mirrored)
         val buffer = ByteArray(MAX_PACKET_SIZE)
 
         try {
@@ -163,11 +335,23 @@ class NetGuardVpnService : VpnService() {
                         break
                     }
 
-                    if (length <= 0) {
+                    if (length < 0) {
+                        break
+                    }
+                    if (length == 0) {
                         continue
                     }
 
-                    val rawPacket = buffer.copyOf(length)
+                    var verdict: NativeRiskEvaluator.RiskSummary? = null
+                    val rawPacket = if (mirrored) {
+                        if (length <= PacketMirror.HEADER_BYTES) {
+                            continue
+                        }
+                        verdict = PacketMirror.verdict(buffer, length)?.let(NativeRiskEvaluator::fromMirror)
+                        buffer.copyOfRange(PacketMirror.HEADER_BYTES, length)
+                    } else {
+                        buffer.copyOf(length)
+                    }
                     val parsed = VpnPacketParser.parsePacket(rawPacket, rawPacket.size, localVpnAddressV4, localVpnAddressV6)
                     if (parsed == null) {
                         continue
@@ -176,7 +360,7 @@ class NetGuardVpnService : VpnService() {
                     val packageName = connectionOwnerResolver?.resolve(parsed)
 
                     try {
-                        aggregator.register(parsed, rawPacket, packageName) { session ->
+                        aggregator.register(parsed, rawPacket, packageName, verdict) { session ->
                             emitSession(session)
                         }
                     } catch (ce: CancellationException) {
@@ -220,12 +404,14 @@ class NetGuardVpnService : VpnService() {
 
     private fun lookupPackageName(uid: Int): String? {
         val directName = runCatching { packageManager.getNameForUid(uid) }.getOrNull()
-        if (!directName.isNullOrBlank()) {
-            return directName
+        val packageName = if (!directName.isNullOrBlank()) {
+            directName
+        } else {
+            runCatching { packageManager.getPackagesForUid(uid) }.getOrNull()?.firstOrNull()
         }
-
-        val candidates = runCatching { packageManager.getPackagesForUid(uid) }.getOrNull()
-        return candidates?.firstOrNull()
+        // Flow export reports the UID next to the package name.
+        packageName?.let { name -> runCatching { NativeEngine.shared.setFlowOwnerUid(name, uid) } }
+        return packageName
     }
 
     private fun createScope(): CoroutineScope = CoroutineScope(SupervisorJob() + Dispatchers.IO)
@@ -245,6 +431,15 @@ class NetGuardVpnService : VpnService() {
         private const val ACTION_STOP = "com.ndk.netguard.STOP"
         private const val VPN_ADDRESS = "10.0.0.2"
         private const val MAX_PACKET_SIZE = 32_768
+        private const val VPN_MTU = 1500
+        private const val TCP_PROTOCOL_NUMBER = 6
+        // High-risk flows are reported but only firewall rules cut connections.
+        private const val ENFORCE_RISK_VERDICTS = false
+        private const val TLS_FINGERPRINTS_FILE = "tls_fingerprints.txt"
+        private const val PAYLOAD_SIGNATURES_FILE = "payload_signatures.txt"
+        private const val ENGINE_SNAPSHOT_FILE = "engine_state.snapshot"
+        private const val FLOW_EXPORT_CONFIG_FILE = "flow_export.conf"
+        private const val CHECKPOINT_INTERVAL_MS = 30_000L
 
         fun start(ctx: Context) {
             Logger.d("NetGuardVpnService", "Iniciando servicio VPN")
@@ -8,15 +8,21 @@ import java.util.UUID
 internal class TrafficSessionAggregator(
     private val flushWindowMillis: Long = DEFAULT_FLUSH_WINDOW,
     private val minBytesBeforeFlush: Long = DEFAULT_MIN_BYTES,
-    private val riskEvaluator: NativeRiskEvaluator = NativeRiskEvaluator
+    private val riskEvaluator: NativeRiskEvaluator = NativeRiskEvaluator,
+    // Packets come from the forwarder mirror with their verdict attached, so
+    // sessions keep the merged verdict instead of the packets to re-analyze.
+    private val nativeVerdicts: Boolean = false
 ) {
 
     private val sessions = LinkedHashMap<String, MutableAggregate>()
+    // Raw packets held across all sessions until their session is analyzed.
+    private var queuedPackets = 0
 
     suspend fun register(
         packet: ParsedPacket,
         rawPacket: ByteArray,
         resolvedPackage: String?,
+        verdict: NativeRiskEvaluator.RiskSummary? = null,
         emit: suspend (TrafficSession) -> Unit
     ) {
         val now = System.currentTimeMillis()
@@ -41,10 +47,15 @@ internal class TrafficSessionAggregator(
             aggregate.bytesReceived += packet.totalBytes
         }
         resolvedPackage?.let { aggregate.appPackage = it }
-        aggregate.packets += rawPacket
+        if (nativeVerdicts) {
+            verdict?.let { aggregate.verdict = riskEvaluator.merge(aggregate.verdict, it) }
+        } else {
+            aggregate.packets += rawPacket
+            queuedPackets++
+        }
 
         if (aggregate.shouldFlush(now, flushWindowMillis, minBytesBeforeFlush)) {
-            val summary = riskEvaluator.evaluate(aggregate.normalizedPackage(), aggregate.packets)
+            val summary = summarize(aggregate)
             emit(aggregate.toTrafficSession(summary))
             sessions.remove(key)
         }
@@ -54,12 +65,21 @@ internal class TrafficSessionAggregator(
         val iterator = sessions.values.iterator()
         while (iterator.hasNext()) {
             val aggregate = iterator.next()
-            val summary = riskEvaluator.evaluate(aggregate.normalizedPackage(), aggregate.packets)
+            val summary = summarize(aggregate)
             emit(aggregate.toTrafficSession(summary))
             iterator.remove()
         }
     }
 
+    private fun summarize(aggregate: MutableAggregate): NativeRiskEvaluator.RiskSummary =
+        if (nativeVerdicts) {
+            aggregate.verdict ?: NativeRiskEvaluator.RiskSummary.Default
+        } else {
+            riskEvaluator.evaluate(aggregate.normalizedPackage(), aggregate.packets, queuedPackets).also {
+                queuedPackets -= aggregate.packets.size
+            }
+        }
+
     private fun buildKey(packet: ParsedPacket): String = buildString {
         append(packet.sourceIp)
         append(':')
@@ -86,7 +106,8 @@ internal class TrafficSessionAggregator(
         var bytesSent: Long = 0,
         var bytesReceived: Long = 0,
         var appPackage: String = UNKNOWN_APP,
-        val packets: MutableList<ByteArray> = mutableListOf()
+        val packets: MutableList<ByteArray> = mutableListOf(),
+        var verdict: NativeRiskEvaluator.RiskSummary? = null
     ) {
         fun shouldFlush(now: Long, window: Long, minBytes: Long): Boolean {
             val totalBytes = bytesSent + bytesReceived
@@ -117,7 +138,8 @@ internal class TrafficSessionAggregator(
                 timestamp = lastUpdated,
                 blocked = risk.blocked,
                 riskScore = score,
-                riskLabel = label
+                riskLabel = label,
+                approximateRisk = risk.approximate
             )
         }
         fun normalizedPackage(): String? = appPackage.takeIf { it.isNotBlank() && it != UNKNOWN_APP }
@@ -1,7 +1,7 @@
 package com.clsoft.netguard.framework.vpn.data
 
 import android.util.Log
-import com.clsoft.netguard.engine.network.analyzer.NativeBridge
+import com.clsoft.netguard.engine.network.analyzer.NativeEngine
 import com.clsoft.netguard.framework.vpn.domain.manager.NativeFirewallManager
 import javax.inject.Inject
 import javax.inject.Singleton
@@ -10,7 +10,7 @@ import javax.inject.Singleton
 class NativeFirewallManagerImpl @Inject constructor() : NativeFirewallManager {
 
     override fun applyRule(packageName: String, allow: Boolean) {
-        runCatching { NativeBridge.applyFirewallRule(packageName, allow) }
+        runCatching { NativeEngine.shared.applyFirewallRule(packageName, allow) }
             .onFailure { error ->
                 Log.e(TAG, "Error al aplicar la regla para $packageName", error)
             }
@@ -20,6 +20,13 @@ class NativeFirewallManagerImpl @Inject constructor() : NativeFirewallManager {
         applyRule(packageName, true)
     }
 
+    override fun replaceRules(blockedPackages: List<String>) {
+        runCatching { NativeEngine.shared.replaceFirewallRules(blockedPackages) }
+            .onFailure { error ->
+                Log.e(TAG, "Error al reemplazar las reglas del firewall", error)
+            }
+    }
+
     private companion object {
         private const val TAG = "NativeFirewallManager"
     }
@@ -0,0 +1,10 @@
+package com.clsoft.netguard.framework.vpn.domain.manager
+
+/**
+ * Pushes the persisted firewall rules into the native engine, replacing the
+ * rules it holds. The VPN service calls it at start, after the engine snapshot
+ * is restored, so the engine never runs with stale rules.
+ */
+interface FirewallRulesSync {
+    suspend fun syncNativeRules()
+}
\ No newline at end of file
@@ -3,4 +3,5 @@ package com.clsoft.netguard.framework.vpn.domain.manager
 interface NativeFirewallManager {
     fun applyRule(packageName: String, allow: Boolean)
     fun clearRule(packageName: String)
+    fun replaceRules(blockedPackages: List<String>)
 }
\ No newline at end of file